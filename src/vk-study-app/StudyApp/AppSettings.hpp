@@ -1,5 +1,10 @@
 #pragma once
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 
 namespace vku {
 struct AppSettings {
@@ -7,5 +12,31 @@ struct AppSettings {
   int32_t width = 800;
   int32_t height = 800;
   bool hasPresentDepth = false;
+  // Render into a pool of offscreen images instead of a swapchain. No window and no VkSurfaceKHR are created (e.g. for CI machines without a display)
+  bool isHeadless = false;
+  // Number of frames the main loop runs before exiting. 0 means run until the window is closed. (Required to be non-zero when headless)
+  uint32_t numFrames = 0;
+  // Keep CPU and GPU duration of every frame in StudyRunner (e.g. for benchmarking). Otherwise only the latest ones are kept.
+  bool shouldRecordFrameTimings = false;
+  // Requested number of swapchain images. Clamped to surface capabilities' [minImageCount, maxImageCount], the driver may create more.
+  // More images queued for presentation smooth out frame time spikes, but each adds up to a frame of latency in FIFO mode.
+  uint32_t numSwapchainImages = 3;
+  // Number of frames CPU can record ahead of GPU, [1, VulkanContext::MAX_FRAMES_IN_FLIGHT]. 1 has the least latency but CPU and GPU do not overlap.
+  uint32_t numFramesInFlight = 2;
+  // Falls back to FIFO (the only mode every surface supports) if the surface does not support it
+  vk::PresentModeKHR presentMode = vk::PresentModeKHR::eMailbox;
 };
-}  // namespace vku
\ No newline at end of file
+
+// For command line arguments: "fifo", "fifo-relaxed", "mailbox" or "immediate"
+inline std::optional<vk::PresentModeKHR> parsePresentMode(std::string_view name) {
+  if (name == "fifo")
+    return vk::PresentModeKHR::eFifo;
+  if (name == "fifo-relaxed")
+    return vk::PresentModeKHR::eFifoRelaxed;
+  if (name == "mailbox")
+    return vk::PresentModeKHR::eMailbox;
+  if (name == "immediate")
+    return vk::PresentModeKHR::eImmediate;
+  return std::nullopt;
+}
+}  // namespace vku
@@ -0,0 +1,99 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace vku {
+TimingSummary summarizeTimings(std::vector<float> samples) {
+  TimingSummary summary{};
+  if (samples.empty())
+    return summary;
+  std::ranges::sort(samples);
+
+  const size_t n = samples.size();
+  // smallest sample that is greater than or equal to p percent of all samples
+  auto percentile = [&samples, n](float p) {
+    const size_t rank = static_cast<size_t>(std::ceil(p / 100.f * n));
+    return samples[std::clamp<size_t>(rank, 1, n) - 1];
+  };
+
+  summary.count = n;
+  summary.min = samples.front();
+  summary.max = samples.back();
+  summary.mean = static_cast<float>(std::accumulate(samples.begin(), samples.end(), 0.0) / n);
+  summary.median = percentile(50.f);
+  summary.p95 = percentile(95.f);
+  summary.p99 = percentile(99.f);
+  return summary;
+}
+
+static std::ofstream openForWriting(const std::filesystem::path& path) {
+  if (path.has_parent_path())
+    std::filesystem::create_directories(path.parent_path());
+  std::ofstream out(path);
+  if (!out)
+    throw std::runtime_error(std::format("cannot open {} for writing", path.string()));
+  return out;
+}
+
+void writeBenchmarkResultsCSV(const std::filesystem::path& path, const std::vector<BenchmarkResult>& results) {
+  std::ofstream out = openForWriting(path);
+  out << "id,frame,cpu_ms,gpu_ms\n";
+  for (const auto& r : results) {
+    for (size_t i = 0; i < r.cpuFrameDurationsMs.size(); ++i) {
+      out << std::format("{},{},{:.4f},", r.id, i, r.cpuFrameDurationsMs[i]);
+      if (i < r.gpuFrameDurationsMs.size())
+        out << std::format("{:.4f}", r.gpuFrameDurationsMs[i]);
+      out << '\n';
+    }
+  }
+}
+
+static std::string escapeJSON(const std::string& str) {
+  std::string escaped;
+  for (const char c : str) {
+    if (c == '"' || c == '\\')
+      escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+static std::string toJSON(const TimingSummary& s) {
+  return std::format(R"({{"count": {}, "min": {:.4f}, "mean": {:.4f}, "median": {:.4f}, "p95": {:.4f}, "p99": {:.4f}, "max": {:.4f}}})", s.count, s.min, s.mean, s.median, s.p95, s.p99, s.max);
+}
+
+static std::string toJSON(const std::vector<float>& samples) {
+  std::string str = "[";
+  for (size_t i = 0; i < samples.size(); ++i)
+    str += std::format("{}{:.4f}", i == 0 ? "" : ", ", samples[i]);
+  return str + "]";
+}
+
+void writeBenchmarkResultsJSON(const std::filesystem::path& path, const std::vector<BenchmarkResult>& results) {
+  std::ofstream out = openForWriting(path);
+  out << "{\n  \"studies\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& r = results[i];
+    out << "    {\n";
+    out << std::format("      \"id\": \"{}\",\n", escapeJSON(r.id));
+    out << std::format("      \"name\": \"{}\",\n", escapeJSON(r.name));
+    out << std::format("      \"warmupFrames\": {},\n", r.numWarmupFrames);
+    out << std::format("      \"cpuMs\": {},\n", toJSON(r.cpu));
+    out << std::format("      \"gpuMs\": {},\n", toJSON(r.gpu));
+    out << std::format("      \"inputLatencyMs\": {},\n", toJSON(r.inputLatency));
+    out << "      \"gpuScopesMs\": {";
+    for (size_t j = 0; j < r.gpuScopes.size(); ++j)
+      out << std::format("{}\n        \"{}\": {}", j == 0 ? "" : ",", escapeJSON(r.gpuScopes[j].first), toJSON(r.gpuScopes[j].second));
+    out << (r.gpuScopes.empty() ? "},\n" : "\n      },\n");
+    out << std::format("      \"cpuFrameMs\": {},\n", toJSON(r.cpuFrameDurationsMs));
+    out << std::format("      \"gpuFrameMs\": {}\n", toJSON(r.gpuFrameDurationsMs));
+    out << (i + 1 < results.size() ? "    },\n" : "    }\n");
+  }
+  out << "  ]\n}\n";
+}
+}  // namespace vku
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vku {
+// Order statistics of a series of timing samples (in milliseconds)
+struct TimingSummary {
+  size_t count = 0;
+  float min = 0.f;
+  float mean = 0.f;
+  float median = 0.f;
+  float p95 = 0.f;
+  float p99 = 0.f;
+  float max = 0.f;
+};
+
+// Nearest-rank percentiles. Takes samples by value because it needs to sort them.
+TimingSummary summarizeTimings(std::vector<float> samples);
+
+struct BenchmarkResult {
+  std::string id;
+  std::string name;
+  uint32_t numWarmupFrames = 0;
+  // per-frame durations after warm-up, in milliseconds
+  std::vector<float> cpuFrameDurationsMs;
+  // GPU samples are read back frames-in-flight behind, therefore last couple of frames can be missing. Empty if timestamps are not supported.
+  std::vector<float> gpuFrameDurationsMs;
+  TimingSummary cpu;
+  TimingSummary gpu;
+  // From input sampling to the frame's GPU work being done, see VulkanContext::retiredFrameInputLatencyMs
+  TimingSummary inputLatency;
+  // GpuProfiler scopes, keyed by scope path
+  std::vector<std::pair<std::string, TimingSummary>> gpuScopes;
+};
+
+// One row per (study, frame): id,frame,cpu_ms,gpu_ms
+void writeBenchmarkResultsCSV(const std::filesystem::path& path, const std::vector<BenchmarkResult>& results);
+// Summaries and per-frame samples of each study
+void writeBenchmarkResultsJSON(const std::filesystem::path& path, const std::vector<BenchmarkResult>& results);
+}  // namespace vku
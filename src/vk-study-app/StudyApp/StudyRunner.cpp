@@ -9,17 +9,30 @@
 
 #include <chrono>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <utility>
 
 namespace vku {
 StudyRunner::StudyRunner()
-    : appSettings({
-          .name = "A Vulkan Study Application",
-          .width = 1200,
-          .height = 1200,
-          .hasPresentDepth = true,
-      }),
+    : StudyRunner(getDefaultAppSettings()) {}
+
+StudyRunner::StudyRunner(const vku::AppSettings& appSettings)
+    : appSettings(appSettings),
       window(appSettings),
-      vc(window, appSettings) {}
+      vc(window, appSettings) {
+  if (appSettings.isHeadless && appSettings.numFrames == 0)
+    throw std::runtime_error("headless mode requires a non-zero number of frames to run");
+}
+
+vku::AppSettings StudyRunner::getDefaultAppSettings() {
+  return {
+      .name = "A Vulkan Study Application",
+      .width = 1200,
+      .height = 1200,
+      .hasPresentDepth = true,
+  };
+}
 
 int StudyRunner::run() {
   std::cout << "Hello, Vulkan!\n";
@@ -30,20 +43,42 @@ int StudyRunner::run() {
     ;
     study->onInit(appSettings, vc);
   }
+  const vku::spirv::CacheStats shaderCacheStats = vku::spirv::getCacheStats();
+  std::cout << std::format("Shader cache: {} hits ({:.1f} ms), {} misses ({:.1f} ms compiling)\n", shaderCacheStats.numHits, shaderCacheStats.loadMs, shaderCacheStats.numMisses, shaderCacheStats.compileMs);
 
   ImGuiHelper imGuiHelper{vc, window};
 
   //---- Main Loop
-  while (!window.shouldClose()) {
+  uint32_t numFramesDrawn = 0;
+  float gpuFrameDurationMs = 0.f;
+  float inputLatencyMs = 0.f;
+  while (!window.shouldClose() && (appSettings.numFrames == 0 || numFramesDrawn < appSettings.numFrames)) {
     window.pollEvents();
 
-    auto time = std::chrono::system_clock::now();
+    // steady_clock is monotonic, unlike system_clock which can jump when wall clock is adjusted
+    auto time = std::chrono::steady_clock::now();
     static std::chrono::duration<float> frameDuration{};
     const vku::FrameDrawer frameDrawer = vc.drawFrameBegin();
+    if (vc.retiredFrameGpuDurationMs.has_value()) {
+      gpuFrameDurationMs = vc.retiredFrameGpuDurationMs.value();
+      if (appSettings.shouldRecordFrameTimings)
+        gpuFrameDurationsMs.push_back(gpuFrameDurationMs);
+    }
+    if (vc.retiredFrameInputLatencyMs.has_value()) {
+      inputLatencyMs = vc.retiredFrameInputLatencyMs.value();
+      if (appSettings.shouldRecordFrameTimings)
+        inputLatenciesMs.push_back(inputLatencyMs);
+    }
+    if (appSettings.shouldRecordFrameTimings && vc.gpuProfiler.hasNewResults())
+      for (const auto& scope : vc.gpuProfiler.getLatestResults())
+        gpuScopeDurationsMs[scope.path].push_back(scope.durationMs);
     imGuiHelper.Begin();
     for (auto& study : studies) {
       study->onUpdate(vku::UpdateParams{.deltaTime = frameDuration.count(), .win = window, .frameInFlightNo = frameDrawer.frameNo});
-      study->recordCommandBuffer(vc, frameDrawer);
+      {
+        auto s = frameDrawer.profiler.scope(frameDrawer.commandBuffer, study->getName());
+        study->recordCommandBuffer(vc, frameDrawer);
+      }
       // TODO: might need to add some synchronization here. If layer order does not look correct uncomment below line.
       // vku::setImageLayout(frameDrawer.commandBuffer, frameDrawer.image, vc.swapchainColorFormat, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eColorAttachmentOptimal);
       // or
@@ -61,17 +96,67 @@ int StudyRunner::run() {
     if (showDemoWindow)
       imGuiHelper.ShowDemoWindow();
     ImGui::Text("frame Dur: %.2f ms, FPS: %1.f", frameDuration.count() * 1'000, 1.0f / frameDuration.count());
+    ImGui::Text("GPU frame Dur: %.2f ms", gpuFrameDurationMs);
+    ImGui::Text("Input latency (until GPU done): %.2f ms", inputLatencyMs);
+    // Swapchain is recreated after drawFrameEnd(), since this frame's FrameDrawer refers to the current one's images
+    std::optional<std::pair<uint32_t, vk::PresentModeKHR>> newSwapchainSettings;
+    if (ImGui::CollapsingHeader("Presentation")) {
+      if (ImGui::BeginCombo("Present mode", vk::to_string(vc.swapchainPresentMode).c_str())) {
+        for (const vk::PresentModeKHR mode : vc.supportedPresentModes)
+          if (ImGui::Selectable(vk::to_string(mode).c_str(), mode == vc.swapchainPresentMode))
+            newSwapchainSettings = {vc.appSettings.numSwapchainImages, mode};
+        ImGui::EndCombo();
+      }
+      int numImages = static_cast<int>(vc.appSettings.numSwapchainImages);
+      if (ImGui::SliderInt("Swapchain images", &numImages, static_cast<int>(vc.swapchainMinImageCount), static_cast<int>(vc.swapchainMaxImageCount)))
+        newSwapchainSettings = {static_cast<uint32_t>(numImages), vc.appSettings.presentMode};
+      ImGui::Text("(created with %zu)", vc.swapchainImages.size());
+      int numFramesInFlight = static_cast<int>(vc.appSettings.numFramesInFlight);
+      if (ImGui::SliderInt("Frames in flight", &numFramesInFlight, 1, vc.MAX_FRAMES_IN_FLIGHT))
+        vc.setNumFramesInFlight(static_cast<uint32_t>(numFramesInFlight));
+    }
+    ImGui::Text("Shader cache: %u hits, %u misses, %.1f ms compiling", shaderCacheStats.numHits, shaderCacheStats.numMisses, shaderCacheStats.compileMs);
+    const vku::AllocatorStats memStats = vc.allocator.getStats();
+    ImGui::Text("Device memory: %.1f / %.1f MB in %u blocks, %u allocations, fragmentation: %.0f%%", memStats.bytesUsed / 1048576.f, memStats.bytesReserved / 1048576.f, memStats.numBlocks, memStats.numAllocations, memStats.fragmentation * 100.f);
+    const vku::BindlessHeapStats heapStats = vc.bindlessHeap.getStats();
+    ImGui::Text("Bindless heap: %u / %u storage buffers, %u / %u sampled images", heapStats.numStorageBuffers, heapStats.storageBufferCapacity, heapStats.numSampledImages, heapStats.sampledImageCapacity);
+    if (vc.gpuProfiler.isSupported() && ImGui::BeginTable("GPU Scopes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+      ImGui::TableSetupColumn("GPU scope");
+      ImGui::TableSetupColumn("ms");
+      ImGui::TableSetupColumn("avg ms");
+      ImGui::TableHeadersRow();
+      for (const auto& scope : vc.gpuProfiler.getLatestResults()) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%*s%s", static_cast<int>(2 * scope.depth), "", scope.name.c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", scope.durationMs);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", scope.averageMs);
+      }
+      ImGui::EndTable();
+      if (ImGui::Button("Export GPU timings"))
+        vc.gpuProfiler.writeCSV("gpu_timings.csv");
+    }
     ImGui::End();
 
     imGuiHelper.End();
     // A final render pass for ImGui draw commands
-    const vk::RenderPassBeginInfo renderPassBeginInfo(*vc.renderPass, *frameDrawer.framebuffer, vk::Rect2D{{0, 0}, vc.swapchainExtent}, {});
-    frameDrawer.commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-    imGuiHelper.AddDrawCalls(*frameDrawer.commandBuffer);
-    frameDrawer.commandBuffer.endRenderPass();
+    {
+      auto s = frameDrawer.profiler.scope(frameDrawer.commandBuffer, "ImGui");
+      const vk::RenderPassBeginInfo renderPassBeginInfo(*vc.renderPass, *frameDrawer.framebuffer, vk::Rect2D{{0, 0}, vc.swapchainExtent}, {});
+      frameDrawer.commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+      imGuiHelper.AddDrawCalls(*frameDrawer.commandBuffer);
+      frameDrawer.commandBuffer.endRenderPass();
+    }
 
     vc.drawFrameEnd(frameDrawer);
-    frameDuration = std::chrono::system_clock::now() - time;
+    if (newSwapchainSettings.has_value())
+      vc.setSwapchainSettings(newSwapchainSettings->first, newSwapchainSettings->second);
+    frameDuration = std::chrono::steady_clock::now() - time;
+    if (appSettings.shouldRecordFrameTimings)
+      cpuFrameDurationsMs.push_back(frameDuration.count() * 1'000);
+    ++numFramesDrawn;
   }
 
   // END
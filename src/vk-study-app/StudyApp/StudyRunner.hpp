@@ -3,7 +3,9 @@
 #include "Study.hpp"
 
 #include <list>
+#include <map>
 #include <memory>
+#include <vector>
 
 namespace vku {
 class StudyRunner {
@@ -11,12 +13,23 @@ class StudyRunner {
   vku::AppSettings appSettings;
   vku::Window window;
   vku::VulkanContext vc;
+  // per-frame durations in milliseconds, recorded only if appSettings.shouldRecordFrameTimings
+  // GPU durations arrive MAX_FRAMES_IN_FLIGHT frames late, hence gpuFrameDurationsMs[i] belongs to frame i too, but the last couple of frames are missing
+  std::vector<float> cpuFrameDurationsMs;
+  std::vector<float> gpuFrameDurationsMs;
+  // input sampling to GPU done latency of frames, arrives late like GPU durations. See VulkanContext::retiredFrameInputLatencyMs
+  std::vector<float> inputLatenciesMs;
+  // per-scope GPU durations from GpuProfiler, keyed by scope path
+  std::map<std::string, std::vector<float>> gpuScopeDurationsMs;
 
  private:
   std::list<std::unique_ptr<vku::Study>> studies;
 
  public:
   StudyRunner();
+  StudyRunner(const vku::AppSettings& appSettings);
+
+  static vku::AppSettings getDefaultAppSettings();
 
   std::unique_ptr<vku::Study>& pushStudy(std::unique_ptr<vku::Study> study);
   void popStudy(const std::unique_ptr<vku::Study>& study);
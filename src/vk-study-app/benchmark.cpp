@@ -0,0 +1,284 @@
+#include "StudyApp/Benchmark.hpp"
+#include "StudyApp/StudyRunner.hpp"
+#include "studies/07-TransformsCompute.hpp"
+#include "studies/StudyRegistry.hpp"
+#include "vku/Math.hpp"
+#include "vku/Model.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Micro-benchmark of loadOBJ's vertex deduplication methods on given OBJ file. tinyobjloader parse time is reported separately since it is the same for all.
+static int runOBJImportBenchmark(const std::string& objPath, uint32_t numIterations) {
+  struct Method {
+    const char* name;
+    vku::OBJDedup dedup;
+  };
+  const Method methods[] = {
+      {"unordered_map", vku::OBJDedup::UnorderedMap},
+      {"flat table", vku::OBJDedup::FlatTable},
+      {"flat table per shape MT", vku::OBJDedup::FlatTablePerShapeParallel},
+  };
+
+  std::cout << std::format("{:<24} {:>10} {:>10} | {:>10} | {:>10} {:>10} {:>8}\n", "dedup (ms)", "vertices", "indices", "parse med", "build min", "build med", "speedup");
+  vku::DefaultMeshData baseline;
+  float baselineBuildMs = 0;
+  for (const Method& method : methods) {
+    std::vector<float> parseMs, buildMs;
+    vku::DefaultMeshData meshData;
+    for (uint32_t i = 0; i < numIterations; ++i) {
+      vku::LoadOBJStats stats;
+      meshData = vku::loadOBJ(objPath, {.dedup = method.dedup}, &stats);
+      parseMs.push_back(stats.parseMs);
+      buildMs.push_back(stats.buildMs);
+    }
+    const vku::TimingSummary parse = vku::summarizeTimings(parseMs);
+    const vku::TimingSummary build = vku::summarizeTimings(buildMs);
+    if (method.dedup == vku::OBJDedup::UnorderedMap) {
+      baseline = meshData;
+      baselineBuildMs = build.median;
+    } else if (method.dedup == vku::OBJDedup::FlatTable && (meshData.indices != baseline.indices || meshData.vertices.size() != baseline.vertices.size())) {
+      // serial flat table has to produce exactly the same mesh
+      std::cerr << "flat table output differs from unordered_map output\n";
+      return 1;
+    }
+    std::cout << std::format("{:<24} {:>10} {:>10} | {:>10.3f} | {:>10.3f} {:>10.3f} {:>7.2f}x\n", method.name, meshData.vertices.size(), meshData.indices.size(), parse.median, build.min, build.median,
+                             build.median > 0 ? baselineBuildMs / build.median : 0.f);
+  }
+  return 0;
+}
+
+// Times procedural generators at doubling tessellations. Linear generators keep ns/triangle roughly constant as the triangle count quadruples.
+static int runProceduralBenchmark() {
+  struct Generator {
+    const char* name;
+    std::function<vku::DefaultMeshData(uint32_t segments, bool allowParallel)> make;
+  };
+  const Generator generators[] = {
+      {"torus", [](uint32_t n, bool allowParallel) { return vku::makeTorus(1.f, n, .5f, n, allowParallel); }},
+      {"sphere", [](uint32_t n, bool allowParallel) { return vku::makeSphere(1.f, n, n, allowParallel); }},
+      {"grid", [](uint32_t n, bool allowParallel) { return vku::makeGrid({1, 1}, n, n, allowParallel); }},
+  };
+
+  std::cout << std::format("{:<8} {:>9} {:>12} | {:>10} {:>10} | {:>10} {:>10}\n", "mesh", "segments", "triangles", "serial ms", "ns/tri", "MT ms", "ns/tri");
+  for (const Generator& generator : generators) {
+    for (uint32_t segments = 64; segments <= 2048; segments *= 2) {
+      float durationsMs[2]{};
+      size_t numTriangles = 0;
+      for (const bool allowParallel : {false, true}) {
+        const auto start = std::chrono::steady_clock::now();
+        const vku::DefaultMeshData meshData = generator.make(segments, allowParallel);
+        durationsMs[allowParallel] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        numTriangles = meshData.indices.size() / 3;
+      }
+      std::cout << std::format("{:<8} {:>9} {:>12} | {:>10.2f} {:>10.2f} | {:>10.2f} {:>10.2f}\n", generator.name, segments, numTriangles, durationsMs[0], durationsMs[0] * 1e6f / numTriangles, durationsMs[1],
+                               durationsMs[1] * 1e6f / numTriangles);
+    }
+  }
+  return 0;
+}
+
+// Compares per-entity glm path (getTransform() + transpose(inverse())) against batched vku::buildTransforms, from a span of Transforms and from TransformsSoA
+static int runTransformsBenchmark() {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> unit(-1.f, 1.f);
+  std::uniform_real_distribution<float> positiveScale(0.25f, 4.f);
+
+  std::cout << std::format("{:>9} | {:>10} {:>10} | {:>10} {:>10} {:>8} | {:>10} {:>10} {:>8} | {:>9}\n", "entities", "glm ms", "ns/ent", "span ms", "ns/ent", "speedup", "SoA ms", "ns/ent", "speedup", "max err");
+  for (const uint32_t numEntities : {10'000u, 100'000u, 1'000'000u}) {
+    std::vector<vku::Transform> transforms;
+    transforms.reserve(numEntities);
+    for (uint32_t i = 0; i < numEntities; ++i)
+      transforms.emplace_back(glm::vec3{unit(rng), unit(rng), unit(rng)} * 100.f, glm::normalize(glm::vec3{unit(rng), unit(rng), unit(rng)} + glm::vec3{0, 0, 2}), unit(rng) * std::numbers::pi_v<float>,
+                              glm::vec3{positiveScale(rng), positiveScale(rng), positiveScale(rng)});
+    vku::TransformsSoA soa;
+    soa.assign(transforms);
+    std::vector<vku::TransformMatrices> reference(numEntities), batched(numEntities);
+
+    // best of a few runs, to not measure page faults of the first write to the output
+    auto time = [](const std::function<void()>& func) {
+      float bestMs = std::numeric_limits<float>::max();
+      for (int run = 0; run < 5; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        bestMs = std::min(bestMs, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+      }
+      return bestMs;
+    };
+    const float glmMs = time([&]() {
+      for (uint32_t i = 0; i < numEntities; ++i) {
+        reference[i].worldFromObject = transforms[i].getTransform();
+        reference[i].dualWorldFromObject = glm::transpose(glm::inverse(reference[i].worldFromObject));
+      }
+    });
+    const float spanMs = time([&]() { vku::buildTransforms(transforms, batched); });
+    const float soaMs = time([&]() { vku::buildTransforms(soa, batched); });
+
+    float maxError = 0.f;
+    for (uint32_t i = 0; i < numEntities; ++i)
+      for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+          maxError = std::max({maxError, std::abs(reference[i].worldFromObject[c][r] - batched[i].worldFromObject[c][r]), std::abs(reference[i].dualWorldFromObject[c][r] - batched[i].dualWorldFromObject[c][r])});
+    auto nsPerEntity = [numEntities](float ms) { return ms * 1e6f / numEntities; };
+    std::cout << std::format("{:>9} | {:>10.3f} {:>10.2f} | {:>10.3f} {:>10.2f} {:>7.2f}x | {:>10.3f} {:>10.2f} {:>7.2f}x | {:>9.2e}\n", numEntities, glmMs, nsPerEntity(glmMs), spanMs, nsPerEntity(spanMs), glmMs / spanMs, soaMs,
+                             nsPerEntity(soaMs), glmMs / soaMs, maxError);
+  }
+  return 0;
+}
+
+// 07-TransformsCompute with different transform compute workgroup sizes
+static std::vector<StudyEntry> makeLocalSizeSweepEntries() {
+  std::vector<StudyEntry> entries;
+  for (const uint32_t localSize : {32u, 64u, 128u, 256u})
+    entries.push_back({std::format("07-TransformsCompute-ls{}", localSize), [localSize]() -> std::unique_ptr<vku::Study> { return std::make_unique<TransformGPUConstructionStudy>(localSize); }});
+  return entries;
+}
+
+// Runs every registered Study (or the ones given via --study) for a fixed number of frames, and reports frame time statistics.
+// Usage: Benchmarks [--warmup N] [--frames N] [--study ID]... [--windowed] [--csv PATH] [--json PATH] [--list]
+//                   [--present-mode fifo|fifo-relaxed|mailbox|immediate] [--images N] [--frames-in-flight N]
+//        Benchmarks --obj PATH [--iterations N]  (OBJ import micro-benchmark instead of studies)
+//        Benchmarks --procedural  (procedural mesh generation micro-benchmark instead of studies)
+//        Benchmarks --transforms  (CPU model matrix construction micro-benchmark instead of studies)
+//        Benchmarks --local-size-sweep [--warmup N] [--frames N]  (07-TransformsCompute with workgroup sizes 32, 64, 128, 256 instead of registered studies)
+int main(int argc, char* argv[]) {
+  uint32_t numWarmupFrames = 60;
+  uint32_t numMeasuredFrames = 500;
+  bool isWindowed = false;
+  std::vector<std::string> selectedIds;
+  std::string csvPath = "benchmark.csv";
+  std::string jsonPath = "benchmark.json";
+  std::string objPath;
+  uint32_t numObjIterations = 10;
+  bool shouldSweepLocalSizes = false;
+  // presentation settings of every study run
+  vku::AppSettings presentationSettings;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--warmup" && hasValue)
+      numWarmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else if (arg == "--frames" && hasValue)
+      numMeasuredFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else if (arg == "--study" && hasValue)
+      selectedIds.emplace_back(argv[++i]);
+    else if (arg == "--windowed")
+      isWindowed = true;
+    else if (arg == "--csv" && hasValue)
+      csvPath = argv[++i];
+    else if (arg == "--json" && hasValue)
+      jsonPath = argv[++i];
+    else if (arg == "--obj" && hasValue)
+      objPath = argv[++i];
+    else if (arg == "--iterations" && hasValue)
+      numObjIterations = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+    else if (arg == "--procedural")
+      return runProceduralBenchmark();
+    else if (arg == "--transforms")
+      return runTransformsBenchmark();
+    else if (arg == "--local-size-sweep")
+      shouldSweepLocalSizes = true;
+    else if (arg == "--present-mode" && hasValue) {
+      const auto presentMode = vku::parsePresentMode(argv[++i]);
+      if (!presentMode.has_value()) {
+        std::cerr << std::format("Unknown present mode: {}\n", argv[i]);
+        return 1;
+      }
+      presentationSettings.presentMode = presentMode.value();
+    } else if (arg == "--images" && hasValue)
+      presentationSettings.numSwapchainImages = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else if (arg == "--frames-in-flight" && hasValue)
+      presentationSettings.numFramesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else if (arg == "--list") {
+      for (const auto& entry : getRegisteredStudies())
+        std::cout << entry.id << '\n';
+      return 0;
+    } else {
+      std::cerr << std::format("Unknown argument: {}\n", arg);
+      return 1;
+    }
+  }
+  if (!objPath.empty())
+    return runOBJImportBenchmark(objPath, numObjIterations);
+  if (numMeasuredFrames == 0) {
+    std::cerr << "--frames has to be non-zero\n";
+    return 1;
+  }
+
+  const std::vector<StudyEntry> entries = shouldSweepLocalSizes ? makeLocalSizeSweepEntries() : getRegisteredStudies();
+  std::vector<vku::BenchmarkResult> results;
+  for (const auto& entry : entries) {
+    if (!selectedIds.empty() && std::ranges::find(selectedIds, entry.id) == selectedIds.end())
+      continue;
+
+    vku::AppSettings appSettings = vku::StudyRunner::getDefaultAppSettings();
+    appSettings.isHeadless = !isWindowed;
+    appSettings.numFrames = numWarmupFrames + numMeasuredFrames;
+    appSettings.shouldRecordFrameTimings = true;
+    appSettings.presentMode = presentationSettings.presentMode;
+    appSettings.numSwapchainImages = presentationSettings.numSwapchainImages;
+    appSettings.numFramesInFlight = presentationSettings.numFramesInFlight;
+
+    vku::BenchmarkResult result{.id = entry.id, .numWarmupFrames = numWarmupFrames};
+    // A fresh runner (and VulkanContext) per Study, so that one Study's resources do not affect the next one's numbers
+    {
+      vku::StudyRunner sr{appSettings};
+      result.name = sr.pushStudy(entry.make())->getName();
+      sr.run();
+
+      auto dropWarmup = [numWarmupFrames](const std::vector<float>& samples) {
+        return samples.size() > numWarmupFrames ? std::vector<float>(samples.begin() + numWarmupFrames, samples.end()) : std::vector<float>{};
+      };
+      result.cpuFrameDurationsMs = dropWarmup(sr.cpuFrameDurationsMs);
+      result.gpuFrameDurationsMs = dropWarmup(sr.gpuFrameDurationsMs);
+      result.inputLatency = vku::summarizeTimings(dropWarmup(sr.inputLatenciesMs));
+      for (const auto& [path, samples] : sr.gpuScopeDurationsMs)
+        result.gpuScopes.emplace_back(path, vku::summarizeTimings(dropWarmup(samples)));
+    }
+    result.cpu = vku::summarizeTimings(result.cpuFrameDurationsMs);
+    result.gpu = vku::summarizeTimings(result.gpuFrameDurationsMs);
+    results.push_back(std::move(result));
+  }
+
+  std::cout << std::format("\n{:<22} {:>5} | {:>8} {:>8} {:>8} {:>8} {:>8} | {:>8} {:>8} {:>8} {:>8} {:>8}\n", "study (ms)", "n", "cpu min", "median", "p95", "p99", "max", "gpu min", "median", "p95", "p99", "max");
+  for (const auto& r : results) {
+    const auto& c = r.cpu;
+    const auto& g = r.gpu;
+    std::cout << std::format("{:<22} {:>5} | {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f} | {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f}\n", r.id, c.count, c.min, c.median, c.p95, c.p99, c.max, g.min, g.median, g.p95, g.p99, g.max);
+  }
+
+  std::cout << std::format("\n{:<22} | {:>8} {:>8} {:>8} {:>8}\n", "input latency (ms)", "min", "median", "p95", "max");
+  for (const auto& r : results) {
+    const auto& l = r.inputLatency;
+    std::cout << std::format("{:<22} | {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f}\n", r.id, l.min, l.median, l.p95, l.max);
+  }
+
+  if (shouldSweepLocalSizes) {
+    std::cout << std::format("\n{:<30} | {:>8} {:>8} {:>8} {:>8}\n", "monkey compute dispatch (ms)", "min", "median", "p95", "max");
+    for (const auto& r : results) {
+      const auto it = std::ranges::find_if(r.gpuScopes, [](const auto& scope) { return scope.first.ends_with("/monkey compute"); });
+      if (it == r.gpuScopes.end()) {
+        std::cout << std::format("{:<30} | no timestamps\n", r.id);
+        continue;
+      }
+      const vku::TimingSummary& d = it->second;
+      std::cout << std::format("{:<30} | {:>8.4f} {:>8.4f} {:>8.4f} {:>8.4f}\n", r.id, d.min, d.median, d.p95, d.max);
+    }
+  }
+
+  vku::writeBenchmarkResultsCSV(csvPath, results);
+  vku::writeBenchmarkResultsJSON(jsonPath, results);
+  std::cout << std::format("\nWrote {} and {}\n", csvPath, jsonPath);
+  return 0;
+}
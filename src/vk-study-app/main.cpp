@@ -9,10 +9,33 @@
 #include "studies/07-TransformsCompute.hpp"
 #include "studies/08-Outlines.hpp"
 
+#include <iostream>
 #include <string>
+#include <string_view>
 
-int main() {
-  vku::StudyRunner sr;
+// Usage: Studies [--headless --frames N] [--present-mode fifo|fifo-relaxed|mailbox|immediate] [--images N] [--frames-in-flight N]
+int main(int argc, char* argv[]) {
+  vku::AppSettings appSettings = vku::StudyRunner::getDefaultAppSettings();
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--headless")
+      appSettings.isHeadless = true;
+    else if (arg == "--frames" && i + 1 < argc)
+      appSettings.numFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else if (arg == "--present-mode" && i + 1 < argc) {
+      const auto presentMode = vku::parsePresentMode(argv[++i]);
+      if (!presentMode.has_value()) {
+        std::cerr << "Unknown present mode: " << argv[i] << '\n';
+        return 1;
+      }
+      appSettings.presentMode = presentMode.value();
+    } else if (arg == "--images" && i + 1 < argc)
+      appSettings.numSwapchainImages = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else if (arg == "--frames-in-flight" && i + 1 < argc)
+      appSettings.numFramesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+  }
+
+  vku::StudyRunner sr{appSettings};
   [[maybe_unused]] auto& study0 = sr.pushStudy(std::make_unique<ClearStudy>());
   // sr.pushStudy(std::make_unique<FirstStudy>());
   // sr.pushStudy(std::make_unique<SecondStudy>());
@@ -37,8 +37,9 @@ layout (location = 0) out vec4 outColor;
 void main () { outColor = vec4 (fragColor, 1.0); }
 )";
 
-  vk::raii::ShaderModule vertexShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eVertex, vertexShaderStr);
-  vk::raii::ShaderModule fragmentShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eFragment, fragmentShaderStr);
+  const std::vector<vk::raii::ShaderModule> shaderModules = vku::spirv::makeShaderModules(vc.device, vertexShaderStr, fragmentShaderStr);
+  const vk::raii::ShaderModule& vertexShader = shaderModules[0];
+  const vk::raii::ShaderModule& fragmentShader = shaderModules[1];
   std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos = {
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertexShader, "main"),
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragmentShader, "main")};
@@ -117,7 +118,7 @@ void main () { outColor = vec4 (fragColor, 1.0); }
       //{}, // uint32_t subpass_ = {},
   );
 
-  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, nullptr, graphicsPipelineCreateInfo);
+  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, vc.pipelineCache, graphicsPipelineCreateInfo);
   assert(pipeline->getConstructorSuccessCode() == vk::Result::eSuccess);
 }
 
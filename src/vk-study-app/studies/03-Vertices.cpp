@@ -84,8 +84,9 @@ void main()
 }
 )";
 
-  vk::raii::ShaderModule vertexShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eVertex, vertexShaderStr);
-  vk::raii::ShaderModule fragmentShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eFragment, fragmentShaderStr);
+  const std::vector<vk::raii::ShaderModule> shaderModules = vku::spirv::makeShaderModules(vc.device, vertexShaderStr, fragmentShaderStr);
+  const vk::raii::ShaderModule& vertexShader = shaderModules[0];
+  const vk::raii::ShaderModule& fragmentShader = shaderModules[1];
   std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos = {
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertexShader, "main"),
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragmentShader, "main")};
@@ -168,7 +169,7 @@ void main()
       //{}, // uint32_t subpass_ = {},
   );
 
-  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, nullptr, graphicsPipelineCreateInfo);
+  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, vc.pipelineCache, graphicsPipelineCreateInfo);
   assert(pipeline->getConstructorSuccessCode() == vk::Result::eSuccess);
 }
 
@@ -1,5 +1,6 @@
 #include "04-Uniforms.hpp"
 
+#include "../vku/MeshFile.hpp"
 #include "../vku/Model.hpp"
 #include "../vku/SpirvHelper.hpp"
 #include "../vku/utils.hpp"
@@ -21,9 +22,10 @@ void UniformsStudy::onInit(const vku::AppSettings appSettings, const vku::Vulkan
   vku::DefaultMeshData torusMeshData = vku::makeTorus(1.f, 17, .5f, 6);
   vku::DefaultMeshData quadMeshData = vku::makeQuad({1, 1});
   // TODO: do not hard-code absolute paths, instead have a global "assets root folder"
-  vku::DefaultMeshData objMeshData = vku::loadOBJ(vku::assetsRootFolder / "models/suzanne.obj");
+  // vertices and indices are views into the memory mapped mesh file, Buffer copies them straight into staging memory
+  vku::MappedMesh objMesh = vku::loadOBJCached(vku::assetsRootFolder / "models/suzanne.obj");
 
-  vku::DefaultMeshData& md = objMeshData;
+  const vku::MappedMesh& md = objMesh;
 
   uint32_t vboSizeBytes = (uint32_t)(md.vertices.size() * sizeof(vku::DefaultVertex));
   vbo = vku::Buffer(vc, md.vertices.data(), vboSizeBytes, vk::BufferUsageFlagBits::eVertexBuffer);
@@ -106,8 +108,9 @@ void main()
 }
 )";
 
-  vk::raii::ShaderModule vertexShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eVertex, vertexShaderStr);
-  vk::raii::ShaderModule fragmentShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eFragment, fragmentShaderStr);
+  const std::vector<vk::raii::ShaderModule> shaderModules = vku::spirv::makeShaderModules(vc.device, vertexShaderStr, fragmentShaderStr);
+  const vk::raii::ShaderModule& vertexShader = shaderModules[0];
+  const vk::raii::ShaderModule& fragmentShader = shaderModules[1];
   std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos = {
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertexShader, "main"),
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragmentShader, "main")};
@@ -186,7 +189,7 @@ void main()
       //{}, // uint32_t subpass_ = {},
   );
 
-  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, nullptr, graphicsPipelineCreateInfo);
+  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, vc.pipelineCache, graphicsPipelineCreateInfo);
   assert(pipeline->getConstructorSuccessCode() == vk::Result::eSuccess);
 }
 
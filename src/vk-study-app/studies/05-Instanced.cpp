@@ -1,5 +1,6 @@
 #include "05-Instanced.hpp"
 
+#include "../vku/MeshFile.hpp"
 #include "../vku/Model.hpp"
 #include "../vku/SpirvHelper.hpp"
 #include "../vku/utils.hpp"
@@ -24,11 +25,12 @@ void InstancingStudy::onInit(const vku::AppSettings appSettings, const vku::Vulk
   vku::DefaultMeshData torusMeshData = vku::makeTorus(1.f, 17, .5f, 6);
   vku::DefaultMeshData quadMeshData = vku::makeQuad({1, 1});
   vku::DefaultMeshData axesMeshData = vku::makeAxes();
-  vku::DefaultMeshData objMeshData = vku::loadOBJ(vku::assetsRootFolder / "models/suzanne.obj");
+  vku::MappedMesh objMesh = vku::loadOBJCached(vku::assetsRootFolder / "models/suzanne.obj");
 
-  vku::DefaultMeshData& md = objMeshData;
+  // Vertex fetch is a big part of drawing 50K monkeys. 16 byte CompactVertex instead of 48 byte DefaultVertex
+  const vku::CompactMeshData md = vku::makeCompactMeshData(objMesh.vertices, objMesh.indices);
 
-  uint32_t vboSizeBytes = (uint32_t)(md.vertices.size() * sizeof(vku::DefaultVertex));
+  uint32_t vboSizeBytes = (uint32_t)(md.vertices.size() * sizeof(vku::CompactVertex));
   vbo = vku::Buffer(vc, md.vertices.data(), vboSizeBytes, vk::BufferUsageFlagBits::eVertexBuffer);
 
   uint32_t iboSizeBytes = (uint32_t)(md.indices.size() * sizeof(uint32_t));
@@ -62,6 +64,9 @@ void InstancingStudy::onInit(const vku::AppSettings appSettings, const vku::Vulk
   // create UBOs and connect them to a Uniforms instance
   for (int i = 0; i < vc.MAX_FRAMES_IN_FLIGHT; i++) {
     ubos.emplace_back<vku::UniformBuffer<Uniforms>>(vc);
+    // do not change per frame
+    ubos.back().src.positionOffset = glm::vec4{md.bounds.offset, 0};
+    ubos.back().src.positionScale = glm::vec4{md.bounds.scale, 0};
 
     //---- Descriptor Set
     vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo(*vc.descriptorPool, 1, &(*descriptorSetLayout));
@@ -84,10 +89,10 @@ void InstancingStudy::onInit(const vku::AppSettings appSettings, const vku::Vulk
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
 
-// Vertex attributes
-layout (location = 0) in vec3 inObjectPosition;
+// Vertex attributes (vku::CompactVertex)
+layout (location = 0) in vec4 inQuantizedPosition; // unorm16 within mesh bounds, w is unused
 layout (location = 1) in vec2 inTexCoord;
-layout (location = 2) in vec3 inObjectNormal;
+layout (location = 2) in vec2 inOctahedralNormal;
 layout (location = 3) in vec4 inColor;
 
 // Instanced attributes
@@ -100,6 +105,8 @@ layout (binding = 0) uniform UBO
 	mat4 viewFromWorldMatrix;
   mat4 projectionFromViewMatrix;
   mat4 projectionFromWorldMatrix;
+  vec4 positionOffset;
+  vec4 positionScale;
 } ubo;
 
 layout (location = 0) out struct {
@@ -110,8 +117,19 @@ layout (location = 0) out struct {
 } v2f;
 
 
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  const float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
 void main() 
 {
+  const vec3 inObjectPosition = ubo.positionOffset.xyz + inQuantizedPosition.xyz * ubo.positionScale.xyz;
+  const vec3 inObjectNormal = decodeOctahedral(inOctahedralNormal);
+
   const mat4 transform = instanceWorldFromObjectMatrix; // {ubo.WorldFromObjectMatrix, instanceWorldFromObjectMatrix}
   const vec4 worldPosition4 = transform * vec4(inObjectPosition.xyz, 1.0);
   v2f.worldPosition = worldPosition4.xyz;
@@ -153,33 +171,24 @@ void main()
 }
 )";
 
-  vk::raii::ShaderModule vertexShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eVertex, vertexShaderStr);
-  vk::raii::ShaderModule fragmentShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eFragment, fragmentShaderStr);
+  const std::vector<vk::raii::ShaderModule> shaderModules = vku::spirv::makeShaderModules(vc.device, vertexShaderStr, fragmentShaderStr);
+  const vk::raii::ShaderModule& vertexShader = shaderModules[0];
+  const vk::raii::ShaderModule& fragmentShader = shaderModules[1];
   std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos = {
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertexShader, "main"),
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragmentShader, "main")};
 
+  const auto vertexAttributes = vku::CompactVertex::getAttributeDescriptions(0, 0);
+  std::vector<vk::VertexInputAttributeDescription> attributeDescriptions(vertexAttributes.begin(), vertexAttributes.end());
+  // instance attributes: worldFromObject (4 columns), dualWorldFromObject (4 columns), color
+  for (uint32_t i = 0; i < 9; ++i)
+    attributeDescriptions.emplace_back(4 + i, 1, vk::Format::eR32G32B32A32Sfloat, static_cast<uint32_t>(sizeof(glm::vec4) * i));
   vku::VertexInputStateCreateInfo vertexInputStateCreateInfo(
       {
-          {0, sizeof(vku::DefaultVertex), vk::VertexInputRate::eVertex},
+          {0, sizeof(vku::CompactVertex), vk::VertexInputRate::eVertex},
           {1, sizeof(InstanceData), vk::VertexInputRate::eInstance},
       },
-      {{
-          {0, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, position)},
-          {1, 0, vk::Format::eR32G32Sfloat, offsetof(vku::DefaultVertex, texCoord)},
-          {2, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, normal)},
-          {3, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(vku::DefaultVertex, color)},
-
-          {4, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 0},
-          {5, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 1},
-          {6, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 2},
-          {7, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 3},
-          {8, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 4},
-          {9, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 5},
-          {10, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 6},
-          {11, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 7},
-          {12, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 8},
-      }});
+      attributeDescriptions);
 
   vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo({}, vk::PrimitiveTopology::eTriangleList, false);
 
@@ -253,7 +262,7 @@ void main()
                                 //{}, // uint32_t subpass_ = {},
   );
 
-  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, nullptr, graphicsPipelineCreateInfo);
+  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, vc.pipelineCache, graphicsPipelineCreateInfo);
   assert(pipeline->getConstructorSuccessCode() == vk::Result::eSuccess);
 }
 
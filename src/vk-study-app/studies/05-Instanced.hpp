@@ -21,6 +21,9 @@ class InstancingStudy : public vku::Study {
     glm::mat4 viewFromWorld;
     glm::mat4 projectionFromView;
     glm::mat4 projectionFromWorld;
+    // dequantization of CompactVertex positions
+    glm::vec4 positionOffset;
+    glm::vec4 positionScale;
   };
 
  private:
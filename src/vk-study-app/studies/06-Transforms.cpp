@@ -1,5 +1,6 @@
 #include "06-Transforms.hpp"
 
+#include "../vku/MeshFile.hpp"
 #include "../vku/Model.hpp"
 #include "../vku/SpirvHelper.hpp"
 #include "../vku/utils.hpp"
@@ -14,17 +15,16 @@
 #include <glm/gtx/quaternion.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <numbers>
+#include <numeric>
 #include <random>
 #include <ranges>
 #include <string>
 
-TransformConstructionStudy::PushConstants TransformConstructionStudy::Entity::getPushConstants() const {
-  PushConstants pc = TransformConstructionStudy::PushConstants{.worldFromObject = transform.getTransform(), .color = color};
-  pc.dualWorldFromObject = glm::transpose(glm::inverse(pc.worldFromObject));
-  return pc;
-}
+TransformConstructionStudy::TransformConstructionStudy(uint32_t numMonkeys, bool useParallelRecording, bool useAutoInstancing)
+    : numMonkeys(numMonkeys), useParallelRecording(useParallelRecording), useAutoInstancing(useAutoInstancing) {}
 
 void TransformConstructionStudy::onInit(const vku::AppSettings appSettings, const vku::VulkanContext& vc) {
   std::cout << vivid::ansi::lightBlue << "Hi from Vivid at UniformsStudy" << vivid::ansi::reset << std::endl;
@@ -33,11 +33,11 @@ void TransformConstructionStudy::onInit(const vku::AppSettings appSettings, cons
   const vivid::ColorMap cmap = vivid::ColorMap::Preset::Viridis;
   vku::DefaultMeshData boxMeshData = vku::makeBox({0.2f, 0.5f, 0.7f});
   vku::DefaultMeshData axesMeshData = vku::makeAxes();
-  vku::DefaultMeshData objMeshData = vku::loadOBJ(vku::assetsRootFolder / "models/suzanne.obj");
+  vku::MappedMesh objMesh = vku::loadOBJCached(vku::assetsRootFolder / "models/suzanne.obj");
 
   {
     vku::DefaultMeshData allMeshesData;
-    auto insertMeshData = [&](const vku::DefaultMeshData& newMesh) -> Mesh {
+    auto insertMeshData = [&](const auto& newMesh) -> Mesh {
       Mesh mesh = {static_cast<uint32_t>(allMeshesData.indices.size()), static_cast<uint32_t>(newMesh.indices.size())};
       std::ranges::copy(newMesh.vertices, std::back_inserter(allMeshesData.vertices));
       std::ranges::transform(newMesh.indices, std::back_inserter(allMeshesData.indices), [&](uint32_t ix) { return ix + mesh.offset; });
@@ -46,18 +46,27 @@ void TransformConstructionStudy::onInit(const vku::AppSettings appSettings, cons
 
     meshes.emplace_back(insertMeshData(boxMeshData));
     meshes.emplace_back(insertMeshData(axesMeshData));
-    meshes.emplace_back(insertMeshData(objMeshData));
-    entities.emplace_back(meshes[MeshId::Box], vku::Transform{{-2, 0, 0}, {0, 0, 1}, std::numbers::pi_v<float> * 0.f, {1, 1, 1}}, glm::vec4{1, 0, 0, 1});
-    entities.emplace_back(meshes[MeshId::Axes], vku::Transform{{0, 0, 0}, {1, 1, 1}, std::numbers::pi_v<float> * 0.f, {1, 1, 1}}, glm::vec4{1, 1, 1, 1});
+    meshes.emplace_back(insertMeshData(objMesh));
+    entityStore.add(vku::Transform{{-2, 0, 0}, {0, 0, 1}, std::numbers::pi_v<float> * 0.f, {1, 1, 1}}, MeshId::Box, glm::vec4{1, 0, 0, 1});
+    entityStore.add(vku::Transform{{0, 0, 0}, {1, 1, 1}, std::numbers::pi_v<float> * 0.f, {1, 1, 1}}, MeshId::Axes, glm::vec4{1, 1, 1, 1});
 
-    const int numMonkeys = 10;
+    const uint32_t numRingMonkeys = std::min(numMonkeys, 10u);
     const float pi = std::numbers::pi_v<float>;
-    for (int i = 0; i < numMonkeys; ++i) {
-      entities.emplace_back(
-          meshes[MeshId::Monkey],
-          vku::Transform{glm::vec3{std::cos(i * 2.0f * pi / numMonkeys), 0, std::sin(i * 2.0f * pi / numMonkeys)} * 3.0f, {}, 0, glm::vec3{1, 1, 1} * 0.75f},
+    for (uint32_t i = 0; i < numRingMonkeys; ++i) {
+      entityStore.add(
+          vku::Transform{glm::vec3{std::cos(i * 2.0f * pi / numRingMonkeys), 0, std::sin(i * 2.0f * pi / numRingMonkeys)} * 3.0f, {}, 0, glm::vec3{1, 1, 1} * 0.75f},
+          MeshId::Monkey,
           glm::vec4{0, 0, 1, 1});
     }
+    // rest of them (for stressing draw call recording) are spread on a disk around the ring, along a sunflower spiral. They don't move, hence cost nothing per frame after their first upload.
+    const float goldenAngle = pi * (3.0f - std::sqrt(5.0f));
+    for (uint32_t i = 0; i < numMonkeys - numRingMonkeys; ++i) {
+      const float r = 4.5f + std::sqrt(static_cast<float>(i)) * 0.9f;
+      entityStore.add(
+          vku::Transform{glm::vec3{std::cos(i * goldenAngle), 0, std::sin(i * goldenAngle)} * r, {}, 0, glm::vec3{1, 1, 1} * 0.75f},
+          MeshId::Monkey,
+          glm::vec4{0, 0.5f, 1, 1});
+    }
 
     uint32_t vboSizeBytes = (uint32_t)(allMeshesData.vertices.size() * sizeof(vku::DefaultVertex));
     vbo = vku::Buffer(vc, allMeshesData.vertices.data(), vboSizeBytes, vk::BufferUsageFlagBits::eVertexBuffer);
@@ -66,10 +75,17 @@ void TransformConstructionStudy::onInit(const vku::AppSettings appSettings, cons
     indexCount = (uint32_t)allMeshesData.indices.size();
     ibo = vku::Buffer(vc, allMeshesData.indices.data(), iboSizeBytes, vk::BufferUsageFlagBits::eIndexBuffer);
   }
+  entityStore.createBuffers(vc);
+  std::vector<uint32_t> entityIndices(entityStore.size());
+  std::iota(entityIndices.begin(), entityIndices.end(), 0u);
+  entityIndexBuffer = vku::Buffer(vc, entityIndices.data(), static_cast<uint32_t>(entityIndices.size() * sizeof(uint32_t)), vk::BufferUsageFlagBits::eVertexBuffer);
 
   //---- Descriptor Set Layout
-  vk::DescriptorSetLayoutBinding layoutBinding = {0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex};
-  vk::raii::DescriptorSetLayout descriptorSetLayout = vk::raii::DescriptorSetLayout(vc.device, {{}, 1, &layoutBinding});
+  const std::array<vk::DescriptorSetLayoutBinding, 2> layoutBindings = {{
+      {0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex},
+      {1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex},
+  }};
+  vk::raii::DescriptorSetLayout descriptorSetLayout = vk::raii::DescriptorSetLayout(vc.device, {{}, layoutBindings});
 
   //---- Uniform Data
   perFrameData.resize(vc.MAX_FRAMES_IN_FLIGHT);
@@ -92,6 +108,13 @@ void TransformConstructionStudy::onInit(const vku::AppSettings appSettings, cons
     writeDescriptorSet.pBufferInfo = &perFrame.ubo.descriptor;
     writeDescriptorSet.dstBinding = 0;
     vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
+
+    // Binding 1 : Storage buffer of entities, each frame slot has its own copy
+    const vk::DescriptorBufferInfo entitiesDescriptor = entityStore.getDescriptorBufferInfo(i);
+    writeDescriptorSet.descriptorType = vk::DescriptorType::eStorageBuffer;
+    writeDescriptorSet.pBufferInfo = &entitiesDescriptor;
+    writeDescriptorSet.dstBinding = 1;
+    vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
   }
 
   //---- Pipeline
@@ -106,13 +129,21 @@ layout (location = 0) in vec3 inObjectPosition;
 layout (location = 1) in vec2 inTexCoord;
 layout (location = 2) in vec3 inObjectNormal;
 layout (location = 3) in vec4 inColor;
+// Instance attributes
+layout (location = 4) in uint inEntityIx;
 
-layout(push_constant) uniform PushConstants
+struct Entity
 {
 	mat4 worldFromObjectMatrix;
 	mat4 dualWorldFromObjectMatrix;
   vec4 color;
-} pushConstants;
+};
+
+// vku::EntityStore::GPUEntity
+layout (std430, binding = 1) readonly buffer Entities
+{
+  Entity entities[];
+};
 
 
 layout (binding = 0) uniform UBO 
@@ -132,19 +163,20 @@ layout (location = 0) out struct {
 
 void main() 
 {
-  const mat4 transform = pushConstants.worldFromObjectMatrix;
+  const Entity entity = entities[inEntityIx];
+  const mat4 transform = entity.worldFromObjectMatrix;
   const vec4 worldPosition4 = transform * vec4(inObjectPosition.xyz, 1.0);
   v2f.worldPosition = worldPosition4.xyz;
 
-  v2f.worldNormal = mat3(pushConstants.dualWorldFromObjectMatrix) * inObjectNormal;
+  v2f.worldNormal = mat3(entity.dualWorldFromObjectMatrix) * inObjectNormal;
 
   v2f.objectNormal = inObjectNormal;
 
   gl_Position = ubo.projectionFromWorldMatrix * worldPosition4;
 
-  //v2f.color = pushConstants.color;
+  //v2f.color = entity.color;
   //v2f.color = inColor;
-  v2f.color = inColor * pushConstants.color;
+  v2f.color = inColor * entity.color;
 }
 )";
 
@@ -174,8 +206,9 @@ void main()
 }
 )";
 
-  vk::raii::ShaderModule vertexShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eVertex, vertexShaderStr);
-  vk::raii::ShaderModule fragmentShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eFragment, fragmentShaderStr);
+  const std::vector<vk::raii::ShaderModule> shaderModules = vku::spirv::makeShaderModules(vc.device, vertexShaderStr, fragmentShaderStr);
+  const vk::raii::ShaderModule& vertexShader = shaderModules[0];
+  const vk::raii::ShaderModule& fragmentShader = shaderModules[1];
   std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos = {
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertexShader, "main"),
       vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragmentShader, "main")};
@@ -183,12 +216,14 @@ void main()
   vku::VertexInputStateCreateInfo vertexInputStateCreateInfo(
       {
           {0, sizeof(vku::DefaultVertex), vk::VertexInputRate::eVertex},
+          {1, sizeof(uint32_t), vk::VertexInputRate::eInstance},
       },
       {{
           {0, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, position)},
           {1, 0, vk::Format::eR32G32Sfloat, offsetof(vku::DefaultVertex, texCoord)},
           {2, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, normal)},
           {3, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(vku::DefaultVertex, color)},
+          {4, 1, vk::Format::eR32Uint, 0},
       }});
 
   vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo({}, vk::PrimitiveTopology::eTriangleList, false);
@@ -243,10 +278,8 @@ void main()
   std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
   vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo({}, dynamicStates);
 
-  vk::PushConstantRange pushConstant{vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstants)};
   vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo;
   pipelineLayoutCreateInfo.setSetLayouts(*descriptorSetLayout);
-  pipelineLayoutCreateInfo.setPushConstantRanges(pushConstant);
   pipelineLayout = {vc.device, pipelineLayoutCreateInfo};  // { flags, descriptorSetLayout }
 
   vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
@@ -266,7 +299,7 @@ void main()
                                 //{}, // uint32_t subpass_ = {},
   );
 
-  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, nullptr, graphicsPipelineCreateInfo);
+  pipeline = std::make_unique<vk::raii::Pipeline>(vc.device, vc.pipelineCache, graphicsPipelineCreateInfo);
   assert(pipeline->getConstructorSuccessCode() == vk::Result::eSuccess);
 }
 
@@ -274,49 +307,66 @@ void TransformConstructionStudy::onUpdate(const vku::UpdateParams& params) {
   static float t = 0.0f;
 
   ImGui::Begin("Scene");
-  ImGui::Text("Entities");
+  ImGui::Text("Entities: %zu", entityStore.size());
+  ImGui::Checkbox("Auto Instancing", &useAutoInstancing);
+  if (useAutoInstancing)
+    ImGui::Text("Draw calls: %zu", renderQueue.getBatches().size());
+  else
+    ImGui::Checkbox("Parallel Recording", &useParallelRecording);
   static bool isBoxInteractive = false;
   ImGui::Checkbox("Interactive Box", &isBoxInteractive);
   if (isBoxInteractive) {
-    ImGui::DragFloat3("Box Pos", glm::value_ptr(entities[0].transform.position));
+    glm::vec3 boxPos = entityStore.getPosition(0);
+    if (ImGui::DragFloat3("Box Pos", glm::value_ptr(boxPos)))
+      entityStore.setPosition(0, boxPos);
   } else {
     static float r = 2.0f;
     float theta = t * 0.5f;
     float sx = r * std::cos(theta);
     float sy = r * std::sin(theta);
-    entities[0].transform.position = glm::vec3{
-                                         glm::perlin(glm::vec3{sx, sy, -2}),
-                                         glm::perlin(glm::vec3{sx, sy, 0}),
-                                         glm::perlin(glm::vec3{sx, sy, 2})} *
-                                     3.0f;
+    entityStore.setPosition(0, glm::vec3{
+                                   glm::perlin(glm::vec3{sx, sy, -2}),
+                                   glm::perlin(glm::vec3{sx, sy, 0}),
+                                   glm::perlin(glm::vec3{sx, sy, 2})} *
+                                   3.0f);
+  }
+  glm::vec3 axesPos = entityStore.getPosition(1);
+  if (ImGui::DragFloat3("Axes Pos", glm::value_ptr(axesPos)))
+    entityStore.setPosition(1, axesPos);
+  if (numMonkeys > 0) {
+    glm::vec3 monkeyPos = entityStore.getPosition(2);
+    if (ImGui::DragFloat3("Monkey Pos", glm::value_ptr(monkeyPos)))
+      entityStore.setPosition(2, monkeyPos);
   }
-  ImGui::DragFloat3("Axes Pos", glm::value_ptr(entities[1].transform.position));
-  ImGui::DragFloat3("Monkey Pos", glm::value_ptr(entities[2].transform.position));
 
+  // axes and the ring of monkeys look at the box, the rest of the monkeys are static
+  const uint32_t numTurning = 2 + std::min(numMonkeys, 10u);
+  const glm::vec3 boxPos = entityStore.getPosition(0);
   static bool shouldTurnInstantly = true;
   ImGui::Checkbox("Instant Turn", &shouldTurnInstantly);
   const glm::vec3 up{0, 1, 0};
   if (shouldTurnInstantly) {
-    for (size_t ix = 1; ix < entities.size(); ++ix) {
-      const glm::quat targetRotation = glm::normalize(glm::quatLookAt(entities[ix].transform.position - entities[0].transform.position, up));
-      entities[ix].transform.rotation = targetRotation;
+    for (uint32_t ix = 1; ix < numTurning; ++ix) {
+      const glm::quat targetRotation = glm::normalize(glm::quatLookAt(entityStore.getPosition(ix) - boxPos, up));
+      entityStore.setRotation(ix, targetRotation);
     }
   } else {
     static float turningSpeed = 2.5f;
     ImGui::SliderFloat("Turning Speed", &turningSpeed, 0.0f, 10.0f);
     float maxAngle = turningSpeed * params.deltaTime;
     ImGui::Text("maxAngle: %f", maxAngle);
-    for (size_t ix = 1; ix < entities.size(); ++ix) {
-      const glm::quat targetRotation = glm::normalize(glm::quatLookAt(entities[ix].transform.position - entities[0].transform.position, up));
-      entities[ix].transform.rotation = vku::rotateTowards(entities[ix].transform.rotation, targetRotation, maxAngle);
+    for (uint32_t ix = 1; ix < numTurning; ++ix) {
+      const glm::quat targetRotation = glm::normalize(glm::quatLookAt(entityStore.getPosition(ix) - boxPos, up));
+      entityStore.setRotation(ix, vku::rotateTowards(entityStore.getRotation(ix), targetRotation, maxAngle));
     }
   }
 
-  ImGui::Text("Axes Rot (Quat) {%.1f, %.1f, %.1f, %.1f}, norm: %.2f", entities[1].transform.rotation.x, entities[1].transform.rotation.y, entities[1].transform.rotation.z, entities[1].transform.rotation.w, glm::length(entities[1].transform.rotation));
-  const glm::vec3 axis = glm::axis(entities[1].transform.rotation);
-  ImGui::Text("Axes Rot (AA) %.1f, {%.1f, %.1f, %.1f}", glm::angle(entities[1].transform.rotation), axis.x, axis.y, axis.z);
-  const glm::vec3 euler = glm::eulerAngles(entities[1].transform.rotation);
-  ImGui::Text("Axes Rot (Euler) {%.1f, %.1f, %.1f}", glm::angle(entities[1].transform.rotation), euler.x, euler.y, euler.z);
+  const glm::quat axesRot = entityStore.getRotation(1);
+  ImGui::Text("Axes Rot (Quat) {%.1f, %.1f, %.1f, %.1f}, norm: %.2f", axesRot.x, axesRot.y, axesRot.z, axesRot.w, glm::length(axesRot));
+  const glm::vec3 axis = glm::axis(axesRot);
+  ImGui::Text("Axes Rot (AA) %.1f, {%.1f, %.1f, %.1f}", glm::angle(axesRot), axis.x, axis.y, axis.z);
+  const glm::vec3 euler = glm::eulerAngles(axesRot);
+  ImGui::Text("Axes Rot (Euler) {%.1f, %.1f, %.1f}", glm::angle(axesRot), euler.x, euler.y, euler.z);
   ImGui::Separator();
 
   ImGui::Text("Camera");
@@ -340,29 +390,72 @@ void TransformConstructionStudy::onUpdate(const vku::UpdateParams& params) {
   perFrameData[params.frameInFlightNo].ubo.update();  // don't forget to call update after uniform data changes
   t += params.deltaTime;
 
+  const vku::EntityStore::UpdateStats stats = entityStore.update(params.frameInFlightNo);
+  ImGui::Text("Entities rebuilt: %u, uploaded: %u in %u ranges", stats.numRebuilt, stats.numUploaded, stats.numRanges);
+
   ImGui::Text(std::format("yaw: {}, pitch: {}\n", camera.yaw, camera.pitch).c_str());
   ImGui::End();
 }
 
-void TransformConstructionStudy::recordCommandBuffer(const vku::VulkanContext& vc, const vku::FrameDrawer& frameDrawer) {
-  const vk::RenderPassBeginInfo renderPassBeginInfo(*vc.renderPass, *frameDrawer.framebuffer, vk::Rect2D{{0, 0}, vc.swapchainExtent}, {});
-
-  const vk::raii::CommandBuffer& cmdBuf = frameDrawer.commandBuffer;
-  cmdBuf.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout, 0, *perFrameData[frameDrawer.frameNo].descriptorSets[0], nullptr);
+void TransformConstructionStudy::recordEntities(const vk::raii::CommandBuffer& cmdBuf, uint32_t frameNo, size_t beginIx, size_t endIx) const {
+  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout, 0, *perFrameData[frameNo].descriptorSets[0], nullptr);
   cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, **pipeline);
 
   vk::DeviceSize offsets = 0;
   cmdBuf.bindVertexBuffers(0, *vbo.buffer, offsets);
+  cmdBuf.bindVertexBuffers(1, *entityIndexBuffer.buffer, offsets);
   cmdBuf.bindIndexBuffer(*ibo.buffer, 0, vk::IndexType::eUint32);
-  for (auto& e : entities) {
-    const PushConstants& pco = e.getPushConstants();
-    const Mesh& mesh = e.mesh;
-    assert(sizeof(pco) <= vc.physicalDevice.getProperties().limits.maxPushConstantsSize);  // Push constant data too big
-    cmdBuf.pushConstants<PushConstants>(*pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0u, pco);
-    cmdBuf.drawIndexed(mesh.size, 1, mesh.offset, 0, 0);
+  const std::span<const uint32_t> meshIds = entityStore.getMeshIds();
+  for (size_t ix = beginIx; ix < endIx; ++ix) {
+    const Mesh& mesh = meshes[meshIds[ix]];
+    // firstInstance picks entity index ix from entityIndexBuffer
+    cmdBuf.drawIndexed(mesh.size, 1, mesh.offset, 0, static_cast<uint32_t>(ix));
+  }
+}
+
+void TransformConstructionStudy::recordCommandBuffer(const vku::VulkanContext& vc, const vku::FrameDrawer& frameDrawer) {
+  const vk::RenderPassBeginInfo renderPassBeginInfo(*vc.renderPass, *frameDrawer.framebuffer, vk::Rect2D{{0, 0}, vc.swapchainExtent}, {});
+  const vk::raii::CommandBuffer& cmdBuf = frameDrawer.commandBuffer;
+
+  if (useAutoInstancing) {
+    // entities are submitted one by one, renderQueue turns them into one instanced draw per mesh
+    renderQueue.begin(frameDrawer.frameNo);
+    const std::span<const uint32_t> meshIds = entityStore.getMeshIds();
+    for (uint32_t ix = 0; ix < meshIds.size(); ++ix) {
+      const Mesh& mesh = meshes[meshIds[ix]];
+      renderQueue.submit(0, vku::MeshRange{mesh.offset, mesh.size}, ix);
+    }
+    renderQueue.prepare(vc);
+
+    cmdBuf.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+    cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout, 0, *perFrameData[frameDrawer.frameNo].descriptorSets[0], nullptr);
+    vk::DeviceSize offsets = 0;
+    cmdBuf.bindVertexBuffers(0, *vbo.buffer, offsets);
+    cmdBuf.bindIndexBuffer(*ibo.buffer, 0, vk::IndexType::eUint32);
+    // single pipeline in this study
+    renderQueue.record(cmdBuf, 1, [&](uint32_t) { cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, **pipeline); });
+    cmdBuf.endRenderPass();
+    return;
+  }
+
+  // below this, handing a chunk to a worker costs more than recording it
+  constexpr size_t kMinEntitiesPerChunk = 256;
+  const uint32_t numChunks = static_cast<uint32_t>(std::clamp<size_t>(entityStore.size() / kMinEntitiesPerChunk, 1, vc.parallelRecorder.getNumWorkers()));
+  if (!useParallelRecording || numChunks < 2) {
+    cmdBuf.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+    recordEntities(cmdBuf, frameDrawer.frameNo, 0, entityStore.size());
+    cmdBuf.endRenderPass();
+    return;
   }
 
+  // A render pass instance that executes secondary CommandBuffers cannot have inline commands as well
+  cmdBuf.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+  const vk::CommandBufferInheritanceInfo inheritanceInfo(*vc.renderPass, 0, *frameDrawer.framebuffer);
+  const std::vector<vk::CommandBuffer> chunkCmdBufs = vc.parallelRecorder.record(inheritanceInfo, numChunks, [&](const vk::raii::CommandBuffer& chunkCmdBuf, uint32_t chunkIx) {
+    vc.setViewportAndScissor(chunkCmdBuf);
+    recordEntities(chunkCmdBuf, frameDrawer.frameNo, entityStore.size() * chunkIx / numChunks, entityStore.size() * (chunkIx + 1) / numChunks);
+  });
+  cmdBuf.executeCommands(chunkCmdBufs);
   cmdBuf.endRenderPass();
 }
 
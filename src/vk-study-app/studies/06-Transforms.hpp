@@ -4,7 +4,9 @@
 
 #include "../vku/Buffer.hpp"
 #include "../vku/Camera.hpp"
+#include "../vku/EntityStore.hpp"
 #include "../vku/Math.hpp"
+#include "../vku/RenderQueue.hpp"
 #include "../vku/UniformBuffer.hpp"
 
 #include <glm/mat4x4.hpp>
@@ -12,12 +14,6 @@
 #include <memory>
 
 class TransformConstructionStudy : public vku::Study {
-  struct PushConstants {
-    glm::mat4x4 worldFromObject;
-    glm::mat4x4 dualWorldFromObject;
-    glm::vec4 color;
-  };
-
   struct PerFrameUniforms {
     glm::mat4 viewFromWorld;
     glm::mat4 projectionFromView;
@@ -29,14 +25,6 @@ class TransformConstructionStudy : public vku::Study {
     const uint32_t size;
   };
 
-  struct Entity {
-    Mesh mesh;
-    vku::Transform transform;
-    glm::vec4 color;
-
-    PushConstants getPushConstants() const;
-  };
-
   struct MeshId {
     static const size_t Box = 0;
     static const size_t Axes = 1;
@@ -52,14 +40,29 @@ class TransformConstructionStudy : public vku::Study {
   vku::Buffer vbo;
   vku::Buffer ibo;
   std::vector<Mesh> meshes;
-  std::vector<Entity> entities;
+  // Entities' transforms, mesh ids and colors. Only the ones that moved get their matrices rebuilt and re-uploaded at the end of onUpdate.
+  // Vertex shader reads an entity's matrices and color from the store's storage buffer, at the entity index that comes as a per-instance vertex attribute (binding 1).
+  vku::EntityStore entityStore;
+  // Per-instance data is the entity index. Entities sharing a mesh are drawn with one instanced drawIndexed.
+  vku::RenderQueue renderQueue{sizeof(uint32_t)};
+  // 0, 1, ..., N - 1. Per-instance vertex input when entities are drawn one by one, with firstInstance = entity index
+  vku::Buffer entityIndexBuffer;
   uint32_t indexCount;
   std::vector<PerFrameUniformDescriptor> perFrameData;
   vk::raii::PipelineLayout pipelineLayout = nullptr;
   std::unique_ptr<vk::raii::Pipeline> pipeline;
   vku::FirstPersonPerspectiveCamera camera;
+  uint32_t numMonkeys;
+  // Record entities' draw calls into secondary CommandBuffers on worker threads (vku::ParallelRecorder), one chunk of the entity list each
+  bool useParallelRecording;
+  // Submit entities to renderQueue instead of recording a draw call per entity
+  bool useAutoInstancing;
+
+  // binds pipeline, descriptor set and mesh buffers, then records a drawIndexed per entity. Only reads Study state, hence can run on worker threads.
+  void recordEntities(const vk::raii::CommandBuffer& cmdBuf, uint32_t frameNo, size_t beginIx, size_t endIx) const;
 
  public:
+  explicit TransformConstructionStudy(uint32_t numMonkeys = 10, bool useParallelRecording = false, bool useAutoInstancing = true);
   virtual ~TransformConstructionStudy() = default;
 
   inline std::string getName() final { return "VertexBuffer upload to GPU, bind to pipeline/shader."; }
@@ -1,5 +1,6 @@
 #include "07-TransformsCompute.hpp"
 
+#include "../vku/MeshFile.hpp"
 #include "../vku/Model.hpp"
 #include "../vku/SpirvHelper.hpp"
 #include "../vku/utils.hpp"
@@ -14,209 +15,25 @@
 #include <glm/gtx/quaternion.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <algorithm>
+#include <format>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <numbers>
 #include <random>
 #include <ranges>
 #include <string>
+#include <vector>
 
-TransformGPUConstructionStudy::PushConstants TransformGPUConstructionStudy::Entity::getPushConstants() const {
-  PushConstants pc = TransformGPUConstructionStudy::PushConstants{.worldFromObject = transform.getTransform(), .color = color};
-  pc.dualWorldFromObject = glm::transpose(glm::inverse(pc.worldFromObject));
-  return pc;
-}
-
-void TransformGPUConstructionStudy::onInit(const vku::AppSettings appSettings, const vku::VulkanContext& vc) {
-  std::cout << vivid::ansi::lightBlue << "Hi from Vivid at UniformsStudy" << vivid::ansi::reset << std::endl;
-
-  //---- Vertex Data
-  const vivid::ColorMap cmap = vivid::ColorMap::Preset::Viridis;
-  uint32_t instanceBufferSize{};
-  uint32_t transformBufferSize{};
-  {
-    vku::DefaultMeshData allMeshesData;
-    auto insertMeshData = [&](const vku::DefaultMeshData& newMesh) -> Mesh {
-      Mesh mesh = {static_cast<uint32_t>(allMeshesData.indices.size()), static_cast<uint32_t>(newMesh.indices.size())};
-      std::ranges::copy(newMesh.vertices, std::back_inserter(allMeshesData.vertices));
-      std::ranges::transform(newMesh.indices, std::back_inserter(allMeshesData.indices), [&](uint32_t ix) { return ix + mesh.offset; });
-      return mesh;
-    };
-
-    meshes.resize(3);
-    meshes[MeshId::Box] = insertMeshData(vku::makeBox({0.2f, 0.5f, 0.7f}));
-    meshes[MeshId::Axes] = insertMeshData(vku::makeAxes());
-    meshes[MeshId::Monkey] = insertMeshData(vku::loadOBJ(vku::assetsRootFolder / "models/suzanne_smooth.obj"));
-
-    entities.emplace_back(meshes[MeshId::Box], vku::Transform{{-2, 0, 0}, {0, 0, 1}, std::numbers::pi_v<float> * 0.f, {1, 1, 1}}, glm::vec4{1, 0, 0, 1});
-    entities.emplace_back(meshes[MeshId::Axes], vku::Transform{{0, 0, 0}, {1, 1, 1}, std::numbers::pi_v<float> * 0.f, {1, 1, 1}}, glm::vec4{1, 1, 1, 1});
-
-    numMonkeyInstances = 50'000;
-    std::vector<InstanceData> monkeyInstances(numMonkeyInstances);
-    std::vector<vku::TransformGPU> monkeyTransformsToGPU(numMonkeyInstances);
-
-    std::default_random_engine rndGenerator(0);  // (unsigned)time(nullptr)
-    std::uniform_real_distribution<float> uniformDist(-1.0f, 1.0f);
-    const auto& u = [&rndGenerator, &uniformDist]() { return uniformDist(rndGenerator); };
-
-    for (uint32_t i = 0; i < numMonkeyInstances; ++i) {
-      const vku::Transform transform = vku::Transform{
-          glm::vec3{u(), u(), u()} * 10.0f,
-          {},
-          0,
-          glm::vec3{1.0f} * 0.05f};
-      monkeyTransformsToGPU[i] = transform.toGPULayout();
-      const glm::mat4 model = transform.getTransform();
-      monkeyInstances[i] = InstanceData{
-          .worldFromObject = model,
-          .dualWorldFromObject = glm::transpose(glm::inverse(model)),
-          .color = glm::vec4{0, 0, 1, 1},
-      };
-    }
-    instanceBufferSize = static_cast<uint32_t>(monkeyInstances.size() * sizeof(InstanceData));
-    instanceBuffer = vku::Buffer(vc, monkeyInstances.data(),
-                                 instanceBufferSize,
-                                 vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer);
-
-    transformBufferSize = static_cast<uint32_t>(monkeyTransformsToGPU.size() * sizeof(vku::TransformGPU));
-    transformBuffer = vku::Buffer(vc, monkeyTransformsToGPU.data(), transformBufferSize, vk::BufferUsageFlagBits::eStorageBuffer);
-
-    uint32_t vboSizeBytes = (uint32_t)(allMeshesData.vertices.size() * sizeof(vku::DefaultVertex));
-    vbo = vku::Buffer(vc, allMeshesData.vertices.data(), vboSizeBytes, vk::BufferUsageFlagBits::eVertexBuffer);
-
-    uint32_t iboSizeBytes = (uint32_t)(allMeshesData.indices.size() * sizeof(uint32_t));
-    indexCount = (uint32_t)allMeshesData.indices.size();
-    ibo = vku::Buffer(vc, allMeshesData.indices.data(), iboSizeBytes, vk::BufferUsageFlagBits::eIndexBuffer);
-  }
-
-  //---- Graphics
-  {
-    std::vector<vk::raii::DescriptorSetLayout> descriptorSetLayoutsRaii;
-    // set = 0 Per Frame Descriptor Set Layout
-    {
-      const std::array<vk::DescriptorSetLayoutBinding, 1> layoutBindings{
-          vk::DescriptorSetLayoutBinding{0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment},
-      };
-      const vk::DescriptorSetLayoutCreateInfo layoutCreateInfo{{}, layoutBindings};
-      descriptorSetLayoutsRaii.emplace_back(vc.device, layoutCreateInfo);
-    }
-    // set = 1 Per Pass Descriptor Set Layout
-    {
-      const std::array<vk::DescriptorSetLayoutBinding, 1> layoutBindings{
-          vk::DescriptorSetLayoutBinding{0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment},
-      };
-      const vk::DescriptorSetLayoutCreateInfo layoutCreateInfo{{}, layoutBindings};
-      descriptorSetLayoutsRaii.emplace_back(vc.device, layoutCreateInfo);
-    }
-    // init pipelineLayoutPerFrameAndPass
-    {
-      std::vector<vk::DescriptorSetLayout> descriptorSetLayoutsCommon;
-      std::ranges::transform(descriptorSetLayoutsRaii, std::back_inserter(descriptorSetLayoutsCommon), [&](const vk::raii::DescriptorSetLayout& dsRaii) { return *dsRaii; });
-      vk::PushConstantRange pushConstantRange{vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstants)};
-      vk::PipelineLayoutCreateInfo pipelineLayoutCommoneCreateInfo({}, descriptorSetLayoutsCommon, pushConstantRange);
-      pipelineLayoutPerFrameAndPass = vk::raii::PipelineLayout(vc.device, pipelineLayoutCommoneCreateInfo);
-    }
-    // set = 2 Per Material Descriptor Set Layout
-    {
-      const std::array<vk::DescriptorSetLayoutBinding, 1> layoutBindings{
-          vk::DescriptorSetLayoutBinding{0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eFragment},
-      };
-      const vk::DescriptorSetLayoutCreateInfo layoutCreateInfo{{}, layoutBindings};
-      descriptorSetLayoutsRaii.emplace_back(vc.device, layoutCreateInfo);
-    }
-
-    std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
-    std::ranges::transform(descriptorSetLayoutsRaii, std::back_inserter(descriptorSetLayouts), [&](const vk::raii::DescriptorSetLayout& dsRaii) { return *dsRaii; });
-    vk::DescriptorSetAllocateInfo allocateInfo{*vc.descriptorPool, descriptorSetLayouts};
-
-    descriptorSetsGraphics.reserve(vc.MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < vc.MAX_FRAMES_IN_FLIGHT; i++) {
-      perFrameUniform.emplace_back(vc);
-      perPassUniform.emplace_back(vc);
-      perMaterialUniform.emplace_back(vc);
-
-      descriptorSetsGraphics.emplace_back(vc.device, allocateInfo);
-      std::vector<vk::DescriptorSet> descriptorSets;
-      std::ranges::transform(descriptorSetsGraphics.back(), std::back_inserter(descriptorSets), [&](const vk::raii::DescriptorSet& dsRaii) { return *dsRaii; });
-
-      vk::WriteDescriptorSet writeDescriptorSet;  // connects indiviudal concrete uniform buffer to descriptor set with the abstract layout that can refer to it
-
-      // per Frame uniform and descriptor connections
-      writeDescriptorSet.dstSet = descriptorSets[0];  // set = 0
-      writeDescriptorSet.descriptorCount = 1;
-      writeDescriptorSet.descriptorType = vk::DescriptorType::eUniformBuffer;
-      writeDescriptorSet.pBufferInfo = &perFrameUniform.back().descriptor;
-      writeDescriptorSet.dstBinding = 0;  // binding = 0
-      vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
-
-      // per Pass uniform and descriptor connections
-      writeDescriptorSet.dstSet = descriptorSets[1];  // set = 1
-      writeDescriptorSet.descriptorCount = 1;
-      writeDescriptorSet.descriptorType = vk::DescriptorType::eUniformBuffer;
-      writeDescriptorSet.pBufferInfo = &perPassUniform.back().descriptor;
-      writeDescriptorSet.dstBinding = 0;  // binding = 0
-      vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
-
-      // per Material uniform and descriptor connections
-      writeDescriptorSet.dstSet = descriptorSets[2];  // set = 2
-      writeDescriptorSet.descriptorCount = 1;
-      writeDescriptorSet.descriptorType = vk::DescriptorType::eUniformBuffer;
-      writeDescriptorSet.pBufferInfo = &perMaterialUniform.back().descriptor;
-      writeDescriptorSet.dstBinding = 0;  // binding = 0
-      vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
-    }
-
-    initPipelineWithPushConstant(appSettings, vc, descriptorSetLayouts);
-    initPipelineWithInstances(appSettings, vc, descriptorSetLayouts);
-  }
-
-  //---- Compute Uniform Data
-  computeUniformBuffer = vku::UniformBuffer<ComputeUniforms>(vc);
-
-  //---- Descriptor Set - Compute
-  {
-    const std::array<vk::DescriptorSetLayoutBinding, 3> layoutBindings{
-        vk::DescriptorSetLayoutBinding{0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},  // layout(set=0, binding=0) buffer buf; // transforms
-        vk::DescriptorSetLayoutBinding{1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},  // layout(set=0, binding=1) buffer buf; // transformMatrices
-        vk::DescriptorSetLayoutBinding{2, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute},  // layout(set=0, binding=2)
-    };
-    const vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{{}, layoutBindings};
-    const vk::raii::DescriptorSetLayout descriptorSetLayout{vc.device, descriptorSetLayoutCreateInfo};
-
-    // Allocate descriptor set from the pool
-    vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo(*vc.descriptorPool, 1, &(*descriptorSetLayout));
-    computeDescriptorSets = vk::raii::DescriptorSets(vc.device, allocateInfo);
-
-    vk::WriteDescriptorSet writeDescriptorSet;
-    writeDescriptorSet.dstSet = *computeDescriptorSets[0];
-
-    // Binding 0 and 1: Storage Buffer for transforms and transform matrices
-    std::array<vk::DescriptorBufferInfo, 2> descriptorBufferInfosStorage{
-        vk::DescriptorBufferInfo(*transformBuffer.buffer, 0, transformBufferSize),
-        vk::DescriptorBufferInfo(*instanceBuffer.buffer, 0, instanceBufferSize),
-    };
-    writeDescriptorSet.descriptorCount = 2;
-    writeDescriptorSet.descriptorType = vk::DescriptorType::eStorageBuffer;
-    writeDescriptorSet.pBufferInfo = descriptorBufferInfosStorage.data();
-    writeDescriptorSet.dstBinding = 0;  // {0, 1}
-    vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
-
-    // Binding 2: Uniform Buffer for target position
-    writeDescriptorSet.descriptorCount = 1;
-    writeDescriptorSet.descriptorType = vk::DescriptorType::eUniformBuffer;
-    writeDescriptorSet.pBufferInfo = &computeUniformBuffer.descriptor;
-    writeDescriptorSet.dstBinding = 2;  // dstBindingPrev + descriptorCountPrev;
-    vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
-
-    initPipelineWithCompute(appSettings, vc, descriptorSetLayout);
-  }
-}
-
-void TransformGPUConstructionStudy::initPipelineWithPushConstant(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const std::vector<vk::DescriptorSetLayout> descriptorSetLayouts) {
-  const std::string vertexShaderStr = R"(
+namespace {
+// Shaders of every pipeline. onInit compiles all of them concurrently, see initPipelineWith* for their bindings
+constexpr const char* entityVertexShaderStr = R"(
 #version 450
 
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
 // Vertex attributes
 layout (location = 0) in vec3 inObjectPosition;
@@ -224,19 +41,33 @@ layout (location = 1) in vec2 inTexCoord;
 layout (location = 2) in vec3 inObjectNormal;
 layout (location = 3) in vec4 inColor;
 
-layout(push_constant) uniform PushConstants
+struct Entity
 {
 	mat4 worldFromObjectMatrix;
 	mat4 dualWorldFromObjectMatrix;
   vec4 color;
-} pushConstants;
+};
+
+// Storage buffer array of vku::BindlessHeap, viewed as different blocks
+// vku::EntityStore::GPUEntity. Entity index comes as firstInstance of the indirect draw command
+layout (std430, set = 0, binding = 0) readonly buffer Entities
+{
+  Entity entities[];
+} entityBuffers[];
 
-layout (set = 1, binding = 0) uniform PerPass {
+layout (std430, set = 0, binding = 0) readonly buffer PerPass {
   vec4 cameraPositionWorld;
 	mat4 viewFromWorldMatrix;
   mat4 projectionFromViewMatrix;
   mat4 projectionFromWorldMatrix;
-} perPass;
+} perPasses[];
+
+layout (push_constant) uniform BindlessIndices {
+  uint perFrame;
+  uint perPass;
+  uint material;
+  uint entities;
+} indices;
 
 layout (location = 0) out struct {
     vec3 worldPosition;
@@ -248,23 +79,24 @@ layout (location = 0) out struct {
 
 void main() 
 {
-  const mat4 transform = pushConstants.worldFromObjectMatrix;
+  const Entity entity = entityBuffers[indices.entities].entities[gl_InstanceIndex];
+  const mat4 transform = entity.worldFromObjectMatrix;
   const vec4 worldPosition4 = transform * vec4(inObjectPosition.xyz, 1.0);
   v2f.worldPosition = worldPosition4.xyz;
 
-  v2f.worldNormal = mat3(pushConstants.dualWorldFromObjectMatrix) * inObjectNormal;
+  v2f.worldNormal = mat3(entity.dualWorldFromObjectMatrix) * inObjectNormal;
 
   v2f.objectNormal = inObjectNormal;
 
-  gl_Position = perPass.projectionFromWorldMatrix * worldPosition4;
+  gl_Position = perPasses[indices.perPass].projectionFromWorldMatrix * worldPosition4;
 
-  //v2f.color = pushConstants.color;
+  //v2f.color = entity.color;
   //v2f.color = inColor;
-  v2f.color = inColor * pushConstants.color;
+  v2f.color = inColor * entity.color;
 }
 )";
 
-  const std::string fragmentShaderStr = R"(
+constexpr const char* entityFragmentShaderStr = R"(
 #version 450
 
 #extension GL_ARB_separate_shader_objects : enable
@@ -290,108 +122,12 @@ void main()
 }
 )";
 
-  vk::raii::ShaderModule vertexShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eVertex, vertexShaderStr);
-  vk::raii::ShaderModule fragmentShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eFragment, fragmentShaderStr);
-  std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos = {
-      vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertexShader, "main"),
-      vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragmentShader, "main")};
-
-  vku::VertexInputStateCreateInfo vertexInputStateCreateInfo(
-      {
-          {0, sizeof(vku::DefaultVertex), vk::VertexInputRate::eVertex},
-      },
-      {{
-          {0, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, position)},
-          {1, 0, vk::Format::eR32G32Sfloat, offsetof(vku::DefaultVertex, texCoord)},
-          {2, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, normal)},
-          {3, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(vku::DefaultVertex, color)},
-      }});
-
-  vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo({}, vk::PrimitiveTopology::eTriangleList, false);
-
-  std::array<vk::Viewport, 1> viewports = {vk::Viewport{0.f, 0.f, static_cast<float>(vc.swapchainExtent.width), static_cast<float>(vc.swapchainExtent.height), 0.f, 1.f}};
-  std::array<vk::Rect2D, 1> scissors = {vk::Rect2D{vk::Offset2D{0, 0}, vc.swapchainExtent}};
-  vk::PipelineViewportStateCreateInfo viewportStateCreateInfo({}, viewports, scissors);
-
-  vk::PipelineRasterizationStateCreateInfo rasterizationStateCreateInfo({},                                // flags
-                                                                        false,                             // depthClampEnable
-                                                                        false,                             // rasterizerDiscardEnable
-                                                                        vk::PolygonMode::eFill,            // polygonMode
-                                                                        vk::CullModeFlagBits::eBack,       // cullMode {eBack}
-                                                                        vk::FrontFace::eCounterClockwise,  // frontFace
-                                                                        false,                             // depthBiasEnable
-                                                                        0.0f,                              // depthBiasConstantFactor
-                                                                        0.0f,                              // depthBiasClamp
-                                                                        0.0f,                              // depthBiasSlopeFactor
-                                                                        1.0f                               // lineWidth
-  );
-
-  vk::PipelineMultisampleStateCreateInfo multisampleStateCreateInfo({}, vc.swapchainSamples);
-
-  vk::StencilOpState stencilOpState(vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::CompareOp::eAlways);
-  vk::PipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo({},                           // flags
-                                                                      true,                         // depthTestEnable
-                                                                      true,                         // depthWriteEnable
-                                                                      vk::CompareOp::eLessOrEqual,  // depthCompareOp
-                                                                      false,                        // depthBoundTestEnable
-                                                                      false,                        // stencilTestEnable
-                                                                      stencilOpState,               // front
-                                                                      stencilOpState                // back
-  );
-
-  vk::ColorComponentFlags colorComponentFlags(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
-  vk::PipelineColorBlendAttachmentState colorBlendAttachmentState(false,                   // blendEnable
-                                                                  vk::BlendFactor::eZero,  // srcColorBlendFactor, defaults...
-                                                                  vk::BlendFactor::eZero,  // dstColorBlendFactor
-                                                                  vk::BlendOp::eAdd,       // colorBlendOp
-                                                                  vk::BlendFactor::eZero,  // srcAlphaBlendFactor
-                                                                  vk::BlendFactor::eZero,  // dstAlphaBlendFactor
-                                                                  vk::BlendOp::eAdd,       // alphaBlendOp
-                                                                  colorComponentFlags      // colorWriteMask
-  );
-  vk::PipelineColorBlendStateCreateInfo colorBlendStateCreateInfo({},                         // flags
-                                                                  false,                      // logicOpEnable
-                                                                  vk::LogicOp::eNoOp,         // logicOp
-                                                                  colorBlendAttachmentState,  // attachments
-                                                                  {{0.f, 0.f, 0.f, 0.f}}      // blendConstants
-  );
-
-  std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
-  vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo({}, dynamicStates);
-
-  vk::PushConstantRange pushConstant{vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstants)};
-  vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo;
-  pipelineLayoutCreateInfo.setSetLayouts(descriptorSetLayouts);
-  pipelineLayoutCreateInfo.setPushConstantRanges(pushConstant);
-  pipelineLayoutPushConstant = {vc.device, pipelineLayoutCreateInfo};  // { flags, descriptorSetLayout }
-
-  vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
-      {},
-      shaderStageCreateInfos,
-      &vertexInputStateCreateInfo,
-      &inputAssemblyStateCreateInfo,
-      nullptr,  // *vk::PipelineTessellationStateCreateInfo
-      &viewportStateCreateInfo,
-      &rasterizationStateCreateInfo,
-      &multisampleStateCreateInfo,
-      appSettings.hasPresentDepth ? &depthStencilStateCreateInfo : nullptr,
-      &colorBlendStateCreateInfo,
-      &dynamicStateCreateInfo,      // *vk::PipelineDynamicStateCreateInfo
-      *pipelineLayoutPushConstant,  // vk::PipelineLayout
-      *vc.renderPass                // vk::RenderPass
-                                    //{}, // uint32_t subpass_ = {},
-  );
-
-  pipelinePushConstant = std::make_unique<vk::raii::Pipeline>(vc.device, nullptr, graphicsPipelineCreateInfo);
-  assert(pipelinePushConstant->getConstructorSuccessCode() == vk::Result::eSuccess);
-}
-
-void TransformGPUConstructionStudy::initPipelineWithInstances(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const std::vector<vk::DescriptorSetLayout> descriptorSetLayouts) {
-  const std::string vertexShaderStr = R"(
+constexpr const char* instanceVertexShaderStr = R"(
 #version 450
 
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
 // Vertex attributes
 layout (location = 0) in vec3 inObjectPosition;
@@ -404,12 +140,19 @@ layout (location = 4) in mat4 instanceWorldFromObjectMatrix;
 layout (location = 8) in mat4 instanceDualWorldFromObjectMatrix;
 layout (location = 12) in vec4 instanceColor;
 
-layout (set = 1, binding = 0) uniform PerPass {
+layout (std430, set = 0, binding = 0) readonly buffer PerPass {
   vec4 cameraPositionWorld;
 	mat4 viewFromWorldMatrix;
   mat4 projectionFromViewMatrix;
   mat4 projectionFromWorldMatrix;
-} perPass;
+} perPasses[];
+
+layout (push_constant) uniform BindlessIndices {
+  uint perFrame;
+  uint perPass;
+  uint material;
+  uint entities;
+} indices;
 
 layout (location = 0) out struct {
     vec3 worldPosition;
@@ -428,18 +171,19 @@ void main() {
 
   v2f.objectNormal = inObjectNormal;
 
-  gl_Position = perPass.projectionFromWorldMatrix * worldPosition4;
+  gl_Position = perPasses[indices.perPass].projectionFromWorldMatrix * worldPosition4;
 
   v2f.color = instanceColor;
   //v2f.color = inColor;
 }
 )";
 
-  const std::string fragmentShaderStr = R"(
+constexpr const char* instanceFragmentShaderStr = R"(
 #version 450
 
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in struct {
     vec3 worldPosition;
@@ -448,24 +192,32 @@ layout (location = 0) in struct {
     vec4 color;
 } v2f;
 
-layout (set = 0, binding = 0) uniform PerFrame {
+// Storage buffer array of vku::BindlessHeap, viewed as different blocks
+layout (std430, set = 0, binding = 0) readonly buffer PerFrame {
   vec4 time;
   vec4 lightPos;
-} perFrame;
+} perFrames[];
 
-layout (set = 1, binding = 0) uniform PerPass {
+layout (std430, set = 0, binding = 0) readonly buffer PerPass {
   vec4 cameraPositionWorld;
 	mat4 viewFromWorldMatrix;
   mat4 projectionFromViewMatrix;
   mat4 projectionFromWorldMatrix;
-} perPass;
+} perPasses[];
 
-layout (set = 2, binding = 0) uniform PerMaterial {
+layout (std430, set = 0, binding = 0) readonly buffer PerMaterial {
   vec4 specularParams; // x: specularExponent/smoothness
   vec4 goochCool;
   vec4 goochWarm;
   ivec4 shouldUseGooch;
-} perMaterial;
+} perMaterials[];
+
+layout (push_constant) uniform BindlessIndices {
+  uint perFrame;
+  uint perPass;
+  uint material;
+  uint entities;
+} indices;
 
 layout (location = 0) out vec4 outFragColor;
 
@@ -473,11 +225,11 @@ void main() {
   // from vertex
   const vec3 normal = normalize(v2f.worldNormal);
   // from uniforms
-  const vec3 camPosWorld = perPass.cameraPositionWorld.xyz;
-  const vec3 lightPos = perFrame.lightPos.xyz;
-  const vec3 goochCoolColor = perMaterial.goochCool.xyz;
-  const vec3 goochWarmColor = perMaterial.goochWarm.xyz;
-  const bool shouldUseGooch = perMaterial.shouldUseGooch.x != 0;
+  const vec3 camPosWorld = perPasses[indices.perPass].cameraPositionWorld.xyz;
+  const vec3 lightPos = perFrames[indices.perFrame].lightPos.xyz;
+  const vec3 goochCoolColor = perMaterials[indices.material].goochCool.xyz;
+  const vec3 goochWarmColor = perMaterials[indices.material].goochWarm.xyz;
+  const bool shouldUseGooch = perMaterials[indices.material].shouldUseGooch.x != 0;
 
   // directions
   const vec3 fragToCamDir = normalize(camPosWorld - v2f.worldPosition);
@@ -489,7 +241,7 @@ void main() {
   const float gooch = (1.0f + dot(fragToLightDir, normal)) * 0.5f;
   const vec3 goochDiffuse = gooch * goochWarmColor + (1 - gooch) * goochCoolColor;
   const float specular0 = max(dot(fragToCamDir, reflectionDir), 0);
-  const float specular = pow(specular0, perMaterial.specularParams.x);
+  const float specular = pow(specular0, perMaterials[indices.material].specularParams.x);
   
   if (shouldUseGooch)
     outFragColor = vec4(goochDiffuse + specular * vec3(1), 1); // lit
@@ -499,143 +251,34 @@ void main() {
 }
 )";
 
-  vk::raii::ShaderModule vertexShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eVertex, vertexShaderStr);
-  vk::raii::ShaderModule fragmentShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eFragment, fragmentShaderStr);
-  std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos = {
-      vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertexShader, "main"),
-      vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragmentShader, "main")};
+constexpr const char* transformComputeShaderStr = R"(
+#version 450
 
-  vku::VertexInputStateCreateInfo vertexInputStateCreateInfo(
-      {
-          {0, sizeof(vku::DefaultVertex), vk::VertexInputRate::eVertex},
-          {1, sizeof(InstanceData), vk::VertexInputRate::eInstance},
-      },
-      {{
-          {0, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, position)},
-          {1, 0, vk::Format::eR32G32Sfloat, offsetof(vku::DefaultVertex, texCoord)},
-          {2, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, normal)},
-          {3, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(vku::DefaultVertex, color)},
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
 
-          {4, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 0},
-          {5, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 1},
-          {6, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 2},
-          {7, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 3},
-          {8, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 4},
-          {9, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 5},
-          {10, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 6},
-          {11, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 7},
-          {12, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 8},
-      }});
+// workgroup size comes from specialization constant 0, so that it can be tuned without editing the shader
+layout (local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
 
-  vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo({}, vk::PrimitiveTopology::eTriangleList, false);
+struct Transform {
+  vec4 position;
+  vec4 rotation;
+  vec4 scale;
+};
 
-  std::array<vk::Viewport, 1> viewports = {vk::Viewport{0.f, 0.f, static_cast<float>(vc.swapchainExtent.width), static_cast<float>(vc.swapchainExtent.height), 0.f, 1.f}};
-  std::array<vk::Rect2D, 1> scissors = {vk::Rect2D{vk::Offset2D{0, 0}, vc.swapchainExtent}};
-  vk::PipelineViewportStateCreateInfo viewportStateCreateInfo({}, viewports, scissors);
+struct TransformMatrices {
+  mat4 worldFromObject;
+  mat4 dualWorldFromObject;
+  vec4 color;
+};
 
-  // TODO: fix obj loading. Looks like face orientations are incorrect? I had to cull front faces. :-O
-  vk::PipelineRasterizationStateCreateInfo rasterizationStateCreateInfo({},                                // flags
-                                                                        false,                             // depthClampEnable
-                                                                        false,                             // rasterizerDiscardEnable
-                                                                        vk::PolygonMode::eFill,            // polygonMode
-                                                                        vk::CullModeFlagBits::eBack,       // cullMode {eBack}
-                                                                        vk::FrontFace::eCounterClockwise,  // frontFace
-                                                                        false,                             // depthBiasEnable
-                                                                        0.0f,                              // depthBiasConstantFactor
-                                                                        0.0f,                              // depthBiasClamp
-                                                                        0.0f,                              // depthBiasSlopeFactor
-                                                                        1.0f                               // lineWidth
-  );
+layout (std140, set = 0, binding = 0) buffer buf0 {
+  Transform transforms[];
+};
 
-  vk::PipelineMultisampleStateCreateInfo multisampleStateCreateInfo({}, vc.swapchainSamples);
-
-  vk::StencilOpState stencilOpState(vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::CompareOp::eAlways);
-  vk::PipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo({},                           // flags
-                                                                      true,                         // depthTestEnable
-                                                                      true,                         // depthWriteEnable
-                                                                      vk::CompareOp::eLessOrEqual,  // depthCompareOp
-                                                                      false,                        // depthBoundTestEnable
-                                                                      false,                        // stencilTestEnable
-                                                                      stencilOpState,               // front
-                                                                      stencilOpState                // back
-  );
-
-  vk::ColorComponentFlags colorComponentFlags(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
-  vk::PipelineColorBlendAttachmentState colorBlendAttachmentState(false,                   // blendEnable
-                                                                  vk::BlendFactor::eZero,  // srcColorBlendFactor, defaults...
-                                                                  vk::BlendFactor::eZero,  // dstColorBlendFactor
-                                                                  vk::BlendOp::eAdd,       // colorBlendOp
-                                                                  vk::BlendFactor::eZero,  // srcAlphaBlendFactor
-                                                                  vk::BlendFactor::eZero,  // dstAlphaBlendFactor
-                                                                  vk::BlendOp::eAdd,       // alphaBlendOp
-                                                                  colorComponentFlags      // colorWriteMask
-  );
-  vk::PipelineColorBlendStateCreateInfo colorBlendStateCreateInfo({},                         // flags
-                                                                  false,                      // logicOpEnable
-                                                                  vk::LogicOp::eNoOp,         // logicOp
-                                                                  colorBlendAttachmentState,  // attachments
-                                                                  {{0.f, 0.f, 0.f, 0.f}}      // blendConstants
-  );
-
-  std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
-  vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo({}, dynamicStates);
-
-  // Note that, thie pipeline/shaders do not use push constants but in order to make the two pipelines' (entities and instance) layouts compatible
-  // needed to add the push constants. See "Pipeline Layout Compatibility" https://registry.khronos.org/vulkan/specs/1.3-extensions/html/vkspec.html#descriptorsets-compatibility
-  vk::PushConstantRange pushConstantRange{vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstants)};
-  const vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo{{}, descriptorSetLayouts, pushConstantRange};  // { flags, descriptorSetLayouts }
-
-  pipelineLayoutInstance = vk::raii::PipelineLayout{vc.device, pipelineLayoutCreateInfo};
-
-  vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
-      {},
-      shaderStageCreateInfos,
-      &vertexInputStateCreateInfo,
-      &inputAssemblyStateCreateInfo,
-      nullptr,  // *vk::PipelineTessellationStateCreateInfo
-      &viewportStateCreateInfo,
-      &rasterizationStateCreateInfo,
-      &multisampleStateCreateInfo,
-      appSettings.hasPresentDepth ? &depthStencilStateCreateInfo : nullptr,
-      &colorBlendStateCreateInfo,
-      &dynamicStateCreateInfo,  // *vk::PipelineDynamicStateCreateInfo
-      *pipelineLayoutInstance,  // vk::PipelineLayout
-      *vc.renderPass            // vk::RenderPass
-                                //{}, // uint32_t subpass_ = {},
-  );
-
-  pipelineInstance = std::make_unique<vk::raii::Pipeline>(vc.device, nullptr, graphicsPipelineCreateInfo);
-  assert(pipelineInstance->getConstructorSuccessCode() == vk::Result::eSuccess);
-}
-
-void TransformGPUConstructionStudy::initPipelineWithCompute(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const vk::raii::DescriptorSetLayout& descriptorSetLayout) {
-  const std::string computeShaderStr = R"(
-#version 450
-
-#extension GL_ARB_separate_shader_objects : enable
-#extension GL_ARB_shading_language_420pack : enable
-
-layout (local_size_x = 10, local_size_y = 1, local_size_z = 1 ) in;
-
-struct Transform {
-  vec4 position;
-  vec4 rotation;
-  vec4 scale;
-};
-
-struct TransformMatrices {
-  mat4 worldFromObject;
-  mat4 dualWorldFromObject;
-  vec4 color;
-};
-
-layout (std140, set = 0, binding = 0) buffer buf0 {
-  Transform transforms[];
-};
-
-layout (std140, set = 0, binding = 1) buffer buf1 {
-  TransformMatrices transformMatrices[];
-};
+layout (std140, set = 0, binding = 1) buffer buf1 {
+  TransformMatrices transformMatrices[];
+};
 
 layout (set = 0, binding = 2) uniform ComputeParameters {
 	vec4 targetPosition;
@@ -921,6 +564,9 @@ void main()
 {
   const float pi = 3.14159265358979f;
   const uint ix = gl_GlobalInvocationID.x;
+  // last workgroup is partially out of range when number of instances is not a multiple of the workgroup size
+  if (ix >= transforms.length())
+    return;
 
   const float maxAngle = params.maxAngleToTurn.x;
   const vec3 targetPosition = params.targetPosition.xyz;
@@ -971,44 +617,541 @@ void main()
 }
 )";
 
-  vk::raii::ShaderModule computeShader = vku::spirv::makeShaderModule(vc.device, vk::ShaderStageFlagBits::eCompute, computeShaderStr);
+constexpr const char* cullComputeShaderStr = R"(
+#version 450
+
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct InstanceData {
+  mat4 worldFromObject;
+  mat4 dualWorldFromObject;
+  vec4 color;
+};
+
+layout (std430, set = 0, binding = 0) readonly buffer AllInstances {
+  InstanceData instances[];
+};
+
+layout (std430, set = 0, binding = 1) writeonly buffer VisibleInstances {
+  InstanceData visibleInstances[];
+};
+
+// VkDrawIndexedIndirectCommand
+layout (std430, set = 0, binding = 2) buffer IndirectDraw {
+  uint indexCount;
+  uint instanceCount;
+  uint firstIndex;
+  int vertexOffset;
+  uint firstInstance;
+} draw;
+
+layout (push_constant) uniform CullParameters {
+  vec4 frustumPlanes[6]; // xyz: inward unit normal, w: distance
+  vec4 boundingSphere; // object space
+  uint numInstances;
+} params;
+
+void main() {
+  const uint ix = gl_GlobalInvocationID.x;
+  if (ix >= params.numInstances)
+    return;
+
+  const mat4 worldFromObject = instances[ix].worldFromObject;
+  const vec3 center = (worldFromObject * vec4(params.boundingSphere.xyz, 1)).xyz;
+  // non-uniform scale stretches the sphere, take the largest axis
+  const float maxScale = max(length(worldFromObject[0].xyz), max(length(worldFromObject[1].xyz), length(worldFromObject[2].xyz)));
+  const float radius = params.boundingSphere.w * maxScale;
+
+  for (int i = 0; i < 6; ++i)
+    if (dot(params.frustumPlanes[i].xyz, center) + params.frustumPlanes[i].w < -radius)
+      return;
+
+  const uint slot = atomicAdd(draw.instanceCount, 1);
+  visibleInstances[slot] = instances[ix];
+}
+)";
+}  // namespace
+
+TransformGPUConstructionStudy::TransformGPUConstructionStudy(uint32_t computeLocalSize, bool useAsyncCompute)
+    : computeLocalSize(computeLocalSize), useAsyncCompute(useAsyncCompute) {}
+
+void TransformGPUConstructionStudy::onInit(const vku::AppSettings appSettings, const vku::VulkanContext& vc) {
+  std::cout << vivid::ansi::lightBlue << "Hi from Vivid at UniformsStudy" << vivid::ansi::reset << std::endl;
+
+  //---- Shaders
+  // Every shader compiles on ThreadPool workers while meshes load and buffers are created below. Joined once before the first pipeline is created.
+  std::future<std::vector<uint32_t>> entityVertexSpvFuture = vku::spirv::compileAsync(vk::ShaderStageFlagBits::eVertex, entityVertexShaderStr);
+  std::future<std::vector<uint32_t>> entityFragmentSpvFuture = vku::spirv::compileAsync(vk::ShaderStageFlagBits::eFragment, entityFragmentShaderStr);
+  std::future<std::vector<uint32_t>> instanceVertexSpvFuture = vku::spirv::compileAsync(vk::ShaderStageFlagBits::eVertex, instanceVertexShaderStr);
+  std::future<std::vector<uint32_t>> instanceFragmentSpvFuture = vku::spirv::compileAsync(vk::ShaderStageFlagBits::eFragment, instanceFragmentShaderStr);
+  std::future<std::vector<uint32_t>> transformComputeSpvFuture = vku::spirv::compileAsync(vk::ShaderStageFlagBits::eCompute, transformComputeShaderStr);
+  std::future<std::vector<uint32_t>> cullComputeSpvFuture = vku::spirv::compileAsync(vk::ShaderStageFlagBits::eCompute, cullComputeShaderStr);
+
+  //---- Vertex Data
+  const vivid::ColorMap cmap = vivid::ColorMap::Preset::Viridis;
+  uint32_t instanceBufferSize{};
+  uint32_t transformBufferSize{};
+  {
+    vku::DefaultMeshData allMeshesData;
+    auto insertMeshData = [&](const auto& newMesh) -> Mesh {
+      Mesh mesh = {static_cast<uint32_t>(allMeshesData.indices.size()), static_cast<uint32_t>(newMesh.indices.size())};
+      std::ranges::copy(newMesh.vertices, std::back_inserter(allMeshesData.vertices));
+      std::ranges::transform(newMesh.indices, std::back_inserter(allMeshesData.indices), [&](uint32_t ix) { return ix + mesh.offset; });
+      return mesh;
+    };
+
+    meshes.resize(3);
+    meshes[MeshId::Box] = insertMeshData(vku::makeBox({0.2f, 0.5f, 0.7f}));
+    meshes[MeshId::Axes] = insertMeshData(vku::makeAxes());
+    const vku::MappedMesh monkeyMesh = vku::loadOBJCached(vku::assetsRootFolder / "models/suzanne_smooth.obj");
+    meshes[MeshId::Monkey] = insertMeshData(monkeyMesh);
+    monkeyBoundingSphere = vku::getBoundingSphere(monkeyMesh.vertices);
+
+    entityStore.add(vku::Transform{{-2, 0, 0}, {0, 0, 1}, std::numbers::pi_v<float> * 0.f, {1, 1, 1}}, MeshId::Box, glm::vec4{1, 0, 0, 1});
+    entityStore.add(vku::Transform{{0, 0, 0}, {1, 1, 1}, std::numbers::pi_v<float> * 0.f, {1, 1, 1}}, MeshId::Axes, glm::vec4{1, 1, 1, 1});
+    entityStore.createBuffers(vc);
+
+    // Entities' meshes don't change, hence draw commands are built once. Consecutive entities with the same mesh are instances of one command,
+    // and gl_InstanceIndex (which includes firstInstance) is the entity index
+    std::vector<vk::DrawIndexedIndirectCommand> entityDraws;
+    const std::span<const uint32_t> entityMeshIds = entityStore.getMeshIds();
+    for (uint32_t ix = 0; ix < entityMeshIds.size(); ++ix) {
+      if (ix > 0 && entityMeshIds[ix] == entityMeshIds[ix - 1]) {
+        ++entityDraws.back().instanceCount;
+        continue;
+      }
+      const Mesh& mesh = meshes[entityMeshIds[ix]];
+      entityDraws.emplace_back(mesh.size, 1, mesh.offset, 0, ix);
+    }
+    numEntityDraws = static_cast<uint32_t>(entityDraws.size());
+    entityIndirectBuffer = vku::Buffer(vc, entityDraws.data(), static_cast<uint32_t>(entityDraws.size() * sizeof(vk::DrawIndexedIndirectCommand)), vk::BufferUsageFlagBits::eIndirectBuffer);
+
+    numMonkeyInstances = 50'000;
+    std::vector<vku::TransformGPU> monkeyTransformsToGPU(numMonkeyInstances);
+
+    std::default_random_engine rndGenerator(0);  // (unsigned)time(nullptr)
+    std::uniform_real_distribution<float> uniformDist(-1.0f, 1.0f);
+    const auto& u = [&rndGenerator, &uniformDist]() { return uniformDist(rndGenerator); };
+
+    for (uint32_t i = 0; i < numMonkeyInstances; ++i) {
+      const vku::Transform transform = vku::Transform{
+          glm::vec3{u(), u(), u()} * 10.0f,
+          {},
+          0,
+          glm::vec3{1.0f} * 0.05f};
+      monkeyTransformsToGPU[i] = transform.toGPULayout();
+    }
+    // No initial data. Transform compute writes every instance before culling reads them.
+    // Hence they are in exclusive sharing mode, and in async compute mode their ownership is transferred between compute and graphics queue families.
+    instanceBufferSize = static_cast<uint32_t>(numMonkeyInstances * sizeof(InstanceData));
+    const uint32_t numInstanceBuffers = useAsyncCompute ? 2 : 1;
+    for (uint32_t i = 0; i < numInstanceBuffers; ++i)
+      instanceBuffers.emplace_back(vc, instanceBufferSize, vk::BufferUsageFlagBits::eStorageBuffer);
+
+    // culling output, instances that pass are compacted in the front, in arbitrary order
+    visibleInstanceBuffer = vku::Buffer(vc, instanceBufferSize, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer);
+    indirectBuffer = vku::Buffer(vc, sizeof(vk::DrawIndexedIndirectCommand),
+                                 vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc);
+    for (int i = 0; i < vc.MAX_FRAMES_IN_FLIGHT; i++) {
+      visibleCountReadback.emplace_back(vc, static_cast<uint32_t>(sizeof(uint32_t)), vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+      *static_cast<uint32_t*>(visibleCountReadback.back().allocation.mappedData) = 0;
+    }
+
+    transformBufferSize = static_cast<uint32_t>(monkeyTransformsToGPU.size() * sizeof(vku::TransformGPU));
+    transformBuffer = vku::Buffer(vc, monkeyTransformsToGPU.data(), transformBufferSize, vk::BufferUsageFlagBits::eStorageBuffer);
+
+    uint32_t vboSizeBytes = (uint32_t)(allMeshesData.vertices.size() * sizeof(vku::DefaultVertex));
+    vbo = vku::Buffer(vc, allMeshesData.vertices.data(), vboSizeBytes, vk::BufferUsageFlagBits::eVertexBuffer);
+
+    uint32_t iboSizeBytes = (uint32_t)(allMeshesData.indices.size() * sizeof(uint32_t));
+    indexCount = (uint32_t)allMeshesData.indices.size();
+    ibo = vku::Buffer(vc, allMeshesData.indices.data(), iboSizeBytes, vk::BufferUsageFlagBits::eIndexBuffer);
+  }
+
+  const std::vector<uint32_t> entityVertexSpv = entityVertexSpvFuture.get();
+  const std::vector<uint32_t> entityFragmentSpv = entityFragmentSpvFuture.get();
+  const std::vector<uint32_t> instanceVertexSpv = instanceVertexSpvFuture.get();
+  const std::vector<uint32_t> instanceFragmentSpv = instanceFragmentSpvFuture.get();
+  const std::vector<uint32_t> transformComputeSpv = transformComputeSpvFuture.get();
+  const std::vector<uint32_t> cullComputeSpv = cullComputeSpvFuture.get();
+
+  //---- Graphics
+  {
+    // Uniforms and entities are storage buffers in vc.bindlessHeap. Shaders index its array with BindlessIndices push constants,
+    // hence a single set is bound per frame instead of sets per frame, pass, material and entities
+    bindlessHeap = &vc.bindlessHeap;
+    for (uint32_t i = 0; i < vc.MAX_FRAMES_IN_FLIGHT; i++) {
+      perFrameUniform.emplace_back(vc, PerFrameUniform{}, vk::BufferUsageFlagBits::eStorageBuffer);
+      perPassUniform.emplace_back(vc, PerPassUniform{}, vk::BufferUsageFlagBits::eStorageBuffer);
+      perMaterialUniform.emplace_back(vc, MaterialUniform{}, vk::BufferUsageFlagBits::eStorageBuffer);
+      bindlessIndices.push_back(BindlessIndices{
+          .perFrame = vc.bindlessHeap.addStorageBuffer(perFrameUniform.back().descriptor),
+          .perPass = vc.bindlessHeap.addStorageBuffer(perPassUniform.back().descriptor),
+          .material = vc.bindlessHeap.addStorageBuffer(perMaterialUniform.back().descriptor),
+          // each frame slot has its own copy of entities, see vku::EntityStore
+          .entities = vc.bindlessHeap.addStorageBuffer(entityStore.getDescriptorBufferInfo(i)),
+      });
+    }
+
+    const vk::PushConstantRange pushConstantRange{vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(BindlessIndices)};
+    const vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo{{}, *vc.bindlessHeap.getDescriptorSetLayout(), pushConstantRange};
+    pipelineLayoutGraphics = vk::raii::PipelineLayout{vc.device, pipelineLayoutCreateInfo};
+
+    initPipelineWithEntities(appSettings, vc, entityVertexSpv, entityFragmentSpv);
+    initPipelineWithInstances(appSettings, vc, instanceVertexSpv, instanceFragmentSpv);
+  }
+
+  //---- Compute Uniform Data
+  computeUniformBuffer = vku::UniformBuffer<ComputeUniforms>(vc);
+
+  //---- Descriptor Set - Compute
+  {
+    const std::array<vk::DescriptorSetLayoutBinding, 3> layoutBindings{
+        vk::DescriptorSetLayoutBinding{0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},  // layout(set=0, binding=0) buffer buf; // transforms
+        vk::DescriptorSetLayoutBinding{1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},  // layout(set=0, binding=1) buffer buf; // transformMatrices
+        vk::DescriptorSetLayoutBinding{2, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute},  // layout(set=0, binding=2)
+    };
+    const vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{{}, layoutBindings};
+    const vk::raii::DescriptorSetLayout descriptorSetLayout{vc.device, descriptorSetLayoutCreateInfo};
+
+    // Allocate one descriptor set per instance buffer from the pool
+    const std::vector<vk::DescriptorSetLayout> descriptorSetLayouts(instanceBuffers.size(), *descriptorSetLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo(*vc.descriptorPool, descriptorSetLayouts);
+    computeDescriptorSets = vk::raii::DescriptorSets(vc.device, allocateInfo);
+
+    for (size_t i = 0; i < instanceBuffers.size(); ++i) {
+      vk::WriteDescriptorSet writeDescriptorSet;
+      writeDescriptorSet.dstSet = *computeDescriptorSets[i];
+
+      // Binding 0 and 1: Storage Buffer for transforms and transform matrices
+      std::array<vk::DescriptorBufferInfo, 2> descriptorBufferInfosStorage{
+          vk::DescriptorBufferInfo(*transformBuffer.buffer, 0, transformBufferSize),
+          vk::DescriptorBufferInfo(*instanceBuffers[i].buffer, 0, instanceBufferSize),
+      };
+      writeDescriptorSet.descriptorCount = 2;
+      writeDescriptorSet.descriptorType = vk::DescriptorType::eStorageBuffer;
+      writeDescriptorSet.pBufferInfo = descriptorBufferInfosStorage.data();
+      writeDescriptorSet.dstBinding = 0;  // {0, 1}
+      vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
+
+      // Binding 2: Uniform Buffer for target position
+      writeDescriptorSet.descriptorCount = 1;
+      writeDescriptorSet.descriptorType = vk::DescriptorType::eUniformBuffer;
+      writeDescriptorSet.pBufferInfo = &computeUniformBuffer.descriptor;
+      writeDescriptorSet.dstBinding = 2;  // dstBindingPrev + descriptorCountPrev;
+      vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
+    }
+
+    initPipelineWithCompute(appSettings, vc, descriptorSetLayout, transformComputeSpv);
+  }
+
+  //---- Descriptor Set - Cull
+  {
+    const std::array<vk::DescriptorSetLayoutBinding, 3> layoutBindings{
+        vk::DescriptorSetLayoutBinding{0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},  // all instances
+        vk::DescriptorSetLayoutBinding{1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},  // visible instances
+        vk::DescriptorSetLayoutBinding{2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},  // indirect draw command
+    };
+    const vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{{}, layoutBindings};
+    const vk::raii::DescriptorSetLayout descriptorSetLayout{vc.device, descriptorSetLayoutCreateInfo};
+
+    const std::vector<vk::DescriptorSetLayout> descriptorSetLayouts(instanceBuffers.size(), *descriptorSetLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo(*vc.descriptorPool, descriptorSetLayouts);
+    cullDescriptorSets = vk::raii::DescriptorSets(vc.device, allocateInfo);
+
+    for (size_t i = 0; i < instanceBuffers.size(); ++i) {
+      std::array<vk::DescriptorBufferInfo, 3> descriptorBufferInfos{
+          vk::DescriptorBufferInfo(*instanceBuffers[i].buffer, 0, instanceBufferSize),
+          vk::DescriptorBufferInfo(*visibleInstanceBuffer.buffer, 0, instanceBufferSize),
+          vk::DescriptorBufferInfo(*indirectBuffer.buffer, 0, sizeof(vk::DrawIndexedIndirectCommand)),
+      };
+      vk::WriteDescriptorSet writeDescriptorSet;
+      writeDescriptorSet.dstSet = *cullDescriptorSets[i];
+      writeDescriptorSet.descriptorCount = 3;
+      writeDescriptorSet.descriptorType = vk::DescriptorType::eStorageBuffer;
+      writeDescriptorSet.pBufferInfo = descriptorBufferInfos.data();
+      writeDescriptorSet.dstBinding = 0;  // {0, 1, 2}
+      vc.device.updateDescriptorSets(writeDescriptorSet, nullptr);
+    }
+
+    initPipelineWithCull(appSettings, vc, descriptorSetLayout, cullComputeSpv);
+  }
+
+  //---- Async Compute
+  if (useAsyncCompute) {
+    computeCommandPool = vk::raii::CommandPool(vc.device, vk::CommandPoolCreateInfo{vk::CommandPoolCreateFlagBits::eResetCommandBuffer, vc.computeQueueFamilyIndex});
+    computeCommandBuffers = vk::raii::CommandBuffers(vc.device, vk::CommandBufferAllocateInfo{*computeCommandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(instanceBuffers.size())});
+    vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo(vk::SemaphoreType::eTimeline, 0);
+    computeTimeline = vk::raii::Semaphore{vc.device, vk::SemaphoreCreateInfo({}, &semaphoreTypeCreateInfo)};
+    instanceBufferReaderFrameValues.resize(instanceBuffers.size(), 0);
+  }
+}
+
+void TransformGPUConstructionStudy::initPipelineWithEntities(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const std::vector<uint32_t>& vertexSpv, const std::vector<uint32_t>& fragmentSpv) {
+  const vk::raii::ShaderModule vertexShader = vku::spirv::makeShaderModule(vc.device, vertexSpv);
+  const vk::raii::ShaderModule fragmentShader = vku::spirv::makeShaderModule(vc.device, fragmentSpv);
+  std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos = {
+      vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertexShader, "main"),
+      vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragmentShader, "main")};
+
+  vku::VertexInputStateCreateInfo vertexInputStateCreateInfo(
+      {
+          {0, sizeof(vku::DefaultVertex), vk::VertexInputRate::eVertex},
+      },
+      {{
+          {0, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, position)},
+          {1, 0, vk::Format::eR32G32Sfloat, offsetof(vku::DefaultVertex, texCoord)},
+          {2, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, normal)},
+          {3, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(vku::DefaultVertex, color)},
+      }});
+
+  vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo({}, vk::PrimitiveTopology::eTriangleList, false);
+
+  std::array<vk::Viewport, 1> viewports = {vk::Viewport{0.f, 0.f, static_cast<float>(vc.swapchainExtent.width), static_cast<float>(vc.swapchainExtent.height), 0.f, 1.f}};
+  std::array<vk::Rect2D, 1> scissors = {vk::Rect2D{vk::Offset2D{0, 0}, vc.swapchainExtent}};
+  vk::PipelineViewportStateCreateInfo viewportStateCreateInfo({}, viewports, scissors);
+
+  vk::PipelineRasterizationStateCreateInfo rasterizationStateCreateInfo({},                                // flags
+                                                                        false,                             // depthClampEnable
+                                                                        false,                             // rasterizerDiscardEnable
+                                                                        vk::PolygonMode::eFill,            // polygonMode
+                                                                        vk::CullModeFlagBits::eBack,       // cullMode {eBack}
+                                                                        vk::FrontFace::eCounterClockwise,  // frontFace
+                                                                        false,                             // depthBiasEnable
+                                                                        0.0f,                              // depthBiasConstantFactor
+                                                                        0.0f,                              // depthBiasClamp
+                                                                        0.0f,                              // depthBiasSlopeFactor
+                                                                        1.0f                               // lineWidth
+  );
+
+  vk::PipelineMultisampleStateCreateInfo multisampleStateCreateInfo({}, vc.swapchainSamples);
+
+  vk::StencilOpState stencilOpState(vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::CompareOp::eAlways);
+  vk::PipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo({},                           // flags
+                                                                      true,                         // depthTestEnable
+                                                                      true,                         // depthWriteEnable
+                                                                      vk::CompareOp::eLessOrEqual,  // depthCompareOp
+                                                                      false,                        // depthBoundTestEnable
+                                                                      false,                        // stencilTestEnable
+                                                                      stencilOpState,               // front
+                                                                      stencilOpState                // back
+  );
+
+  vk::ColorComponentFlags colorComponentFlags(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+  vk::PipelineColorBlendAttachmentState colorBlendAttachmentState(false,                   // blendEnable
+                                                                  vk::BlendFactor::eZero,  // srcColorBlendFactor, defaults...
+                                                                  vk::BlendFactor::eZero,  // dstColorBlendFactor
+                                                                  vk::BlendOp::eAdd,       // colorBlendOp
+                                                                  vk::BlendFactor::eZero,  // srcAlphaBlendFactor
+                                                                  vk::BlendFactor::eZero,  // dstAlphaBlendFactor
+                                                                  vk::BlendOp::eAdd,       // alphaBlendOp
+                                                                  colorComponentFlags      // colorWriteMask
+  );
+  vk::PipelineColorBlendStateCreateInfo colorBlendStateCreateInfo({},                         // flags
+                                                                  false,                      // logicOpEnable
+                                                                  vk::LogicOp::eNoOp,         // logicOp
+                                                                  colorBlendAttachmentState,  // attachments
+                                                                  {{0.f, 0.f, 0.f, 0.f}}      // blendConstants
+  );
+
+  std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+  vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo({}, dynamicStates);
+
+  vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
+      {},
+      shaderStageCreateInfos,
+      &vertexInputStateCreateInfo,
+      &inputAssemblyStateCreateInfo,
+      nullptr,  // *vk::PipelineTessellationStateCreateInfo
+      &viewportStateCreateInfo,
+      &rasterizationStateCreateInfo,
+      &multisampleStateCreateInfo,
+      appSettings.hasPresentDepth ? &depthStencilStateCreateInfo : nullptr,
+      &colorBlendStateCreateInfo,
+      &dynamicStateCreateInfo,  // *vk::PipelineDynamicStateCreateInfo
+      *pipelineLayoutGraphics,  // vk::PipelineLayout
+      *vc.renderPass            // vk::RenderPass
+                                //{}, // uint32_t subpass_ = {},
+  );
+
+  pipelineEntities = std::make_unique<vk::raii::Pipeline>(vc.device, vc.pipelineCache, graphicsPipelineCreateInfo);
+  assert(pipelineEntities->getConstructorSuccessCode() == vk::Result::eSuccess);
+}
+
+void TransformGPUConstructionStudy::initPipelineWithInstances(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const std::vector<uint32_t>& vertexSpv, const std::vector<uint32_t>& fragmentSpv) {
+  const vk::raii::ShaderModule vertexShader = vku::spirv::makeShaderModule(vc.device, vertexSpv);
+  const vk::raii::ShaderModule fragmentShader = vku::spirv::makeShaderModule(vc.device, fragmentSpv);
+  std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos = {
+      vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertexShader, "main"),
+      vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragmentShader, "main")};
+
+  vku::VertexInputStateCreateInfo vertexInputStateCreateInfo(
+      {
+          {0, sizeof(vku::DefaultVertex), vk::VertexInputRate::eVertex},
+          {1, sizeof(InstanceData), vk::VertexInputRate::eInstance},
+      },
+      {{
+          {0, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, position)},
+          {1, 0, vk::Format::eR32G32Sfloat, offsetof(vku::DefaultVertex, texCoord)},
+          {2, 0, vk::Format::eR32G32B32Sfloat, offsetof(vku::DefaultVertex, normal)},
+          {3, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(vku::DefaultVertex, color)},
+
+          {4, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 0},
+          {5, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 1},
+          {6, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 2},
+          {7, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 3},
+          {8, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 4},
+          {9, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 5},
+          {10, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 6},
+          {11, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 7},
+          {12, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(glm::vec4) * 8},
+      }});
+
+  vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo({}, vk::PrimitiveTopology::eTriangleList, false);
+
+  std::array<vk::Viewport, 1> viewports = {vk::Viewport{0.f, 0.f, static_cast<float>(vc.swapchainExtent.width), static_cast<float>(vc.swapchainExtent.height), 0.f, 1.f}};
+  std::array<vk::Rect2D, 1> scissors = {vk::Rect2D{vk::Offset2D{0, 0}, vc.swapchainExtent}};
+  vk::PipelineViewportStateCreateInfo viewportStateCreateInfo({}, viewports, scissors);
+
+  // TODO: fix obj loading. Looks like face orientations are incorrect? I had to cull front faces. :-O
+  vk::PipelineRasterizationStateCreateInfo rasterizationStateCreateInfo({},                                // flags
+                                                                        false,                             // depthClampEnable
+                                                                        false,                             // rasterizerDiscardEnable
+                                                                        vk::PolygonMode::eFill,            // polygonMode
+                                                                        vk::CullModeFlagBits::eBack,       // cullMode {eBack}
+                                                                        vk::FrontFace::eCounterClockwise,  // frontFace
+                                                                        false,                             // depthBiasEnable
+                                                                        0.0f,                              // depthBiasConstantFactor
+                                                                        0.0f,                              // depthBiasClamp
+                                                                        0.0f,                              // depthBiasSlopeFactor
+                                                                        1.0f                               // lineWidth
+  );
+
+  vk::PipelineMultisampleStateCreateInfo multisampleStateCreateInfo({}, vc.swapchainSamples);
+
+  vk::StencilOpState stencilOpState(vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::CompareOp::eAlways);
+  vk::PipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo({},                           // flags
+                                                                      true,                         // depthTestEnable
+                                                                      true,                         // depthWriteEnable
+                                                                      vk::CompareOp::eLessOrEqual,  // depthCompareOp
+                                                                      false,                        // depthBoundTestEnable
+                                                                      false,                        // stencilTestEnable
+                                                                      stencilOpState,               // front
+                                                                      stencilOpState                // back
+  );
+
+  vk::ColorComponentFlags colorComponentFlags(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+  vk::PipelineColorBlendAttachmentState colorBlendAttachmentState(false,                   // blendEnable
+                                                                  vk::BlendFactor::eZero,  // srcColorBlendFactor, defaults...
+                                                                  vk::BlendFactor::eZero,  // dstColorBlendFactor
+                                                                  vk::BlendOp::eAdd,       // colorBlendOp
+                                                                  vk::BlendFactor::eZero,  // srcAlphaBlendFactor
+                                                                  vk::BlendFactor::eZero,  // dstAlphaBlendFactor
+                                                                  vk::BlendOp::eAdd,       // alphaBlendOp
+                                                                  colorComponentFlags      // colorWriteMask
+  );
+  vk::PipelineColorBlendStateCreateInfo colorBlendStateCreateInfo({},                         // flags
+                                                                  false,                      // logicOpEnable
+                                                                  vk::LogicOp::eNoOp,         // logicOp
+                                                                  colorBlendAttachmentState,  // attachments
+                                                                  {{0.f, 0.f, 0.f, 0.f}}      // blendConstants
+  );
+
+  std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+  vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo({}, dynamicStates);
+
+  vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
+      {},
+      shaderStageCreateInfos,
+      &vertexInputStateCreateInfo,
+      &inputAssemblyStateCreateInfo,
+      nullptr,  // *vk::PipelineTessellationStateCreateInfo
+      &viewportStateCreateInfo,
+      &rasterizationStateCreateInfo,
+      &multisampleStateCreateInfo,
+      appSettings.hasPresentDepth ? &depthStencilStateCreateInfo : nullptr,
+      &colorBlendStateCreateInfo,
+      &dynamicStateCreateInfo,  // *vk::PipelineDynamicStateCreateInfo
+      *pipelineLayoutGraphics,  // vk::PipelineLayout
+      *vc.renderPass            // vk::RenderPass
+                                //{}, // uint32_t subpass_ = {},
+  );
+
+  pipelineInstance = std::make_unique<vk::raii::Pipeline>(vc.device, vc.pipelineCache, graphicsPipelineCreateInfo);
+  assert(pipelineInstance->getConstructorSuccessCode() == vk::Result::eSuccess);
+}
+
+void TransformGPUConstructionStudy::initPipelineWithCompute(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const vk::raii::DescriptorSetLayout& descriptorSetLayout, const std::vector<uint32_t>& computeSpv) {
+  vk::raii::ShaderModule computeShader = vku::spirv::makeShaderModule(vc.device, computeSpv);
 
   vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo;
   pipelineLayoutCreateInfo.setSetLayouts(*descriptorSetLayout);
   pipelineLayoutCompute = {vc.device, pipelineLayoutCreateInfo};  // { flags, descriptorSetLayout }
 
-  vk::PipelineShaderStageCreateInfo shaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, *computeShader, "main");
+  const vk::PhysicalDeviceLimits limits = vc.physicalDevice.getProperties().limits;
+  const uint32_t maxLocalSize = std::min(limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupInvocations);
+  if (computeLocalSize > maxLocalSize) {
+    std::cerr << std::format("Compute local size {} exceeds device limit, using {}\n", computeLocalSize, maxLocalSize);
+    computeLocalSize = maxLocalSize;
+  }
+  computeLocalSize = std::max(computeLocalSize, 1u);
+  const vk::SpecializationMapEntry specializationMapEntry{0, 0, sizeof(uint32_t)};  // constant_id = 0 -> local_size_x
+  const vk::SpecializationInfo specializationInfo{1, &specializationMapEntry, sizeof(uint32_t), &computeLocalSize};
+  vk::PipelineShaderStageCreateInfo shaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, *computeShader, "main", &specializationInfo);
 
-  pipelineCompute = std::make_unique<vk::raii::Pipeline>(vc.device, nullptr,
+  pipelineCompute = std::make_unique<vk::raii::Pipeline>(vc.device, vc.pipelineCache,
                                                          vk::ComputePipelineCreateInfo({}, shaderStageCreateInfo, *pipelineLayoutCompute));
   assert(pipelineCompute->getConstructorSuccessCode() == vk::Result::eSuccess);
 }
 
+void TransformGPUConstructionStudy::initPipelineWithCull([[maybe_unused]] const vku::AppSettings appSettings, const vku::VulkanContext& vc, const vk::raii::DescriptorSetLayout& descriptorSetLayout, const std::vector<uint32_t>& computeSpv) {
+  vk::raii::ShaderModule computeShader = vku::spirv::makeShaderModule(vc.device, computeSpv);
+
+  vk::PushConstantRange pushConstantRange{vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullPushConstants)};
+  const vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo{{}, *descriptorSetLayout, pushConstantRange};
+  pipelineLayoutCull = {vc.device, pipelineLayoutCreateInfo};
+
+  vk::PipelineShaderStageCreateInfo shaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, *computeShader, "main");
+
+  pipelineCull = std::make_unique<vk::raii::Pipeline>(vc.device, vc.pipelineCache,
+                                                      vk::ComputePipelineCreateInfo({}, shaderStageCreateInfo, *pipelineLayoutCull));
+  assert(pipelineCull->getConstructorSuccessCode() == vk::Result::eSuccess);
+}
+
 void TransformGPUConstructionStudy::onUpdate(const vku::UpdateParams& params) {
   static float t = 0.0f;
 
   ImGui::Begin("Scene");
-  ImGui::Text("Entities");
+  ImGui::Text("Entities: %zu in %u indirect draws", entityStore.size(), numEntityDraws);
   static bool isBoxInteractive = false;
   ImGui::Checkbox("Interactive Box", &isBoxInteractive);
   if (isBoxInteractive) {
-    ImGui::DragFloat3("Box Pos", glm::value_ptr(entities[0].transform.position));
+    glm::vec3 boxPos = entityStore.getPosition(0);
+    if (ImGui::DragFloat3("Box Pos", glm::value_ptr(boxPos)))
+      entityStore.setPosition(0, boxPos);
   } else {
     static float r = 2.0f;
     float theta = t * 0.5f;
     float sx = r * std::cos(theta);
     float sy = r * std::sin(theta);
-    entities[0].transform.position = glm::vec3{
-                                         glm::perlin(glm::vec3{sx, sy, -2}),
-                                         glm::perlin(glm::vec3{sx, sy, 0}),
-                                         glm::perlin(glm::vec3{sx, sy, 2})} *
-                                     10.0f;
+    entityStore.setPosition(0, glm::vec3{
+                                   glm::perlin(glm::vec3{sx, sy, -2}),
+                                   glm::perlin(glm::vec3{sx, sy, 0}),
+                                   glm::perlin(glm::vec3{sx, sy, 2})} *
+                                   10.0f);
   }
-  ImGui::DragFloat3("Axes Pos", glm::value_ptr(entities[1].transform.position));
+  glm::vec3 axesPos = entityStore.getPosition(1);
+  if (ImGui::DragFloat3("Axes Pos", glm::value_ptr(axesPos)))
+    entityStore.setPosition(1, axesPos);
+  ImGui::Checkbox("Frustum Culling", &isCullingEnabled);
+  // written by the GPU when this frame in flight slot was used last time, drawFrameBegin() has waited for that frame already
+  const uint32_t numVisibleMonkeys = *static_cast<const uint32_t*>(visibleCountReadback[params.frameInFlightNo].allocation.mappedData);
+  ImGui::Text("Visible monkeys: %u / %u", numVisibleMonkeys, numMonkeyInstances);
+  ImGui::Text("Transforms computed on: %s", useAsyncCompute ? "compute queue (async)" : "graphics queue");
 
   static bool shouldTargetCamera = false;
   ImGui::Checkbox("Target Camera?", &shouldTargetCamera);
-  const glm::vec3 targetPosition = shouldTargetCamera ? camera.getPosition() : entities[0].transform.position;
+  const glm::vec3 targetPosition = shouldTargetCamera ? camera.getPosition() : entityStore.getPosition(0);
 
   static bool shouldTurnInstantly = true;
   ImGui::Checkbox("Instant Turn", &shouldTurnInstantly);
@@ -1021,11 +1164,12 @@ void TransformGPUConstructionStudy::onUpdate(const vku::UpdateParams& params) {
     ImGui::Text("maxAngle: %f", maxAngle);
   }
 
-  ImGui::Text("Axes Rot (Quat) {%.1f, %.1f, %.1f, %.1f}, norm: %.2f", entities[1].transform.rotation.x, entities[1].transform.rotation.y, entities[1].transform.rotation.z, entities[1].transform.rotation.w, glm::length(entities[1].transform.rotation));
-  const glm::vec3 axis = glm::axis(entities[1].transform.rotation);
-  ImGui::Text("Axes Rot (AA) %.1f, {%.1f, %.1f, %.1f}", glm::angle(entities[1].transform.rotation), axis.x, axis.y, axis.z);
-  const glm::vec3 euler = glm::eulerAngles(entities[1].transform.rotation);
-  ImGui::Text("Axes Rot (Euler) {%.1f, %.1f, %.1f}", glm::angle(entities[1].transform.rotation), euler.x, euler.y, euler.z);
+  const glm::quat axesRot = entityStore.getRotation(1);
+  ImGui::Text("Axes Rot (Quat) {%.1f, %.1f, %.1f, %.1f}, norm: %.2f", axesRot.x, axesRot.y, axesRot.z, axesRot.w, glm::length(axesRot));
+  const glm::vec3 axis = glm::axis(axesRot);
+  ImGui::Text("Axes Rot (AA) %.1f, {%.1f, %.1f, %.1f}", glm::angle(axesRot), axis.x, axis.y, axis.z);
+  const glm::vec3 euler = glm::eulerAngles(axesRot);
+  ImGui::Text("Axes Rot (Euler) {%.1f, %.1f, %.1f}", glm::angle(axesRot), euler.x, euler.y, euler.z);
   ImGui::Separator();
 
   ImGui::Text("Camera");
@@ -1080,50 +1224,181 @@ void TransformGPUConstructionStudy::onUpdate(const vku::UpdateParams& params) {
   computeUniformBuffer.src.shouldTurnInstantly = glm::ivec4(static_cast<int>(shouldTurnInstantly), 0, 0, 0);
   computeUniformBuffer.update();
 
+  entityStore.update(params.frameInFlightNo);
+
   ImGui::End();
 
   t += params.deltaTime;
 }
 
+void TransformGPUConstructionStudy::submitAsyncCompute(const vku::VulkanContext& vc, uint64_t frameNo) {
+  const size_t ix = frameNo % instanceBuffers.size();
+  const vk::Buffer instanceBuffer = *instanceBuffers[ix].buffer;
+  const vk::raii::CommandBuffer& cmdBuf = computeCommandBuffers[ix];
+  // first two frames write into buffers that have not been used by graphics yet
+  const bool isFirstUse = frameNo < instanceBuffers.size();
+  const bool needsOwnershipTransfer = vc.computeQueueFamilyIndex != vc.graphicsQueueFamilyIndex;
+
+  // CommandBuffer was used for frame M - 2. Graphics frame M - 2 has waited for it already, so this does not block in practice
+  if (!isFirstUse) {
+    const vk::SemaphoreWaitInfo waitInfo({}, *computeTimeline, frameNo - 1);
+    [[maybe_unused]] const vk::Result result = vc.device.waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max());
+    assert(result == vk::Result::eSuccess);
+  }
+
+  cmdBuf.reset();
+  cmdBuf.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  // previous submission on this queue updated rotations in transformBuffer
+  vk::MemoryBarrier memBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, memBarrier, nullptr, nullptr);
+  if (!isFirstUse && needsOwnershipTransfer) {
+    // acquire half of the transfer released by graphics frame M - 2. Ordered after the release by the frame timeline wait below
+    const vk::BufferMemoryBarrier acquire({}, vk::AccessFlagBits::eShaderWrite, vc.graphicsQueueFamilyIndex, vc.computeQueueFamilyIndex, instanceBuffer, 0, VK_WHOLE_SIZE);
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader, {}, nullptr, acquire, nullptr);
+  }
+  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayoutCompute, 0, *computeDescriptorSets[ix], nullptr);
+  cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, **pipelineCompute);
+  cmdBuf.dispatch((numMonkeyInstances + computeLocalSize - 1) / computeLocalSize, 1, 1);
+  if (needsOwnershipTransfer) {
+    // release half of the transfer to graphics frame M, which acquires it before culling
+    const vk::BufferMemoryBarrier release(vk::AccessFlagBits::eShaderWrite, {}, vc.computeQueueFamilyIndex, vc.graphicsQueueFamilyIndex, instanceBuffer, 0, VK_WHOLE_SIZE);
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, release, nullptr);
+  }
+  cmdBuf.end();
+
+  std::vector<vk::Semaphore> waitSemaphores;
+  std::vector<vk::PipelineStageFlags> waitStages;
+  std::vector<uint64_t> waitValues;
+  // graphics frame M - 2 is done reading this instance buffer
+  if (!isFirstUse) {
+    waitSemaphores.push_back(*vc.getFrameTimelineSemaphore());
+    waitStages.push_back(vk::PipelineStageFlagBits::eComputeShader);
+    waitValues.push_back(instanceBufferReaderFrameValues[ix]);
+  }
+  // transformBuffer might still be uploading
+  const uint64_t uploadTimelineValue = vc.uploadQueue.flush();
+  if (!vc.uploadQueue.isComplete(uploadTimelineValue)) {
+    waitSemaphores.push_back(*vc.uploadQueue.getTimelineSemaphore());
+    waitStages.push_back(vk::PipelineStageFlagBits::eComputeShader);
+    waitValues.push_back(uploadTimelineValue);
+  }
+  const uint64_t signalValue = frameNo + 1;
+  const vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo(waitValues, signalValue);
+  const vk::SubmitInfo submitInfo(waitSemaphores, waitStages, *cmdBuf, *computeTimeline, &timelineSubmitInfo);
+  vc.computeQueue.submit(submitInfo);
+}
+
 void TransformGPUConstructionStudy::recordCommandBuffer(const vku::VulkanContext& vc, const vku::FrameDrawer& frameDrawer) {
 
   const vk::raii::CommandBuffer& cmdBuf = frameDrawer.commandBuffer;
-  // compute monkey transforms
-  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayoutCompute, 0, *computeDescriptorSets[0], nullptr);
-  cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, **pipelineCompute);
-  cmdBuf.dispatch(numMonkeyInstances, 1, 1);
-  vk::MemoryBarrier memBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eVertexAttributeRead);
-  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eVertexInput, {}, memBarrier, nullptr, nullptr);
+  const size_t instanceBufferIx = useAsyncCompute ? asyncFrameNo % instanceBuffers.size() : 0;
+  const vk::Buffer instanceBuffer = *instanceBuffers[instanceBufferIx].buffer;
+  const bool needsOwnershipTransfer = useAsyncCompute && vc.computeQueueFamilyIndex != vc.graphicsQueueFamilyIndex;
+  if (useAsyncCompute) {
+    // nothing has computed the very first frame's transforms ahead of time
+    if (asyncFrameNo == 0)
+      submitAsyncCompute(vc, 0);
+    // runs on computeQueue while this frame is being drawn on graphicsQueue
+    submitAsyncCompute(vc, asyncFrameNo + 1);
+    // culling reads transforms computed for this frame. Compute of frame N + 2 overwrites its instance buffer after this frame's value is signaled
+    vc.addFrameWaitSemaphore(*computeTimeline, asyncFrameNo + 1, vk::PipelineStageFlagBits::eComputeShader);
+    instanceBufferReaderFrameValues[instanceBufferIx] = vc.getCurrentFrameValue();
+  }
+  // previous frame's draw reads instance and indirect buffers that are rewritten below (write-after-read, execution dependency is enough)
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eTransfer,
+                         vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {}, nullptr, nullptr, nullptr);
+  // reset instanceCount, culling counts visible instances into it
+  const Mesh& monkeyMesh = meshes[MeshId::Monkey];
+  cmdBuf.updateBuffer<vk::DrawIndexedIndirectCommand>(*indirectBuffer.buffer, 0, vk::DrawIndexedIndirectCommand{monkeyMesh.size, 0, monkeyMesh.offset, 0, 0});
+  {
+    vk::MemoryBarrier memBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, memBarrier, nullptr, nullptr);
+  }
+  if (needsOwnershipTransfer) {
+    // acquire half of the transfer released by the compute queue. Ordered after the release by the computeTimeline wait of this frame's submission
+    const vk::BufferMemoryBarrier acquire({}, vk::AccessFlagBits::eShaderRead, vc.computeQueueFamilyIndex, vc.graphicsQueueFamilyIndex, instanceBuffer, 0, VK_WHOLE_SIZE);
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader, {}, nullptr, acquire, nullptr);
+  }
+  // compute monkey transforms, unless they have been computed on computeQueue
+  if (!useAsyncCompute) {
+    {
+      auto s = frameDrawer.profiler.scope(cmdBuf, "monkey compute");
+      cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayoutCompute, 0, *computeDescriptorSets[0], nullptr);
+      cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, **pipelineCompute);
+      cmdBuf.dispatch((numMonkeyInstances + computeLocalSize - 1) / computeLocalSize, 1, 1);
+    }
+    vk::MemoryBarrier memBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, memBarrier, nullptr, nullptr);
+  }
+  // cull monkeys against the view frustum, compact visible ones and write the indirect draw command
+  {
+    auto s = frameDrawer.profiler.scope(cmdBuf, "monkey cull");
+    CullPushConstants pc{.boundingSphere = monkeyBoundingSphere, .numInstances = numMonkeyInstances};
+    if (isCullingEnabled)
+      pc.frustumPlanes = vku::extractFrustumPlanes(perPassUniform[frameDrawer.frameNo].src.projectionFromWorld);
+    else
+      pc.frustumPlanes.fill(glm::vec4{0, 0, 0, 1});  // every point is inside
+    cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayoutCull, 0, *cullDescriptorSets[instanceBufferIx], nullptr);
+    cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, **pipelineCull);
+    cmdBuf.pushConstants<CullPushConstants>(*pipelineLayoutCull, vk::ShaderStageFlagBits::eCompute, 0u, pc);
+    cmdBuf.dispatch((numMonkeyInstances + 63) / 64, 1, 1);
+  }
+  if (needsOwnershipTransfer) {
+    // culling was the last reader, release half of the transfer back to the compute queue for frame N + 2
+    const vk::BufferMemoryBarrier release({}, {}, vc.graphicsQueueFamilyIndex, vc.computeQueueFamilyIndex, instanceBuffer, 0, VK_WHOLE_SIZE);
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, release, nullptr);
+  }
+  {
+    vk::MemoryBarrier memBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eTransferRead);
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eTransfer, {}, memBarrier, nullptr, nullptr);
+  }
+  // copy visible count for the UI. Read on the CPU when this frame in flight slot comes around again, so no stall
+  cmdBuf.copyBuffer(*indirectBuffer.buffer, *visibleCountReadback[frameDrawer.frameNo].buffer, vk::BufferCopy{offsetof(vk::DrawIndexedIndirectCommand, instanceCount), 0, sizeof(uint32_t)});
+  {
+    vk::MemoryBarrier memBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, memBarrier, nullptr, nullptr);
+  }
 
-  // Bind per-frame data
-  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayoutPerFrameAndPass, 0, *descriptorSetsGraphics[frameDrawer.frameNo][0], nullptr);
+  // Bind the bindless heap once and select this frame slot's buffers. Both pipelines share the layout, so these stay bound across pipeline switches
+  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayoutGraphics, 0, vc.bindlessHeap.getDescriptorSet(), nullptr);
+  cmdBuf.pushConstants<BindlessIndices>(*pipelineLayoutGraphics, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0u, bindlessIndices[frameDrawer.frameNo]);
 
   const vk::RenderPassBeginInfo renderPassBeginInfo(*vc.renderPass, *frameDrawer.framebuffer, vk::Rect2D{{0, 0}, vc.swapchainExtent}, {});
   cmdBuf.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-  // Bind per-pass data
-  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayoutPerFrameAndPass, 1, *descriptorSetsGraphics[frameDrawer.frameNo][1], nullptr);
 
   vk::DeviceSize offsets = 0;
   cmdBuf.bindVertexBuffers(0, *vbo.buffer, offsets);
   cmdBuf.bindIndexBuffer(*ibo.buffer, 0, vk::IndexType::eUint32);
   // Draw entities
-  cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, **pipelinePushConstant);
-  for (auto& e : entities) {
-    const PushConstants& pco = e.getPushConstants();
-    const Mesh& mesh = e.mesh;
-    assert(sizeof(pco) <= vc.physicalDevice.getProperties().limits.maxPushConstantsSize);  // Push constant data too big
-    cmdBuf.pushConstants<PushConstants>(*pipelineLayoutPushConstant, vk::ShaderStageFlagBits::eVertex, 0u, pco);
-    cmdBuf.drawIndexed(mesh.size, 1, mesh.offset, 0, 0);
+  {
+    auto s = frameDrawer.profiler.scope(cmdBuf, "entities");
+    cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, **pipelineEntities);
+    // all entities with one call, CPU cost doesn't depend on their number
+    cmdBuf.drawIndexedIndirect(*entityIndirectBuffer.buffer, 0, numEntityDraws, sizeof(vk::DrawIndexedIndirectCommand));
   }
 
   // Draw monkey instances
-  cmdBuf.bindVertexBuffers(1, *instanceBuffer.buffer, offsets);
-  cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, **pipelineInstance);
-  // Bind per-material data
-  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayoutInstance, 2, *descriptorSetsGraphics[frameDrawer.frameNo][2], nullptr);
-  cmdBuf.drawIndexed(meshes[MeshId::Monkey].size, numMonkeyInstances, meshes[MeshId::Monkey].offset, 0, 0);
+  {
+    auto s = frameDrawer.profiler.scope(cmdBuf, "monkey instances");
+    cmdBuf.bindVertexBuffers(1, *visibleInstanceBuffer.buffer, offsets);
+    cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, **pipelineInstance);
+    // instance count comes from culling, no CPU round trip
+    cmdBuf.drawIndexedIndirect(*indirectBuffer.buffer, 0, 1, sizeof(vk::DrawIndexedIndirectCommand));
+  }
 
   cmdBuf.endRenderPass();
+
+  if (useAsyncCompute)
+    ++asyncFrameNo;
 }
 
-void TransformGPUConstructionStudy::onDeinit() {}
\ No newline at end of file
+void TransformGPUConstructionStudy::onDeinit() {
+  // slots are reused only after in-flight frames are done with them
+  for (const BindlessIndices& ix : bindlessIndices) {
+    bindlessHeap->removeStorageBuffer(ix.perFrame);
+    bindlessHeap->removeStorageBuffer(ix.perPass);
+    bindlessHeap->removeStorageBuffer(ix.material);
+    bindlessHeap->removeStorageBuffer(ix.entities);
+  }
+  bindlessIndices.clear();
+}
\ No newline at end of file
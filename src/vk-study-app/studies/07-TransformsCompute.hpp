@@ -2,14 +2,18 @@
 
 #include "../StudyApp/Study.hpp"
 
+#include "../vku/BindlessHeap.hpp"
 #include "../vku/Buffer.hpp"
 #include "../vku/Camera.hpp"
+#include "../vku/EntityStore.hpp"
 #include "../vku/Math.hpp"
 #include "../vku/UniformBuffer.hpp"
 
 #include <glm/mat4x4.hpp>
 
+#include <array>
 #include <memory>
+#include <vector>
 
 class TransformGPUConstructionStudy : public vku::Study {
   struct Mesh {
@@ -17,20 +21,6 @@ class TransformGPUConstructionStudy : public vku::Study {
     uint32_t size;
   };
 
-  struct PushConstants {
-    glm::mat4x4 worldFromObject;
-    glm::mat4x4 dualWorldFromObject;
-    glm::vec4 color;
-  };
-
-  struct Entity {
-    Mesh mesh;
-    vku::Transform transform;
-    glm::vec4 color;
-
-    PushConstants getPushConstants() const;
-  };
-
   struct MeshId {
     static const size_t Box = 0;
     static const size_t Axes = 1;
@@ -49,6 +39,13 @@ class TransformGPUConstructionStudy : public vku::Study {
     glm::ivec4 shouldTurnInstantly;
   };
 
+  // 6 * 16 + 16 + 4 = 116 bytes, within the guaranteed 128 bytes of push constants
+  struct CullPushConstants {
+    std::array<glm::vec4, 6> frustumPlanes;
+    glm::vec4 boundingSphere;  // xyz: center, w: radius, in object space of the monkey mesh
+    uint32_t numInstances;
+  };
+
   struct PerFrameUniform {
     glm::vec4 time;
     glm::vec4 lightPos;
@@ -68,37 +65,70 @@ class TransformGPUConstructionStudy : public vku::Study {
     glm::ivec4 shouldUseGooch{0, 0, 0, 0};
   };
 
+  // push constants of graphics pipelines: indices into vc.bindlessHeap's storage buffer array
+  struct BindlessIndices {
+    uint32_t perFrame;
+    uint32_t perPass;
+    uint32_t material;
+    uint32_t entities;
+  };
+
  private:
   vku::Buffer vbo;
   vku::Buffer ibo;
-  vku::Buffer instanceBuffer;
+  // written by transform compute, read by culling. Two in async compute mode (one is written for the next frame while the other one is read), one otherwise
+  std::vector<vku::Buffer> instanceBuffers;
   vku::Buffer transformBuffer;
   std::vector<Mesh> meshes;
-  std::vector<Entity> entities;
+  // box and axes. Their matrices and colors are in the store's per frame slot storage buffer, that shader indexes with gl_InstanceIndex
+  vku::EntityStore entityStore;
+  // vk::DrawIndexedIndirectCommand per batch of consecutive entities that share a mesh. firstInstance is the batch's first entity index
+  vku::Buffer entityIndirectBuffer;
+  uint32_t numEntityDraws = 0;
   uint32_t indexCount;
   //
   std::vector<vku::UniformBuffer<PerFrameUniform>> perFrameUniform;
   std::vector<vku::UniformBuffer<PerPassUniform>> perPassUniform;
   std::vector<vku::UniformBuffer<MaterialUniform>> perMaterialUniform;
-  std::vector<vk::raii::DescriptorSets> descriptorSetsGraphics;
+  // one per frame in flight, pushed before drawing
+  std::vector<BindlessIndices> bindlessIndices;
+  // to remove bindlessIndices' slots at onDeinit
+  vku::BindlessHeap* bindlessHeap = nullptr;
   //
   vku::UniformBuffer<ComputeUniforms> computeUniformBuffer;
-  vk::raii::DescriptorSets computeDescriptorSets = nullptr;
-  // for layout that's common to every pipeline (per frame and per pass data)
-  vk::raii::PipelineLayout pipelineLayoutPerFrameAndPass = nullptr;
+  vk::raii::DescriptorSets computeDescriptorSets = nullptr;  // one per instance buffer
+  // shared by every graphics pipeline: bindless heap at set = 0 and BindlessIndices push constants
+  vk::raii::PipelineLayout pipelineLayoutGraphics = nullptr;
   // for rendering entities
-  vk::raii::PipelineLayout pipelineLayoutPushConstant = nullptr;
-  std::unique_ptr<vk::raii::Pipeline> pipelinePushConstant;
+  std::unique_ptr<vk::raii::Pipeline> pipelineEntities;
   // for rendering monkey instances
   uint32_t numMonkeyInstances;
-  vk::raii::PipelineLayout pipelineLayoutInstance = nullptr;
   std::unique_ptr<vk::raii::Pipeline> pipelineInstance;
   // for computing monkey transforms
   vk::raii::PipelineLayout pipelineLayoutCompute = nullptr;
   std::unique_ptr<vk::raii::Pipeline> pipelineCompute;
+  uint32_t computeLocalSize;  // workgroup size, given to the shader as a specialization constant
+  // async compute mode: transforms of frame N + 1 are computed on computeQueue while frame N is being drawn on graphicsQueue
+  bool useAsyncCompute;
+  uint64_t asyncFrameNo = 0;
+  vk::raii::CommandPool computeCommandPool = nullptr;
+  vk::raii::CommandBuffers computeCommandBuffers = nullptr;  // one per instance buffer
+  vk::raii::Semaphore computeTimeline = nullptr;  // transform compute for frame M signals M + 1
+  std::vector<uint64_t> instanceBufferReaderFrameValues;  // VulkanContext frame value of the graphics frame that read each instance buffer last
+  // for frustum culling monkey instances: compacts visible ones into visibleInstanceBuffer and counts them into indirectBuffer
+  vku::Buffer visibleInstanceBuffer;
+  vku::Buffer indirectBuffer;  // a single vk::DrawIndexedIndirectCommand
+  std::vector<vku::Buffer> visibleCountReadback;  // per frame in flight, host visible
+  glm::vec4 monkeyBoundingSphere{};
+  bool isCullingEnabled = true;
+  vk::raii::DescriptorSets cullDescriptorSets = nullptr;  // one per instance buffer
+  vk::raii::PipelineLayout pipelineLayoutCull = nullptr;
+  std::unique_ptr<vk::raii::Pipeline> pipelineCull;
   vku::FirstPersonPerspectiveCamera camera;
 
  public:
+  // computeLocalSize is clamped to device limits
+  explicit TransformGPUConstructionStudy(uint32_t computeLocalSize = 64, bool useAsyncCompute = false);
   virtual ~TransformGPUConstructionStudy() = default;
 
   inline std::string getName() final { return "VertexBuffer upload to GPU, bind to pipeline/shader."; }
@@ -108,7 +138,11 @@ class TransformGPUConstructionStudy : public vku::Study {
   void onDeinit() final;
 
  private:
-  void initPipelineWithPushConstant(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const std::vector<vk::DescriptorSetLayout> descriptorSetLayouts);
-  void initPipelineWithInstances(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const std::vector<vk::DescriptorSetLayout> descriptorSetLayouts);
-  void initPipelineWithCompute(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const vk::raii::DescriptorSetLayout& descriptorSetLayout);
+  // SPIR-V comes from onInit, which compiles every shader of the Study at once
+  void initPipelineWithEntities(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const std::vector<uint32_t>& vertexSpv, const std::vector<uint32_t>& fragmentSpv);
+  void initPipelineWithInstances(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const std::vector<uint32_t>& vertexSpv, const std::vector<uint32_t>& fragmentSpv);
+  void initPipelineWithCompute(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const vk::raii::DescriptorSetLayout& descriptorSetLayout, const std::vector<uint32_t>& computeSpv);
+  void initPipelineWithCull(const vku::AppSettings appSettings, const vku::VulkanContext& vc, const vk::raii::DescriptorSetLayout& descriptorSetLayout, const std::vector<uint32_t>& computeSpv);
+  // Records and submits transform compute of frame M on computeQueue into instanceBuffers[M % 2]
+  void submitAsyncCompute(const vku::VulkanContext& vc, uint64_t frameNo);
 };
\ No newline at end of file
@@ -2,11 +2,22 @@
 
 #include "../vku/utils.hpp"
 
+#include <format>
+#include <iostream>
+
 namespace vku {
-Mesh MeshStore::insertMeshData(const DefaultMeshData& newMesh) {
-  Mesh mesh = {static_cast<uint32_t>(allMeshesData.indices.size()), static_cast<uint32_t>(newMesh.indices.size())};
-  std::ranges::copy(newMesh.vertices, std::back_inserter(allMeshesData.vertices));
-  std::ranges::transform(newMesh.indices, std::back_inserter(allMeshesData.indices), [&](uint32_t ix) { return ix + mesh.offset; });
+Mesh MeshStore::insertMeshData(std::span<const DefaultVertex> vertices, std::span<const uint32_t> indices, bool shouldOptimize) {
+  if (shouldOptimize) {
+    DefaultMeshData optimized{{vertices.begin(), vertices.end()}, {indices.begin(), indices.end()}};
+    const MeshOptimizationReport report = optimizeMesh(optimized);
+    std::cout << std::format("MeshStore: optimized mesh with {} triangles. ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}\n", optimized.indices.size() / 3, report.before.acmr, report.after.acmr,
+                             report.before.atvr, report.after.atvr);
+    return insertMeshData(optimized.vertices, optimized.indices, false);
+  }
+
+  Mesh mesh = {static_cast<uint32_t>(allMeshesData.indices.size()), static_cast<uint32_t>(indices.size())};
+  std::ranges::copy(vertices, std::back_inserter(allMeshesData.vertices));
+  std::ranges::transform(indices, std::back_inserter(allMeshesData.indices), [&](uint32_t ix) { return ix + mesh.offset; });
   return mesh;
 }
 
@@ -20,16 +31,15 @@ void MeshStore::upload(const vku::VulkanContext& vc) {
 }  // namespace vku
 
 OutlinesViaDepthBuffer::PushConstants OutlinesViaDepthBuffer::Entity::getPushConstants() const {
-  PushConstants pc = OutlinesViaDepthBuffer::PushConstants{.worldFromObject = transform.getTransform(), .color = color};
-  pc.dualWorldFromObject = glm::transpose(glm::inverse(pc.worldFromObject));
-  return pc;
+  const vku::TransformMatrices m = transform.getMatrices();
+  return OutlinesViaDepthBuffer::PushConstants{.worldFromObject = m.worldFromObject, .dualWorldFromObject = m.dualWorldFromObject, .color = color};
 }
 
 void OutlinesViaDepthBuffer::onInit(const vku::AppSettings appSettings, const vku::VulkanContext& vc) {
-  meshes.axes = meshStore.insertMeshData(vku::makeAxes());
-  meshes.box = meshStore.insertMeshData(vku::makeBox());
-  meshes.monkeyFlat = meshStore.insertMeshData(vku::loadOBJ(vku::assetsRootFolder / "models/suzanne.obj"));
-  meshes.monkeySmooth = meshStore.insertMeshData(vku::loadOBJ(vku::assetsRootFolder / "models/suzanne_smooth.obj"));
+  meshes.axes = meshStore.insertMeshData(vku::makeAxes(), true);
+  meshes.box = meshStore.insertMeshData(vku::makeBox(), true);
+  meshes.monkeyFlat = meshStore.insertMeshData(vku::loadOBJCached(vku::assetsRootFolder / "models/suzanne.obj"));
+  meshes.monkeySmooth = meshStore.insertMeshData(vku::loadOBJCached(vku::assetsRootFolder / "models/suzanne_smooth.obj"));
   meshStore.upload(vc);
 
   entities.emplace_back(meshes.box, vku::Transform{{-2, 0, 0}, {0, 0, 1}, std::numbers::pi_v<float> * 0.f, {1, 1, 1}}, glm::vec4{1, 0, 0, 1});
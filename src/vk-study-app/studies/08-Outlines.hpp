@@ -5,6 +5,7 @@
 #include "../vku/Buffer.hpp"
 #include "../vku/Camera.hpp"
 #include "../vku/Math.hpp"
+#include "../vku/MeshFile.hpp"
 #include "../vku/Model.hpp"
 #include "../vku/UniformBuffer.hpp"
 
@@ -12,6 +13,7 @@
 #include <glm/vec4.hpp>
 
 #include <memory>
+#include <span>
 
 namespace vku {
 struct Mesh {
@@ -26,7 +28,10 @@ class MeshStore {
   vku::Buffer indexBuffer;
 
  public:
-  Mesh insertMeshData(const DefaultMeshData& newMesh);
+  // shouldOptimize runs optimizeMesh() on a copy of the mesh before appending it. Meshes from loadOBJCached() are already optimized.
+  Mesh insertMeshData(std::span<const DefaultVertex> vertices, std::span<const uint32_t> indices, bool shouldOptimize = false);
+  inline Mesh insertMeshData(const DefaultMeshData& newMesh, bool shouldOptimize = false) { return insertMeshData(newMesh.vertices, newMesh.indices, shouldOptimize); }
+  inline Mesh insertMeshData(const MappedMesh& newMesh) { return insertMeshData(newMesh.vertices, newMesh.indices); }
   void upload(const vku::VulkanContext& vc);
   inline uint32_t getNumIndices() const {
     return (uint32_t)allMeshesData.indices.size();
@@ -0,0 +1,36 @@
+#include "StudyRegistry.hpp"
+
+#include "01-ClearStudy.hpp"
+#include "02-FirstStudy.hpp"
+#include "02b-SecondStudy.hpp"
+#include "03-Vertices.hpp"
+#include "04-Uniforms.hpp"
+#include "05-Instanced.hpp"
+#include "06-Transforms.hpp"
+#include "07-TransformsCompute.hpp"
+#include "08-Outlines.hpp"
+
+template <typename TStudy>
+static StudyEntry makeEntry(const std::string& id) {
+  return {id, []() -> std::unique_ptr<vku::Study> { return std::make_unique<TStudy>(); }};
+}
+
+const std::vector<StudyEntry>& getRegisteredStudies() {
+  static const std::vector<StudyEntry> studies = {
+      makeEntry<ClearStudy>("01-Clear"),
+      makeEntry<FirstStudy>("02-First"),
+      makeEntry<SecondStudy>("02b-Second"),
+      makeEntry<VerticesStudy>("03-Vertices"),
+      makeEntry<UniformsStudy>("04-Uniforms"),
+      makeEntry<InstancingStudy>("05-Instanced"),
+      makeEntry<TransformConstructionStudy>("06-Transforms"),
+      // draw call recording stress test, a draw call per entity serial vs. on worker threads, vs. automatic instancing
+      {"06-Transforms-10K", []() -> std::unique_ptr<vku::Study> { return std::make_unique<TransformConstructionStudy>(10'000, false, false); }},
+      {"06-Transforms-10K-parallel", []() -> std::unique_ptr<vku::Study> { return std::make_unique<TransformConstructionStudy>(10'000, true, false); }},
+      {"06-Transforms-10K-instanced", []() -> std::unique_ptr<vku::Study> { return std::make_unique<TransformConstructionStudy>(10'000, false, true); }},
+      makeEntry<TransformGPUConstructionStudy>("07-TransformsCompute"),
+      {"07-TransformsCompute-async", []() -> std::unique_ptr<vku::Study> { return std::make_unique<TransformGPUConstructionStudy>(64, true); }},
+      makeEntry<OutlinesViaDepthBuffer>("08-Outlines"),
+  };
+  return studies;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "../StudyApp/Study.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// All Studies of this app with short, unique ids (Study::getName() is more of a description and not unique).
+// Used by tools that need to run every Study, such as the benchmark driver.
+struct StudyEntry {
+  std::string id;
+  std::function<std::unique_ptr<vku::Study>()> make;
+};
+
+const std::vector<StudyEntry>& getRegisteredStudies();
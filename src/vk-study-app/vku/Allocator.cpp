@@ -0,0 +1,224 @@
+#include "Allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+namespace vku {
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+struct MemoryBlock {
+  vk::raii::DeviceMemory memory = nullptr;
+  uint32_t poolIx = 0;
+  vk::DeviceSize size = 0;
+  bool isDedicated = false;
+  void* mappedData = nullptr;
+  // offset -> size of each free range, sorted by offset so that neighbors can be found when merging
+  std::map<vk::DeviceSize, vk::DeviceSize> freeRanges;
+  uint32_t numAllocations = 0;
+  vk::DeviceSize bytesUsed = 0;
+
+  // First-fit. Alignment padding in front of the allocation stays in the free list.
+  std::optional<vk::DeviceSize> allocate(vk::DeviceSize allocSize, vk::DeviceSize alignment) {
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+      const auto [rangeOffset, rangeSize] = *it;
+      const vk::DeviceSize alignedOffset = alignUp(rangeOffset, alignment);
+      if (alignedOffset + allocSize > rangeOffset + rangeSize)
+        continue;
+
+      freeRanges.erase(it);
+      if (alignedOffset > rangeOffset)
+        freeRanges[rangeOffset] = alignedOffset - rangeOffset;
+      if (alignedOffset + allocSize < rangeOffset + rangeSize)
+        freeRanges[alignedOffset + allocSize] = rangeOffset + rangeSize - (alignedOffset + allocSize);
+      ++numAllocations;
+      bytesUsed += allocSize;
+      return alignedOffset;
+    }
+    return {};
+  }
+
+  void free(vk::DeviceSize offset, vk::DeviceSize allocSize) {
+    auto [it, isInserted] = freeRanges.emplace(offset, allocSize);
+    assert(isInserted);  // double free
+    // merge with next range
+    if (auto next = std::next(it); next != freeRanges.end() && it->first + it->second == next->first) {
+      it->second += next->second;
+      freeRanges.erase(next);
+    }
+    // merge with previous range
+    if (it != freeRanges.begin()) {
+      if (auto prev = std::prev(it); prev->first + prev->second == it->first) {
+        prev->second += it->second;
+        freeRanges.erase(it);
+      }
+    }
+    --numAllocations;
+    bytesUsed -= allocSize;
+  }
+};
+
+//---- Allocation
+
+Allocation::~Allocation() {
+  if (allocator)
+    allocator->free(*this);
+}
+
+Allocation::Allocation(Allocation&& other) noexcept
+    : memory(other.memory), offset(other.offset), size(other.size), mappedData(other.mappedData), allocator(other.allocator), block(other.block) {
+  other.allocator = nullptr;
+  other.block = nullptr;
+}
+
+Allocation& Allocation::operator=(Allocation&& other) noexcept {
+  if (this == &other)
+    return *this;
+  if (allocator)
+    allocator->free(*this);
+  memory = other.memory;
+  offset = other.offset;
+  size = other.size;
+  mappedData = other.mappedData;
+  allocator = other.allocator;
+  block = other.block;
+  other.allocator = nullptr;
+  other.block = nullptr;
+  return *this;
+}
+
+//---- Allocator
+
+Allocator::Allocator(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice, vk::DeviceSize preferredBlockSize)
+    : device(device),
+      memoryProperties(physicalDevice.getMemoryProperties()),
+      maxMemoryAllocationCount(physicalDevice.getProperties().limits.maxMemoryAllocationCount),
+      preferredBlockSize(preferredBlockSize) {
+  pools.resize(memoryProperties.memoryTypeCount * 2);
+}
+
+Allocator::~Allocator() {
+  // All resources should have been destroyed before the VulkanContext. Their memory would be freed with the blocks anyway.
+  assert(getStats().numAllocations == 0);
+}
+
+uint32_t Allocator::findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties) const {
+  for (uint32_t ix = 0; ix < memoryProperties.memoryTypeCount; ++ix)
+    if ((typeBits & (1u << ix)) && (memoryProperties.memoryTypes[ix].propertyFlags & properties) == properties)
+      return ix;
+  throw std::runtime_error(std::format("no memory type with properties {} among type bits {:#b}", vk::to_string(properties), typeBits));
+}
+
+MemoryBlock& Allocator::createBlock(std::vector<std::unique_ptr<MemoryBlock>>& pool, uint32_t memoryTypeIndex, vk::DeviceSize size, bool isDedicated) {
+  if (numBlocks >= maxMemoryAllocationCount)
+    throw std::runtime_error(std::format("maxMemoryAllocationCount ({}) reached", maxMemoryAllocationCount));
+
+  auto block = std::make_unique<MemoryBlock>();
+  block->memory = vk::raii::DeviceMemory{device, vk::MemoryAllocateInfo{size, memoryTypeIndex}};
+  block->poolIx = static_cast<uint32_t>(&pool - pools.data());
+  block->size = size;
+  block->isDedicated = isDedicated;
+  block->freeRanges[0] = size;
+  if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+    block->mappedData = block->memory.mapMemory(0, VK_WHOLE_SIZE);
+  ++numBlocks;
+  pool.push_back(std::move(block));
+  return *pool.back();
+}
+
+Allocation Allocator::allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, ResourceKind kind) {
+  const uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+  const vk::DeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+  // don't let a single block take a big chunk of a small heap (e.g. 256MB BAR heap)
+  const vk::DeviceSize blockSize = std::min(preferredBlockSize, heapSize / 8);
+
+  std::scoped_lock lock(mutex);
+  auto& pool = pools[memoryTypeIndex * 2 + static_cast<uint32_t>(kind)];
+
+  MemoryBlock* block = nullptr;
+  std::optional<vk::DeviceSize> offset;
+  if (requirements.size > blockSize / 2) {
+    block = &createBlock(pool, memoryTypeIndex, requirements.size, true);
+    offset = block->allocate(requirements.size, requirements.alignment);
+  } else {
+    for (auto& b : pool) {
+      if (b->isDedicated)
+        continue;
+      offset = b->allocate(requirements.size, requirements.alignment);
+      if (offset.has_value()) {
+        block = b.get();
+        break;
+      }
+    }
+    if (!offset.has_value()) {
+      block = &createBlock(pool, memoryTypeIndex, blockSize, false);
+      offset = block->allocate(requirements.size, requirements.alignment);
+    }
+  }
+  assert(offset.has_value());
+
+  Allocation allocation;
+  allocation.memory = *block->memory;
+  allocation.offset = offset.value();
+  allocation.size = requirements.size;
+  allocation.mappedData = block->mappedData ? static_cast<uint8_t*>(block->mappedData) + offset.value() : nullptr;
+  allocation.allocator = this;
+  allocation.block = block;
+  return allocation;
+}
+
+Allocation Allocator::allocateForBuffer(const vk::raii::Buffer& buffer, vk::MemoryPropertyFlags properties) {
+  Allocation allocation = allocate(buffer.getMemoryRequirements(), properties, ResourceKind::Linear);
+  buffer.bindMemory(allocation.memory, allocation.offset);
+  return allocation;
+}
+
+Allocation Allocator::allocateForImage(const vk::raii::Image& image, vk::MemoryPropertyFlags properties, vk::ImageTiling tiling) {
+  Allocation allocation = allocate(image.getMemoryRequirements(), properties, tiling == vk::ImageTiling::eOptimal ? ResourceKind::Optimal : ResourceKind::Linear);
+  image.bindMemory(allocation.memory, allocation.offset);
+  return allocation;
+}
+
+void Allocator::free(Allocation& allocation) {
+  std::scoped_lock lock(mutex);
+  MemoryBlock* block = allocation.block;
+  block->free(allocation.offset, allocation.size);
+  allocation.allocator = nullptr;
+  allocation.block = nullptr;
+  if (block->numAllocations > 0)
+    return;
+
+  // Release empty blocks, but keep one regular block per pool around so that short-lived allocations (e.g. staging buffers) do not cause a vkAllocateMemory each
+  auto& pool = pools[block->poolIx];
+  const bool hasAnotherEmptyBlock = std::ranges::any_of(pool, [block](const auto& b) { return b.get() != block && !b->isDedicated && b->numAllocations == 0; });
+  if (block->isDedicated || hasAnotherEmptyBlock) {
+    std::erase_if(pool, [block](const auto& b) { return b.get() == block; });
+    --numBlocks;
+  }
+}
+
+AllocatorStats Allocator::getStats() const {
+  std::scoped_lock lock(mutex);
+  AllocatorStats stats{};
+  vk::DeviceSize totalFree = 0;
+  for (const auto& pool : pools) {
+    for (const auto& block : pool) {
+      ++stats.numBlocks;
+      stats.numAllocations += block->numAllocations;
+      stats.bytesReserved += block->size;
+      stats.bytesUsed += block->bytesUsed;
+      for (const auto& [offset, size] : block->freeRanges) {
+        totalFree += size;
+        stats.largestFreeRange = std::max(stats.largestFreeRange, size);
+      }
+    }
+  }
+  stats.fragmentation = totalFree > 0 ? 1.f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(totalFree) : 0.f;
+  return stats;
+}
+}  // namespace vku
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vku {
+class Allocator;
+struct MemoryBlock;
+
+// A sub-range of a large vk::DeviceMemory block owned by the Allocator. Gives its range back when destroyed.
+class Allocation {
+ public:
+  vk::DeviceMemory memory = nullptr;
+  vk::DeviceSize offset = 0;
+  vk::DeviceSize size = 0;
+  // Host-visible blocks are mapped once when created and stay mapped. nullptr for device-only memory
+  void* mappedData = nullptr;
+
+ private:
+  Allocator* allocator = nullptr;
+  MemoryBlock* block = nullptr;
+  friend class Allocator;
+
+ public:
+  Allocation() = default;
+  ~Allocation();
+  Allocation(Allocation&& other) noexcept;
+  Allocation& operator=(Allocation&& other) noexcept;
+  Allocation(const Allocation&) = delete;
+  Allocation& operator=(const Allocation&) = delete;
+
+  explicit operator bool() const { return allocator != nullptr; }
+};
+
+// Buffers and optimally tiled images are kept in separate blocks so that bufferImageGranularity never has to be considered
+enum class ResourceKind {
+  Linear,
+  Optimal,
+};
+
+struct AllocatorStats {
+  uint32_t numBlocks = 0;  // number of vkAllocateMemory calls alive
+  uint32_t numAllocations = 0;
+  vk::DeviceSize bytesReserved = 0;  // sum of block sizes
+  vk::DeviceSize bytesUsed = 0;      // sum of allocation sizes
+  vk::DeviceSize largestFreeRange = 0;
+  // 1 - largestFreeRange / totalFree. 0 when all free memory is contiguous, approaches 1 when it is scattered into small pieces.
+  float fragmentation = 0.f;
+};
+
+// Allocates large vk::DeviceMemory blocks per memory type and hands out aligned sub-ranges of them,
+// instead of one vkAllocateMemory per resource (which is slow and limited by maxMemoryAllocationCount).
+// Each block keeps an offset-sorted free list. Freed ranges are merged with their free neighbors.
+// Requests larger than half a block get a dedicated block. Thread-safe.
+class Allocator {
+ private:
+  const vk::raii::Device& device;
+  const vk::PhysicalDeviceMemoryProperties memoryProperties;
+  const uint32_t maxMemoryAllocationCount;
+  const vk::DeviceSize preferredBlockSize;
+  // indexed by memoryTypeIndex * 2 + ResourceKind
+  std::vector<std::vector<std::unique_ptr<MemoryBlock>>> pools;
+  uint32_t numBlocks = 0;
+  mutable std::mutex mutex;
+
+ public:
+  Allocator(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice, vk::DeviceSize preferredBlockSize = 64 * 1024 * 1024);
+  ~Allocator();
+  Allocator(const Allocator&) = delete;
+  Allocator& operator=(const Allocator&) = delete;
+
+  Allocation allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, ResourceKind kind);
+  // allocate memory that fits the resource and bind it
+  Allocation allocateForBuffer(const vk::raii::Buffer& buffer, vk::MemoryPropertyFlags properties);
+  Allocation allocateForImage(const vk::raii::Image& image, vk::MemoryPropertyFlags properties, vk::ImageTiling tiling);
+
+  AllocatorStats getStats() const;
+
+ private:
+  uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties) const;
+  MemoryBlock& createBlock(std::vector<std::unique_ptr<MemoryBlock>>& pool, uint32_t memoryTypeIndex, vk::DeviceSize size, bool isDedicated);
+  void free(Allocation& allocation);
+  friend class Allocation;
+};
+}  // namespace vku
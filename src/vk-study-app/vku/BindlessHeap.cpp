@@ -0,0 +1,139 @@
+#include "BindlessHeap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <stdexcept>
+
+namespace vku {
+namespace {
+vk::PhysicalDeviceVulkan12Properties getVulkan12Properties(const vk::raii::PhysicalDevice& physicalDevice) {
+  return physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>().get<vk::PhysicalDeviceVulkan12Properties>();
+}
+
+uint32_t getStorageBufferCapacity(const vk::raii::PhysicalDevice& physicalDevice) {
+  const vk::PhysicalDeviceVulkan12Properties props = getVulkan12Properties(physicalDevice);
+  // leave at least half of the per-stage resources to images
+  return std::min({BindlessHeap::kMaxStorageBuffers, props.maxPerStageDescriptorUpdateAfterBindStorageBuffers, props.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                   props.maxPerStageUpdateAfterBindResources / 2});
+}
+
+uint32_t getSampledImageCapacity(const vk::raii::PhysicalDevice& physicalDevice) {
+  const vk::PhysicalDeviceVulkan12Properties props = getVulkan12Properties(physicalDevice);
+  // what's left after storage buffers and the sampler
+  return std::min({BindlessHeap::kMaxSampledImages, props.maxPerStageDescriptorUpdateAfterBindSampledImages, props.maxDescriptorSetUpdateAfterBindSampledImages,
+                   props.maxPerStageUpdateAfterBindResources - getStorageBufferCapacity(physicalDevice) - 1});
+}
+}  // namespace
+
+BindlessHeap::Slots::Slots(uint32_t capacity)
+    : capacity(capacity) {}
+
+uint32_t BindlessHeap::Slots::allocate() {
+  uint32_t ix = 0;
+  if (!freeList.empty()) {
+    ix = freeList.back();
+    freeList.pop_back();
+  } else if (end < capacity) {
+    ix = end++;
+  } else {
+    throw std::runtime_error(std::format("BindlessHeap: all {} slots are in use", capacity));
+  }
+  ++numUsed;
+  return ix;
+}
+
+void BindlessHeap::Slots::free(uint32_t ix, uint64_t frameValue) {
+  pendingFrees.emplace_back(frameValue, ix);
+  --numUsed;
+}
+
+void BindlessHeap::Slots::recycle(uint64_t completedFrameValue) {
+  while (!pendingFrees.empty() && pendingFrees.front().frameValue <= completedFrameValue) {
+    freeList.push_back(pendingFrees.front().ix);
+    pendingFrees.pop_front();
+  }
+}
+
+BindlessHeap::BindlessHeap(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice)
+    : device(device),
+      storageBuffers(getStorageBufferCapacity(physicalDevice)),
+      sampledImages(getSampledImageCapacity(physicalDevice)),
+      linearSampler(device, vk::SamplerCreateInfo{{}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear,
+                                                  vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat,
+                                                  0.f, false, 1.f, false, vk::CompareOp::eAlways, 0.f, VK_LOD_CLAMP_NONE}),
+      descriptorSetLayout([&]() {
+        const std::array<vk::DescriptorSetLayoutBinding, 3> bindings{
+            vk::DescriptorSetLayoutBinding{kStorageBufferBinding, vk::DescriptorType::eStorageBuffer, storageBuffers.getCapacity(), vk::ShaderStageFlagBits::eAll},
+            vk::DescriptorSetLayoutBinding{kSampledImageBinding, vk::DescriptorType::eSampledImage, sampledImages.getCapacity(), vk::ShaderStageFlagBits::eAll},
+            vk::DescriptorSetLayoutBinding{kSamplerBinding, vk::DescriptorType::eSampler, 1, vk::ShaderStageFlagBits::eAll, &*linearSampler},
+        };
+        // Partially bound: slots that are not written (or whose resource is gone) are fine as long as shaders don't access them.
+        // Update after bind + unused while pending: slots can be written while the set is bound in CommandBuffers that are recorded or in flight.
+        const vk::DescriptorBindingFlags arrayFlags = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+        const std::array<vk::DescriptorBindingFlags, 3> bindingFlags{arrayFlags, arrayFlags, {}};
+        const vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo{bindingFlags};
+        return vk::raii::DescriptorSetLayout{device, vk::DescriptorSetLayoutCreateInfo{vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, bindings, &bindingFlagsCreateInfo}};
+      }()),
+      descriptorPool([&]() {
+        const std::array<vk::DescriptorPoolSize, 3> poolSizes{
+            vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, storageBuffers.getCapacity()},
+            vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage, sampledImages.getCapacity()},
+            vk::DescriptorPoolSize{vk::DescriptorType::eSampler, 1},
+        };
+        // eFreeDescriptorSet because raii DescriptorSet frees itself
+        return vk::raii::DescriptorPool{device, vk::DescriptorPoolCreateInfo{vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind | vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, 1, poolSizes}};
+      }()),
+      descriptorSet(std::move(vk::raii::DescriptorSets{device, vk::DescriptorSetAllocateInfo{*descriptorPool, *descriptorSetLayout}}.front())) {}
+
+uint32_t BindlessHeap::addStorageBuffer(const vk::DescriptorBufferInfo& bufferInfo) {
+  std::scoped_lock lock(mutex);
+  const uint32_t ix = storageBuffers.allocate();
+  vk::WriteDescriptorSet writeDescriptorSet;
+  writeDescriptorSet.dstSet = *descriptorSet;
+  writeDescriptorSet.dstBinding = kStorageBufferBinding;
+  writeDescriptorSet.dstArrayElement = ix;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = vk::DescriptorType::eStorageBuffer;
+  writeDescriptorSet.pBufferInfo = &bufferInfo;
+  device.updateDescriptorSets(writeDescriptorSet, nullptr);
+  return ix;
+}
+
+uint32_t BindlessHeap::addSampledImage(vk::ImageView imageView, vk::ImageLayout imageLayout) {
+  std::scoped_lock lock(mutex);
+  const uint32_t ix = sampledImages.allocate();
+  const vk::DescriptorImageInfo imageInfo{nullptr, imageView, imageLayout};
+  vk::WriteDescriptorSet writeDescriptorSet;
+  writeDescriptorSet.dstSet = *descriptorSet;
+  writeDescriptorSet.dstBinding = kSampledImageBinding;
+  writeDescriptorSet.dstArrayElement = ix;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = vk::DescriptorType::eSampledImage;
+  writeDescriptorSet.pImageInfo = &imageInfo;
+  device.updateDescriptorSets(writeDescriptorSet, nullptr);
+  return ix;
+}
+
+void BindlessHeap::removeStorageBuffer(uint32_t ix) {
+  std::scoped_lock lock(mutex);
+  storageBuffers.free(ix, currentFrameValue);
+}
+
+void BindlessHeap::removeSampledImage(uint32_t ix) {
+  std::scoped_lock lock(mutex);
+  sampledImages.free(ix, currentFrameValue);
+}
+
+void BindlessHeap::beginFrame(uint64_t frameValue, uint64_t completedFrameValue) {
+  std::scoped_lock lock(mutex);
+  currentFrameValue = frameValue;
+  storageBuffers.recycle(completedFrameValue);
+  sampledImages.recycle(completedFrameValue);
+}
+
+BindlessHeapStats BindlessHeap::getStats() const {
+  std::scoped_lock lock(mutex);
+  return {storageBuffers.getNumUsed(), storageBuffers.getCapacity(), sampledImages.getNumUsed(), sampledImages.getCapacity()};
+}
+}  // namespace vku
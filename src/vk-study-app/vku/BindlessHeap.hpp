@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace vku {
+struct BindlessHeapStats {
+  uint32_t numStorageBuffers = 0;
+  uint32_t storageBufferCapacity = 0;
+  uint32_t numSampledImages = 0;
+  uint32_t sampledImageCapacity = 0;
+};
+
+// A single global descriptor set with large arrays of storage buffers and sampled images (descriptor indexing, core in 1.2).
+// Resources are added once and referred to by their array index, which shaders get via push constants:
+//
+//   layout (set = 0, binding = 0) readonly buffer PerPass { ... } perPassBuffers[];
+//   layout (push_constant) uniform Indices { uint perPass; } indices;
+//   ... perPassBuffers[indices.perPass] ...
+//
+// Hence a study binds the heap once per frame instead of a descriptor set per frame, pass and material, and adding resources never exhausts a pool.
+// Arrays are sized to the device's update-after-bind limits (up to kMaxStorageBuffers / kMaxSampledImages) up front. Descriptors are partially bound,
+// so unused slots cost nothing but descriptor memory, and slots can be written while frames using other slots are in flight.
+// Slots are handed out from a free list, falling back to growing the used range. A removed slot is recycled only after the frame that removed it has finished on the GPU.
+// Thread-safe.
+class BindlessHeap {
+ public:
+  static constexpr uint32_t kStorageBufferBinding = 0;
+  static constexpr uint32_t kSampledImageBinding = 1;
+  // a single immutable linear sampler, for sampler2D(images[i], linearSampler)
+  static constexpr uint32_t kSamplerBinding = 2;
+  static constexpr uint32_t kMaxStorageBuffers = 16384;
+  static constexpr uint32_t kMaxSampledImages = 4096;
+
+ private:
+  // Slot indices of one array
+  class Slots {
+   private:
+    struct PendingFree {
+      uint64_t frameValue;
+      uint32_t ix;
+    };
+    uint32_t capacity = 0;
+    // slots [0, end) have been handed out at least once
+    uint32_t end = 0;
+    uint32_t numUsed = 0;
+    std::vector<uint32_t> freeList;
+    std::deque<PendingFree> pendingFrees;
+
+   public:
+    explicit Slots(uint32_t capacity);
+    // throws std::runtime_error when the array is full
+    uint32_t allocate();
+    void free(uint32_t ix, uint64_t frameValue);
+    void recycle(uint64_t completedFrameValue);
+    uint32_t getCapacity() const { return capacity; }
+    uint32_t getNumUsed() const { return numUsed; }
+  };
+
+  const vk::raii::Device& device;
+  // declared before the descriptor set layout, which is sized by their capacities
+  Slots storageBuffers;
+  Slots sampledImages;
+  vk::raii::Sampler linearSampler;
+  vk::raii::DescriptorSetLayout descriptorSetLayout;
+  vk::raii::DescriptorPool descriptorPool;
+  vk::raii::DescriptorSet descriptorSet;
+  uint64_t currentFrameValue = 1;
+  mutable std::mutex mutex;
+
+ public:
+  BindlessHeap(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice);
+  BindlessHeap(const BindlessHeap&) = delete;
+  BindlessHeap& operator=(const BindlessHeap&) = delete;
+
+  // Returns the index of the buffer in the storage buffer array. Buffer has to have eStorageBuffer usage.
+  uint32_t addStorageBuffer(const vk::DescriptorBufferInfo& bufferInfo);
+  // Image view has to be in imageLayout whenever a shader samples it
+  uint32_t addSampledImage(vk::ImageView imageView, vk::ImageLayout imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+  // Frames already recorded may still read the slot, so it is reused only after the current frame has finished
+  void removeStorageBuffer(uint32_t ix);
+  void removeSampledImage(uint32_t ix);
+
+  // Recycles slots removed by finished frames. VulkanContext::drawFrameBegin calls it.
+  void beginFrame(uint64_t currentFrameValue, uint64_t completedFrameValue);
+
+  const vk::raii::DescriptorSetLayout& getDescriptorSetLayout() const { return descriptorSetLayout; }
+  vk::DescriptorSet getDescriptorSet() const { return *descriptorSet; }
+  BindlessHeapStats getStats() const;
+};
+}  // namespace vku
@@ -3,7 +3,7 @@
 #include "VulkanContext.hpp"
 
 namespace vku {
-Buffer::Buffer(const VulkanContext& vc, void* srcData, uint32_t sizeBytes, vk::BufferUsageFlags usage) {
+Buffer::Buffer(const VulkanContext& vc, const void* srcData, uint32_t sizeBytes, vk::BufferUsageFlags usage) {
   //---- Vertex Data Upload via Staging buffers
   // Static data like vertex and index buffer should be stored on the device memory
   // for optimal (and fastest) access by the GPU
@@ -15,42 +15,22 @@ Buffer::Buffer(const VulkanContext& vc, void* srcData, uint32_t sizeBytes, vk::B
   // - Copy the data from the host to the device using a command buffer
   // - Delete the host visible (staging) buffer
   // - Use the device local buffers for rendering
-
-  vk::MemoryAllocateInfo memAlloc;
-  vk::MemoryRequirements memReqs;
-
-  // Create a host-visible (CPU) staging buffer & memory to copy the vertex/index data
-  vk::raii::Buffer stagingBuffer = vk::raii::Buffer(vc.device, vk::BufferCreateInfo({}, sizeBytes, vk::BufferUsageFlagBits::eTransferSrc));
-  memReqs = stagingBuffer.getMemoryRequirements();
-  memAlloc.allocationSize = memReqs.size;
-  memAlloc.memoryTypeIndex = vc.getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eHostVisible);
-  vk::raii::DeviceMemory stagingMmory = vk::raii::DeviceMemory{vc.device, vk::MemoryAllocateInfo(memReqs.size, memAlloc.memoryTypeIndex)};
-
-  const vk::Device& dev = *vc.device;
-  // Map and copy
-  void* dstData = dev.mapMemory(*stagingMmory, 0, memAlloc.allocationSize, vk::MemoryMapFlags());
-  memcpy(dstData, srcData, sizeBytes);
-  dev.unmapMemory(*stagingMmory);
-  dev.bindBufferMemory(*stagingBuffer, *stagingMmory, 0);
+  //
+  // UploadQueue does the staging part. It copies srcData into its staging ring right away and records the copy command.
+  // The copy is submitted together with other uploads at the end of the frame. Frame submission waits for them on the GPU, hence no stall here.
 
   // Create the destination buffer with device only visibility (overwrite member variable)
-  buffer = vk::raii::Buffer(vc.device, vk::BufferCreateInfo({}, sizeBytes, usage | vk::BufferUsageFlagBits::eTransferDst));
-  memReqs = buffer.getMemoryRequirements();
-  memAlloc.allocationSize = memReqs.size;
-  memAlloc.memoryTypeIndex = vc.getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-  memory = vk::raii::DeviceMemory{vc.device, vk::MemoryAllocateInfo(memReqs.size, memAlloc.memoryTypeIndex)};
-  dev.bindBufferMemory(*buffer, *memory, 0);
+  vk::BufferCreateInfo bufferCreateInfo({}, sizeBytes, usage | vk::BufferUsageFlagBits::eTransferDst);
+  vc.uploadQueue.setSharingMode(bufferCreateInfo);
+  buffer = vk::raii::Buffer(vc.device, bufferCreateInfo);
+  allocation = vc.allocator.allocateForBuffer(buffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-  const vk::raii::CommandBuffer& copyCmdBuf = vc.copyCommandBuffer;
-  copyCmdBuf.reset();
-  copyCmdBuf.begin(vk::CommandBufferBeginInfo());
-  vk::BufferCopy copyRegion;
-  copyRegion.setSize(sizeBytes);
-  copyCmdBuf.copyBuffer(*stagingBuffer, *buffer, copyRegion);
-  copyCmdBuf.end();
+  vc.uploadQueue.enqueue(buffer, srcData, sizeBytes);
+}
 
-  vk::SubmitInfo copySubmitInfo(nullptr, nullptr, *copyCmdBuf, nullptr);
-  vc.graphicsQueue.submit(copySubmitInfo, {});
-  vc.graphicsQueue.waitIdle();
+Buffer::Buffer(const VulkanContext& vc, uint32_t sizeBytes, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperties) {
+  // nothing is uploaded, hence it is only accessed by the queue family that uses it
+  buffer = vk::raii::Buffer(vc.device, vk::BufferCreateInfo({}, sizeBytes, usage));
+  allocation = vc.allocator.allocateForBuffer(buffer, memoryProperties);
 }
-}  // namespace vku
\ No newline at end of file
+}  // namespace vku
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Allocator.hpp"
+
 #include <vulkan/vulkan_raii.hpp>
 
 namespace vku {
@@ -7,10 +9,14 @@ class VulkanContext;
 
 // A GPU Buffer for vertex data
 struct Buffer {
+  // declared before buffer so that buffer is destroyed before its memory range is given back
+  Allocation allocation;
   vk::raii::Buffer buffer = nullptr;
-  vk::raii::DeviceMemory memory = nullptr;
 
   Buffer() = default;
-  Buffer(const VulkanContext& vc, void* srcData, uint32_t sizeBytes, vk::BufferUsageFlags usage);
+  Buffer(const VulkanContext& vc, const void* srcData, uint32_t sizeBytes, vk::BufferUsageFlags usage);
+  // Without initial data, for buffers that are written by the GPU (e.g. compute outputs, indirect commands).
+  // With eHostVisible memory properties allocation.mappedData can be used to read results back on the CPU.
+  Buffer(const VulkanContext& vc, uint32_t sizeBytes, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal);
 };
 }  // namespace vku
\ No newline at end of file
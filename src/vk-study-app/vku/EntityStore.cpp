@@ -0,0 +1,166 @@
+#include "EntityStore.hpp"
+
+#include "VulkanContext.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace vku {
+void EntityStore::DirtyBits::resize(size_t numBits) {
+  words.resize((numBits + 63) / 64, 0);
+}
+
+void EntityStore::DirtyBits::set(size_t ix) {
+  words[ix / 64] |= uint64_t{1} << (ix % 64);
+  isAnySet = true;
+}
+
+void EntityStore::DirtyBits::setAll() {
+  // bits beyond the last entity are never visited, see forEachRange
+  std::ranges::fill(words, ~uint64_t{0});
+  isAnySet = !words.empty();
+}
+
+void EntityStore::DirtyBits::merge(const DirtyBits& other) {
+  if (!other.isAnySet)
+    return;
+  for (size_t i = 0; i < words.size(); ++i)
+    words[i] |= other.words[i];
+  isAnySet = true;
+}
+
+void EntityStore::DirtyBits::clear() {
+  if (!isAnySet)
+    return;
+  std::ranges::fill(words, 0);
+  isAnySet = false;
+}
+
+template <typename TFunc>
+void EntityStore::DirtyBits::forEachRange(size_t numBits, TFunc&& func) const {
+  if (!isAnySet)
+    return;
+  size_t ix = 0;
+  while (ix < numBits) {
+    // skip clean words at once
+    const uint64_t fromIx = words[ix / 64] >> (ix % 64);
+    if (fromIx == 0) {
+      ix = (ix / 64 + 1) * 64;
+      continue;
+    }
+    const size_t beginIx = ix + std::countr_zero(fromIx);
+    // extend the range over following set bits, possibly across words
+    size_t endIx = beginIx;
+    while (endIx < numBits) {
+      const uint64_t fromEnd = ~words[endIx / 64] >> (endIx % 64);
+      const size_t numOnes = fromEnd == 0 ? 64 - endIx % 64 : std::countr_zero(fromEnd);
+      endIx += numOnes;
+      if (fromEnd != 0)
+        break;
+    }
+    endIx = std::min(endIx, numBits);
+    if (beginIx < numBits)
+      func(beginIx, endIx);
+    ix = endIx;
+  }
+}
+
+uint32_t EntityStore::add(const Transform& transform, uint32_t meshId, const glm::vec4& color) {
+  assert(slotBuffers.empty());  // buffers are sized at createBuffers()
+  const uint32_t ix = static_cast<uint32_t>(size());
+  transforms.resize(ix + 1);
+  transforms.set(ix, transform);
+  meshIds.push_back(meshId);
+  colors.push_back(color);
+  matrices.emplace_back();
+  changed.resize(size());
+  changed.set(ix);
+  return ix;
+}
+
+void EntityStore::createBuffers(const VulkanContext& vc) {
+  assert(!meshIds.empty());
+  const uint32_t sizeBytes = static_cast<uint32_t>(size() * sizeof(GPUEntity));
+  slotBuffers.clear();
+  staleInSlot.clear();
+  for (uint32_t i = 0; i < vc.MAX_FRAMES_IN_FLIGHT; ++i) {
+    // host-visible, so that a few changed entities are a memcpy instead of a staging copy + barriers
+    slotBuffers.emplace_back(vc, sizeBytes, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    staleInSlot.emplace_back().resize(size());
+    staleInSlot.back().setAll();
+  }
+}
+
+void EntityStore::markChanged(uint32_t ix) {
+  changed.set(ix);
+}
+
+void EntityStore::setTransform(uint32_t ix, const Transform& transform) {
+  setPosition(ix, transform.position);
+  setRotation(ix, transform.rotation);
+  setScale(ix, transform.scale);
+}
+
+void EntityStore::setPosition(uint32_t ix, const glm::vec3& position) {
+  if (getPosition(ix) == position)
+    return;
+  transforms.px[ix] = position.x, transforms.py[ix] = position.y, transforms.pz[ix] = position.z;
+  markChanged(ix);
+}
+
+void EntityStore::setRotation(uint32_t ix, const glm::quat& rotation) {
+  if (getRotation(ix) == rotation)
+    return;
+  transforms.qx[ix] = rotation.x, transforms.qy[ix] = rotation.y, transforms.qz[ix] = rotation.z, transforms.qw[ix] = rotation.w;
+  markChanged(ix);
+}
+
+void EntityStore::setScale(uint32_t ix, const glm::vec3& scale) {
+  if (glm::vec3{transforms.sx[ix], transforms.sy[ix], transforms.sz[ix]} == scale)
+    return;
+  transforms.sx[ix] = scale.x, transforms.sy[ix] = scale.y, transforms.sz[ix] = scale.z;
+  markChanged(ix);
+}
+
+void EntityStore::setColor(uint32_t ix, const glm::vec4& color) {
+  if (colors[ix] == color)
+    return;
+  colors[ix] = color;
+  // matrices are rebuilt too, which is cheaper than tracking color changes separately
+  markChanged(ix);
+}
+
+EntityStore::UpdateStats EntityStore::update(uint32_t frameSlot) {
+  assert(frameSlot < slotBuffers.size());
+  UpdateStats stats;
+  if (changed.any()) {
+    changed.forEachRange(size(), [&](size_t beginIx, size_t endIx) {
+      buildTransforms(transforms, matrices, beginIx, endIx);
+      stats.numRebuilt += static_cast<uint32_t>(endIx - beginIx);
+    });
+    // every slot's copy of them is stale now
+    for (DirtyBits& stale : staleInSlot)
+      stale.merge(changed);
+    changed.clear();
+  }
+
+  DirtyBits& stale = staleInSlot[frameSlot];
+  GPUEntity* dst = static_cast<GPUEntity*>(slotBuffers[frameSlot].allocation.mappedData);
+  stale.forEachRange(size(), [&](size_t beginIx, size_t endIx) {
+    // write sequentially, mapped memory can be write-combined
+    for (size_t ix = beginIx; ix < endIx; ++ix)
+      dst[ix] = GPUEntity{matrices[ix].worldFromObject, matrices[ix].dualWorldFromObject, colors[ix]};
+    stats.numUploaded += static_cast<uint32_t>(endIx - beginIx);
+    ++stats.numRanges;
+  });
+  stale.clear();
+
+  lastStats = stats;
+  return stats;
+}
+
+vk::DescriptorBufferInfo EntityStore::getDescriptorBufferInfo(uint32_t frameSlot) const {
+  return {*slotBuffers[frameSlot].buffer, 0, size() * sizeof(GPUEntity)};
+}
+}  // namespace vku
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Math.hpp"
+
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace vku {
+class VulkanContext;
+
+// Entities as a structure of arrays: positions, rotations, scales (TransformsSoA), mesh ids and colors each in their own contiguous array.
+// Setters mark entities dirty. update() recomputes world matrices of dirty entities only (vku::buildTransforms over dirty ranges),
+// and copies only the entities whose copy is stale into the frame slot's storage buffer. A scene where nothing moved costs a scan of the dirty bits.
+//
+// There is one host-visible storage buffer per frame-in-flight slot, so an update never writes into a buffer a frame in flight is reading.
+// Hence a change has to be copied once into each slot, which is tracked with a set of dirty bits per slot.
+class EntityStore {
+ public:
+  // std430 layout of an element of the storage buffer
+  struct GPUEntity {
+    glm::mat4 worldFromObject;
+    glm::mat4 dualWorldFromObject;
+    glm::vec4 color;
+  };
+
+  struct UpdateStats {
+    // number of entities whose matrices were recomputed
+    uint32_t numRebuilt = 0;
+    // number of entities copied into the frame slot's buffer
+    uint32_t numUploaded = 0;
+    // number of contiguous dirty ranges copied
+    uint32_t numRanges = 0;
+  };
+
+ private:
+  // One bit per entity, 64 entities per word. Ranges of consecutive set bits are visited in index order.
+  class DirtyBits {
+   private:
+    std::vector<uint64_t> words;
+    bool isAnySet = false;
+
+   public:
+    void resize(size_t numBits);
+    void set(size_t ix);
+    void setAll();
+    void merge(const DirtyBits& other);
+    void clear();
+    bool any() const { return isAnySet; }
+    // calls func(beginIx, endIx) for each range of consecutive set bits
+    template <typename TFunc>
+    void forEachRange(size_t numBits, TFunc&& func) const;
+  };
+
+  TransformsSoA transforms;
+  std::vector<uint32_t> meshIds;
+  std::vector<glm::vec4> colors;
+  // CPU copy of world matrices, valid for entities that are not dirty
+  std::vector<TransformMatrices> matrices;
+  // entities changed since last update()
+  DirtyBits changed;
+  // per frame slot, entities whose copy in that slot's buffer is stale
+  std::vector<DirtyBits> staleInSlot;
+  std::vector<Buffer> slotBuffers;
+  UpdateStats lastStats;
+
+  void markChanged(uint32_t ix);
+
+ public:
+  EntityStore() = default;
+  EntityStore(const EntityStore&) = delete;
+  EntityStore& operator=(const EntityStore&) = delete;
+  EntityStore(EntityStore&&) = default;
+  EntityStore& operator=(EntityStore&&) = default;
+
+  // Returns the index of the new entity. Entities cannot be added after createBuffers()
+  uint32_t add(const Transform& transform, uint32_t meshId, const glm::vec4& color);
+  // Creates one storage buffer per frame-in-flight slot (vc.MAX_FRAMES_IN_FLIGHT), large enough for the entities added so far
+  void createBuffers(const VulkanContext& vc);
+
+  size_t size() const { return meshIds.size(); }
+  Transform getTransform(uint32_t ix) const { return transforms.get(ix); }
+  glm::vec3 getPosition(uint32_t ix) const { return {transforms.px[ix], transforms.py[ix], transforms.pz[ix]}; }
+  glm::quat getRotation(uint32_t ix) const { return glm::quat{transforms.qw[ix], transforms.qx[ix], transforms.qy[ix], transforms.qz[ix]}; }
+  uint32_t getMeshId(uint32_t ix) const { return meshIds[ix]; }
+  const glm::vec4& getColor(uint32_t ix) const { return colors[ix]; }
+  // Matrices as of the last update()
+  const TransformMatrices& getMatrices(uint32_t ix) const { return matrices[ix]; }
+  std::span<const uint32_t> getMeshIds() const { return meshIds; }
+
+  // Setters mark the entity dirty only if the value actually changes, so that writing the same value every frame stays free
+  void setTransform(uint32_t ix, const Transform& transform);
+  void setPosition(uint32_t ix, const glm::vec3& position);
+  void setRotation(uint32_t ix, const glm::quat& rotation);
+  void setScale(uint32_t ix, const glm::vec3& scale);
+  void setColor(uint32_t ix, const glm::vec4& color);
+
+  // Rebuilds matrices of entities changed since the last call, then copies the entities that are stale in frameSlot's buffer into it.
+  // Call once per frame in Study::onUpdate: the frame that used frameSlot last has finished by then, hence its buffer can be written.
+  UpdateStats update(uint32_t frameSlot);
+  const UpdateStats& getLastStats() const { return lastStats; }
+
+  // Storage buffer of GPUEntity array, index of an entity is its index in the store
+  const Buffer& getBuffer(uint32_t frameSlot) const { return slotBuffers[frameSlot]; }
+  vk::DescriptorBufferInfo getDescriptorBufferInfo(uint32_t frameSlot) const;
+};
+}  // namespace vku
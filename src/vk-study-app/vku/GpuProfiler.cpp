@@ -0,0 +1,114 @@
+#include "GpuProfiler.hpp"
+
+#include <cassert>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+namespace vku {
+GpuProfiler::Scope::Scope(GpuProfiler& profiler, const vk::raii::CommandBuffer& cmdBuf, std::string_view name)
+    : profiler(profiler), cmdBuf(cmdBuf), entryIx(profiler.beginScope(cmdBuf, name)) {}
+
+GpuProfiler::Scope::~Scope() {
+  if (entryIx.has_value())
+    profiler.endScope(cmdBuf, entryIx.value());
+}
+
+GpuProfiler::GpuProfiler(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex, uint32_t numFramesInFlight, uint32_t maxScopesPerFrame)
+    : maxQueriesPerFrame(2 * maxScopesPerFrame) {
+  frames.resize(numFramesInFlight);
+
+  const uint32_t timestampValidBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+  if (timestampValidBits == 0)
+    return;
+  timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+  timestampMask = timestampValidBits >= 64 ? ~uint64_t{0} : (uint64_t{1} << timestampValidBits) - 1;
+  for (auto& frame : frames)
+    frame.queryPool = vk::raii::QueryPool{device, vk::QueryPoolCreateInfo{{}, vk::QueryType::eTimestamp, maxQueriesPerFrame}};
+}
+
+void GpuProfiler::beginFrame(const vk::raii::CommandBuffer& cmdBuf, uint32_t frameNo) {
+  assert(!isFrameOpen);
+  currentFrame = frameNo;
+  FrameQueries& frame = frames[currentFrame];
+
+  hasFreshResults = false;
+  if (frame.hasPendingResults)
+    collectResults(frame);
+  frame.entries.clear();
+  frame.numQueriesUsed = 0;
+
+  if (!isSupported())
+    return;
+  // Queries have to be reset before being written again. vkCmdResetQueryPool must be outside of a RenderPass
+  cmdBuf.resetQueryPool(*frame.queryPool, 0, maxQueriesPerFrame);
+  isFrameOpen = true;
+  currentDepth = 0;
+  beginScope(cmdBuf, "frame");
+}
+
+void GpuProfiler::endFrame(const vk::raii::CommandBuffer& cmdBuf) {
+  if (!isFrameOpen)
+    return;
+  // Scope objects that are still alive at this point are programming errors, their end timestamps would be written into the next frame.
+  assert(currentDepth == 1);
+  endScope(cmdBuf, 0);
+  isFrameOpen = false;
+  frames[currentFrame].hasPendingResults = true;
+}
+
+std::optional<uint32_t> GpuProfiler::beginScope(const vk::raii::CommandBuffer& cmdBuf, std::string_view name) {
+  FrameQueries& frame = frames[currentFrame];
+  if (!isFrameOpen || frame.numQueriesUsed + 2 > maxQueriesPerFrame)
+    return {};
+
+  const uint32_t beginQuery = frame.numQueriesUsed;
+  frame.numQueriesUsed += 2;
+  cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *frame.queryPool, beginQuery);
+  frame.entries.push_back(Entry{std::string{name}, currentDepth, beginQuery, beginQuery + 1});
+  ++currentDepth;
+  return static_cast<uint32_t>(frame.entries.size() - 1);
+}
+
+void GpuProfiler::endScope(const vk::raii::CommandBuffer& cmdBuf, uint32_t entryIx) {
+  FrameQueries& frame = frames[currentFrame];
+  assert(isFrameOpen && entryIx < frame.entries.size());
+  cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *frame.queryPool, frame.entries[entryIx].endQuery);
+  --currentDepth;
+}
+
+void GpuProfiler::collectResults(FrameQueries& frame) {
+  frame.hasPendingResults = false;
+  if (frame.numQueriesUsed == 0)
+    return;
+
+  // No eWait flag. Caller guarantees that the frame's CommandBuffer has completed execution.
+  const auto [result, timestamps] = frame.queryPool.getResults<uint64_t>(0, frame.numQueriesUsed, frame.numQueriesUsed * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+  if (result != vk::Result::eSuccess)
+    return;
+
+  latestResults.clear();
+  std::vector<std::string> pathStack;
+  for (const Entry& e : frame.entries) {
+    pathStack.resize(e.depth);
+    const std::string path = pathStack.empty() ? e.name : pathStack.back() + "/" + e.name;
+    pathStack.push_back(path);
+
+    const float durationMs = static_cast<float>(((timestamps[e.endQuery] - timestamps[e.beginQuery]) & timestampMask) * timestampPeriod * 1e-6);
+    const auto [it, isNew] = averagesByPath.try_emplace(path, durationMs);
+    if (!isNew)
+      it->second = it->second * 0.95f + durationMs * 0.05f;
+    latestResults.push_back(ScopeTiming{e.name, path, e.depth, durationMs, it->second});
+  }
+  hasFreshResults = true;
+}
+
+void GpuProfiler::writeCSV(const std::filesystem::path& path) const {
+  std::ofstream out(path);
+  if (!out)
+    throw std::runtime_error(std::format("cannot open {} for writing", path.string()));
+  out << "path,depth,ms,avg_ms\n";
+  for (const auto& r : latestResults)
+    out << std::format("\"{}\",{},{:.4f},{:.4f}\n", r.path, r.depth, r.durationMs, r.averageMs);
+}
+}  // namespace vku
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace vku {
+// Measures GPU durations of named, nestable scopes of a frame's CommandBuffer via timestamp queries.
+// Each frame-in-flight has its own QueryPool. Results of a frame are read back when the same frame-in-flight slot comes around again,
+// i.e. after VulkanContext waited for that frame's value on its frame timeline semaphore, so reading never stalls. Results are MAX_FRAMES_IN_FLIGHT frames late.
+class GpuProfiler {
+ public:
+  struct ScopeTiming {
+    std::string name;
+    // names of ancestors and this scope joined with '/', e.g. "frame/<study name>/monkey compute"
+    std::string path;
+    uint32_t depth;
+    float durationMs;
+    // exponential moving average of durationMs, easier to read in the UI than the jittery latest value
+    float averageMs;
+  };
+
+  // Writes a timestamp when constructed and another one when destroyed. No-op if timestamps are not supported or queries ran out.
+  class Scope {
+   public:
+    Scope(GpuProfiler& profiler, const vk::raii::CommandBuffer& cmdBuf, std::string_view name);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    GpuProfiler& profiler;
+    const vk::raii::CommandBuffer& cmdBuf;
+    std::optional<uint32_t> entryIx;
+  };
+
+ private:
+  struct Entry {
+    std::string name;
+    uint32_t depth;
+    uint32_t beginQuery;
+    uint32_t endQuery;
+  };
+  struct FrameQueries {
+    vk::raii::QueryPool queryPool = nullptr;
+    std::vector<Entry> entries;
+    uint32_t numQueriesUsed = 0;
+    // true after the frame's CommandBuffer has been recorded, and its results have not been collected yet
+    bool hasPendingResults = false;
+  };
+
+  const uint32_t maxQueriesPerFrame;
+  // nanoseconds per timestamp tick. 0 if the queue family does not support timestamps
+  float timestampPeriod = 0.f;
+  uint64_t timestampMask = 0;
+  std::vector<FrameQueries> frames;
+  uint32_t currentFrame = 0;
+  bool isFrameOpen = false;
+  uint32_t currentDepth = 0;
+  std::vector<ScopeTiming> latestResults;
+  bool hasFreshResults = false;
+  std::unordered_map<std::string, float> averagesByPath;
+
+ public:
+  GpuProfiler(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex, uint32_t numFramesInFlight, uint32_t maxScopesPerFrame = 128);
+
+  bool isSupported() const { return timestampPeriod > 0.f; }
+
+  // To be called by VulkanContext after waiting for the slot's previous frame and beginning its CommandBuffer (outside of any RenderPass).
+  // Collects results of the previous use of this frame-in-flight slot, resets its queries and opens the root "frame" scope.
+  void beginFrame(const vk::raii::CommandBuffer& cmdBuf, uint32_t frameNo);
+  // Closes the root scope. To be called before ending the CommandBuffer.
+  void endFrame(const vk::raii::CommandBuffer& cmdBuf);
+
+  // auto s = profiler.scope(cmdBuf, "monkey compute");
+  [[nodiscard]] Scope scope(const vk::raii::CommandBuffer& cmdBuf, std::string_view name) { return Scope{*this, cmdBuf, name}; }
+
+  // Scopes of the most recently completed frame in recording order (depth-first), root "frame" scope first.
+  const std::vector<ScopeTiming>& getLatestResults() const { return latestResults; }
+  // Whether the latest beginFrame() collected a new set of results
+  bool hasNewResults() const { return hasFreshResults; }
+  // One row per scope of the latest results: path,depth,ms,avg_ms
+  void writeCSV(const std::filesystem::path& path) const;
+
+ private:
+  std::optional<uint32_t> beginScope(const vk::raii::CommandBuffer& cmdBuf, std::string_view name);
+  void endScope(const vk::raii::CommandBuffer& cmdBuf, uint32_t entryIx);
+  void collectResults(FrameQueries& frame);
+};
+}  // namespace vku
@@ -40,7 +40,9 @@ ImGuiHelper::ImGuiHelper(const VulkanContext& vc, const Window& win)
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
   // ImNodes::CreateContext();
-  ImGui_ImplGlfw_InitForVulkan(win.getGLFWWindow(), true);
+  // There is no platform window in headless mode. Display size and delta time are fed manually in Begin() instead.
+  if (!vc.appSettings.isHeadless)
+    ImGui_ImplGlfw_InitForVulkan(win.getGLFWWindow(), true);
 
   ImGui_ImplVulkan_InitInfo init_info = {};
   init_info.Instance = *vc.instance;
@@ -48,10 +50,11 @@ ImGuiHelper::ImGuiHelper(const VulkanContext& vc, const Window& win)
   init_info.Device = *vc.device;
   // init_info.QueueFamily = device.get_queue_index(vkb::QueueType::graphics).value();
   init_info.Queue = *vc.graphicsQueue;
-  // init_info.PipelineCache = g_PipelineCache;
+  init_info.PipelineCache = *vc.pipelineCache;
   init_info.DescriptorPool = imguiPool;
-  init_info.MinImageCount = static_cast<uint32_t>(vc.NUM_IMAGES);
-  init_info.ImageCount = static_cast<uint32_t>(vc.NUM_IMAGES);
+  // ImGui cycles its vertex/index buffers over ImageCount frames, so it has to cover frames in flight. Independent of the swapchain, hence no need to update it on recreation.
+  init_info.MinImageCount = 2;
+  init_info.ImageCount = static_cast<uint32_t>(vc.MAX_FRAMES_IN_FLIGHT);
   init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
   // init_info.CheckVkResultFn = check_vk_result;
   ImGui_ImplVulkan_Init(&init_info, *vc.renderPass);
@@ -84,14 +87,20 @@ ImGuiHelper::ImGuiHelper(const VulkanContext& vc, const Window& win)
 ImGuiHelper::~ImGuiHelper() {
   vkDestroyDescriptorPool(*vc.device, imguiPool, nullptr);
   ImGui_ImplVulkan_Shutdown();
-  ImGui_ImplGlfw_Shutdown();
+  if (!vc.appSettings.isHeadless)
+    ImGui_ImplGlfw_Shutdown();
   // ImNodes::DestroyContext();
   ImGui::DestroyContext();
 }
 
 void ImGuiHelper::Begin() const {
   ImGui_ImplVulkan_NewFrame();
-  ImGui_ImplGlfw_NewFrame();
+  if (vc.appSettings.isHeadless) {
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2{static_cast<float>(vc.swapchainExtent.width), static_cast<float>(vc.swapchainExtent.height)};
+    io.DeltaTime = 1.0f / 60.0f;
+  } else
+    ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
 }
 
@@ -8,21 +8,12 @@ Image::Image(const VulkanContext& vc, vk::Format format, vk::Extent2D extent, vk
       image([&]() {
         vk::ImageCreateInfo imageCreateInfo({}, vk::ImageType::e2D, format, vk::Extent3D(extent, 1), 1, 1, samples, tiling, usage);
         return vk::raii::Image{vc.device, imageCreateInfo};
-      }()),
-      memory([&]() {
-        vk::MemoryRequirements memoryRequirements = image.getMemoryRequirements();
-        const uint32_t typeBits = memoryRequirements.memoryTypeBits;
-        uint32_t typeIndex = vc.getMemoryType(typeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-        assert(typeIndex != uint32_t(~0));
-        vk::MemoryAllocateInfo memoryAllocateInfo(memoryRequirements.size, typeIndex);
-        return vk::raii::DeviceMemory{vc.device, memoryAllocateInfo};
-      }()),
-      imageView([&]() {
-        image.bindMemory(*memory, 0);
-        vk::ImageSubresourceRange imageSubresourceRange{aspect, 0, 1, 0, 1};
-        vk::ImageViewCreateInfo imageViewCreateInfo({}, *image, vk::ImageViewType::e2D, format, {}, imageSubresourceRange);
-        return vk::raii::ImageView(vc.device, imageViewCreateInfo);
       }()) {
+  // allocation is declared before image, hence bound here. View needs the memory bound
+  allocation = vc.allocator.allocateForImage(image, vk::MemoryPropertyFlagBits::eDeviceLocal, tiling);
+  vk::ImageSubresourceRange imageSubresourceRange{aspect, 0, 1, 0, 1};
+  vk::ImageViewCreateInfo imageViewCreateInfo({}, *image, vk::ImageViewType::e2D, format, {}, imageSubresourceRange);
+  imageView = vk::raii::ImageView(vc.device, imageViewCreateInfo);
 }
 
 // taken from https://github.com/KhronosGroup/Vulkan-Hpp/blob/fc63beb5962128c263647375b46693da271e7ceb/RAII_Samples/utils/utils.hpp#L103
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Allocator.hpp"
+
 #include <vulkan/vulkan_raii.hpp>
 
 namespace vku {
@@ -7,8 +9,9 @@ class VulkanContext;
 
 struct Image {
   vk::Format format = vk::Format::eUndefined;
+  // declared before image so that image is destroyed before its memory range is given back
+  Allocation allocation;
   vk::raii::Image image = nullptr;
-  vk::raii::DeviceMemory memory = nullptr;
   vk::raii::ImageView imageView = nullptr;
 
   // TODO: not sure about needing vc here. Maybe VC can be a friend and only VC can create images?
@@ -1,5 +1,12 @@
 #include "Math.hpp"
 
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VKU_MATH_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace vku {
 Transform::Transform(const glm::vec3& pos, const glm::quat& rot, const glm::vec3& sca)
     : position{pos}, rotation{rot}, scale{sca} {}
@@ -23,6 +30,30 @@ glm::mat4 Transform::getTransform() const {
   return getTranslateMatrix() * getRotationMatrix() * getScaleMatrix();
 }
 
+TransformMatrices Transform::getMatrices() const {
+  // columns of the rotation matrix, same as glm::mat3_cast
+  const float x2 = rotation.x + rotation.x, y2 = rotation.y + rotation.y, z2 = rotation.z + rotation.z;
+  const float xx = rotation.x * x2, yy = rotation.y * y2, zz = rotation.z * z2;
+  const float xy = rotation.x * y2, xz = rotation.x * z2, yz = rotation.y * z2;
+  const float wx = rotation.w * x2, wy = rotation.w * y2, wz = rotation.w * z2;
+  const glm::vec3 r0{1.f - (yy + zz), xy + wz, xz - wy};
+  const glm::vec3 r1{xy - wz, 1.f - (xx + zz), yz + wx};
+  const glm::vec3 r2{xz + wy, yz - wx, 1.f - (xx + yy)};
+  const glm::vec3 invScale = 1.f / scale;
+
+  TransformMatrices m;
+  m.worldFromObject[0] = glm::vec4(r0 * scale.x, 0.f);
+  m.worldFromObject[1] = glm::vec4(r1 * scale.y, 0.f);
+  m.worldFromObject[2] = glm::vec4(r2 * scale.z, 0.f);
+  m.worldFromObject[3] = glm::vec4(position, 1.f);
+  // inverse is [S^-1 R^T, -S^-1 R^T p], its transpose has R S^-1 in the upper 3x3 and -S^-1 R^T p in the bottom row
+  m.dualWorldFromObject[0] = glm::vec4(r0 * invScale.x, -glm::dot(r0, position) * invScale.x);
+  m.dualWorldFromObject[1] = glm::vec4(r1 * invScale.y, -glm::dot(r1, position) * invScale.y);
+  m.dualWorldFromObject[2] = glm::vec4(r2 * invScale.z, -glm::dot(r2, position) * invScale.z);
+  m.dualWorldFromObject[3] = glm::vec4(0.f, 0.f, 0.f, 1.f);
+  return m;
+}
+
 TransformGPU Transform::toGPULayout() const {
   return TransformGPU{
       .position = glm::vec4(position, 1.f),
@@ -54,4 +85,136 @@ glm::quat rotateTowards(glm::quat q1, glm::quat q2, float maxAngle) {
   const float m = maxAngle / angle;
   return glm::mix(q1, q2, m);
 }
+
+void TransformsSoA::resize(size_t size) {
+  for (std::vector<float>* component : {&px, &py, &pz, &qx, &qy, &qz, &qw, &sx, &sy, &sz})
+    component->resize(size);
+}
+
+void TransformsSoA::assign(std::span<const Transform> transforms) {
+  resize(transforms.size());
+  for (size_t ix = 0; ix < transforms.size(); ++ix)
+    set(ix, transforms[ix]);
+}
+
+void TransformsSoA::set(size_t ix, const Transform& t) {
+  px[ix] = t.position.x, py[ix] = t.position.y, pz[ix] = t.position.z;
+  qx[ix] = t.rotation.x, qy[ix] = t.rotation.y, qz[ix] = t.rotation.z, qw[ix] = t.rotation.w;
+  sx[ix] = t.scale.x, sy[ix] = t.scale.y, sz[ix] = t.scale.z;
+}
+
+Transform TransformsSoA::get(size_t ix) const {
+  // glm::quat's constructor takes w first
+  return Transform{{px[ix], py[ix], pz[ix]}, glm::quat{qw[ix], qx[ix], qy[ix], qz[ix]}, {sx[ix], sy[ix], sz[ix]}};
+}
+
+#ifdef VKU_MATH_SSE2
+namespace {
+// x, y, z or w component of 4 consecutive Transforms
+struct TransformsX4 {
+  __m128 px, py, pz;
+  __m128 qx, qy, qz, qw;
+  __m128 sx, sy, sz;
+};
+
+// Registers hold one component of a column for 4 Transforms. Transposing turns them into 4 columns, one per Transform.
+inline void storeColumns(__m128 x, __m128 y, __m128 z, __m128 w, TransformMatrices* out, glm::mat4 TransformMatrices::*matrix, int column) {
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+  _mm_storeu_ps(&(out[0].*matrix)[column].x, x);
+  _mm_storeu_ps(&(out[1].*matrix)[column].x, y);
+  _mm_storeu_ps(&(out[2].*matrix)[column].x, z);
+  _mm_storeu_ps(&(out[3].*matrix)[column].x, w);
+}
+
+// Transform::getMatrices() for 4 Transforms at once
+inline void buildTransformsX4(const TransformsX4& t, TransformMatrices* out) {
+  const __m128 one = _mm_set1_ps(1.f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 x2 = _mm_add_ps(t.qx, t.qx), y2 = _mm_add_ps(t.qy, t.qy), z2 = _mm_add_ps(t.qz, t.qz);
+  const __m128 xx = _mm_mul_ps(t.qx, x2), yy = _mm_mul_ps(t.qy, y2), zz = _mm_mul_ps(t.qz, z2);
+  const __m128 xy = _mm_mul_ps(t.qx, y2), xz = _mm_mul_ps(t.qx, z2), yz = _mm_mul_ps(t.qy, z2);
+  const __m128 wx = _mm_mul_ps(t.qw, x2), wy = _mm_mul_ps(t.qw, y2), wz = _mm_mul_ps(t.qw, z2);
+  // rXy: y component of rotation matrix's column X
+  const __m128 r0x = _mm_sub_ps(one, _mm_add_ps(yy, zz)), r0y = _mm_add_ps(xy, wz), r0z = _mm_sub_ps(xz, wy);
+  const __m128 r1x = _mm_sub_ps(xy, wz), r1y = _mm_sub_ps(one, _mm_add_ps(xx, zz)), r1z = _mm_add_ps(yz, wx);
+  const __m128 r2x = _mm_add_ps(xz, wy), r2y = _mm_sub_ps(yz, wx), r2z = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+
+  storeColumns(_mm_mul_ps(r0x, t.sx), _mm_mul_ps(r0y, t.sx), _mm_mul_ps(r0z, t.sx), zero, out, &TransformMatrices::worldFromObject, 0);
+  storeColumns(_mm_mul_ps(r1x, t.sy), _mm_mul_ps(r1y, t.sy), _mm_mul_ps(r1z, t.sy), zero, out, &TransformMatrices::worldFromObject, 1);
+  storeColumns(_mm_mul_ps(r2x, t.sz), _mm_mul_ps(r2y, t.sz), _mm_mul_ps(r2z, t.sz), zero, out, &TransformMatrices::worldFromObject, 2);
+  storeColumns(t.px, t.py, t.pz, one, out, &TransformMatrices::worldFromObject, 3);
+
+  auto dot = [&t](__m128 rx, __m128 ry, __m128 rz) { return _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, t.px), _mm_mul_ps(ry, t.py)), _mm_mul_ps(rz, t.pz)); };
+  const __m128 isx = _mm_div_ps(one, t.sx), isy = _mm_div_ps(one, t.sy), isz = _mm_div_ps(one, t.sz);
+  storeColumns(_mm_mul_ps(r0x, isx), _mm_mul_ps(r0y, isx), _mm_mul_ps(r0z, isx), _mm_sub_ps(zero, _mm_mul_ps(dot(r0x, r0y, r0z), isx)), out, &TransformMatrices::dualWorldFromObject, 0);
+  storeColumns(_mm_mul_ps(r1x, isy), _mm_mul_ps(r1y, isy), _mm_mul_ps(r1z, isy), _mm_sub_ps(zero, _mm_mul_ps(dot(r1x, r1y, r1z), isy)), out, &TransformMatrices::dualWorldFromObject, 1);
+  storeColumns(_mm_mul_ps(r2x, isz), _mm_mul_ps(r2y, isz), _mm_mul_ps(r2z, isz), _mm_sub_ps(zero, _mm_mul_ps(dot(r2x, r2y, r2z), isz)), out, &TransformMatrices::dualWorldFromObject, 2);
+  storeColumns(zero, zero, zero, one, out, &TransformMatrices::dualWorldFromObject, 3);
+}
+}  // namespace
+#endif
+
+void buildTransforms(std::span<const Transform> transforms, std::span<TransformMatrices> out) {
+  assert(out.size() >= transforms.size());
+  size_t ix = 0;
+#ifdef VKU_MATH_SSE2
+  for (; ix + 4 <= transforms.size(); ix += 4) {
+    const Transform* t = &transforms[ix];
+    // gather each component of 4 Transforms into a register
+    auto gather = [t](auto component) { return _mm_setr_ps(component(t[0]), component(t[1]), component(t[2]), component(t[3])); };
+    const TransformsX4 x4{
+        gather([](const Transform& tr) { return tr.position.x; }),
+        gather([](const Transform& tr) { return tr.position.y; }),
+        gather([](const Transform& tr) { return tr.position.z; }),
+        gather([](const Transform& tr) { return tr.rotation.x; }),
+        gather([](const Transform& tr) { return tr.rotation.y; }),
+        gather([](const Transform& tr) { return tr.rotation.z; }),
+        gather([](const Transform& tr) { return tr.rotation.w; }),
+        gather([](const Transform& tr) { return tr.scale.x; }),
+        gather([](const Transform& tr) { return tr.scale.y; }),
+        gather([](const Transform& tr) { return tr.scale.z; }),
+    };
+    buildTransformsX4(x4, &out[ix]);
+  }
+#endif
+  for (; ix < transforms.size(); ++ix)
+    out[ix] = transforms[ix].getMatrices();
+}
+
+void buildTransforms(const TransformsSoA& transforms, std::span<TransformMatrices> out) {
+  buildTransforms(transforms, out, 0, transforms.size());
+}
+
+void buildTransforms(const TransformsSoA& transforms, std::span<TransformMatrices> out, size_t beginIx, size_t endIx) {
+  assert(beginIx <= endIx && endIx <= transforms.size() && out.size() >= endIx);
+  size_t ix = beginIx;
+#ifdef VKU_MATH_SSE2
+  for (; ix + 4 <= endIx; ix += 4) {
+    const TransformsX4 x4{
+        _mm_loadu_ps(&transforms.px[ix]), _mm_loadu_ps(&transforms.py[ix]), _mm_loadu_ps(&transforms.pz[ix]),
+        _mm_loadu_ps(&transforms.qx[ix]), _mm_loadu_ps(&transforms.qy[ix]), _mm_loadu_ps(&transforms.qz[ix]), _mm_loadu_ps(&transforms.qw[ix]),
+        _mm_loadu_ps(&transforms.sx[ix]), _mm_loadu_ps(&transforms.sy[ix]), _mm_loadu_ps(&transforms.sz[ix]),
+    };
+    buildTransformsX4(x4, &out[ix]);
+  }
+#endif
+  for (; ix < endIx; ++ix)
+    out[ix] = transforms.get(ix).getMatrices();
+}
+
+std::array<glm::vec4, 6> extractFrustumPlanes(const glm::mat4& projectionFromWorld) {
+  // Gribb & Hartmann: clip space -w <= x, y, z <= w, each inequality is a plane in world space made of rows of the matrix
+  const glm::mat4 m = glm::transpose(projectionFromWorld);  // columns of the transpose are rows of the original
+  std::array<glm::vec4, 6> planes = {
+      m[3] + m[0],  // left
+      m[3] - m[0],  // right
+      m[3] + m[1],  // bottom
+      m[3] - m[1],  // top
+      m[3] + m[2],  // near
+      m[3] - m[2],  // far
+  };
+  for (glm::vec4& p : planes)
+    p /= glm::length(glm::vec3(p));
+  return planes;
+}
 }  // namespace vku
\ No newline at end of file
@@ -2,7 +2,13 @@
 
 #include <glm/fwd.hpp>
 #include <glm/gtx/quaternion.hpp>
+#include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <span>
+#include <vector>
 
 namespace vku {
 
@@ -12,6 +18,12 @@ struct TransformGPU {
   glm::vec4 scale;
 };
 
+// Model matrix and its inverse transpose (for transforming normals). Same layout as the first two members of Studies' PushConstants.
+struct TransformMatrices {
+  glm::mat4 worldFromObject;
+  glm::mat4 dualWorldFromObject;
+};
+
 class Transform {
  public:
   glm::vec3 position;
@@ -25,8 +37,36 @@ class Transform {
   glm::mat4 getRotationMatrix() const;
   glm::mat4 getScaleMatrix() const;
   glm::mat4 getTransform() const;
+  // Same as {getTransform(), transpose(inverse(getTransform()))} without matrix products and a general inverse:
+  // TRS is composed directly from the quaternion, and inverse transpose of R * S is R * S^-1. rotation has to be unit length, scale non-zero.
+  TransformMatrices getMatrices() const;
   TransformGPU toGPULayout() const;
 };
 
+// Transforms as a structure of arrays, so that SIMD kernels load the same component of 4 consecutive Transforms with one instruction
+struct TransformsSoA {
+  std::vector<float> px, py, pz;
+  std::vector<float> qx, qy, qz, qw;
+  std::vector<float> sx, sy, sz;
+
+  size_t size() const { return px.size(); }
+  void resize(size_t size);
+  void assign(std::span<const Transform> transforms);
+  void set(size_t ix, const Transform& transform);
+  Transform get(size_t ix) const;
+};
+
+// Batched Transform::getMatrices(), 4 Transforms at a time with SSE (scalar where SSE2 is not available). out has to be at least as large as transforms.
+// From a span of Transforms components are gathered from strided memory, from TransformsSoA they are loaded directly, which is faster.
+void buildTransforms(std::span<const Transform> transforms, std::span<TransformMatrices> out);
+void buildTransforms(const TransformsSoA& transforms, std::span<TransformMatrices> out);
+// Only Transforms [beginIx, endIx) into out[beginIx, endIx), e.g. the changed range of an EntityStore
+void buildTransforms(const TransformsSoA& transforms, std::span<TransformMatrices> out, size_t beginIx, size_t endIx);
+
 glm::quat rotateTowards(glm::quat q1, glm::quat q2, float maxAngle);
+
+// Frustum planes (left, right, bottom, top, near, far) of a projectionFromWorld matrix, as (normal, d) with unit normals pointing inwards.
+// A point p is inside a plane when dot(normal, p) + d >= 0, so a sphere is fully outside when that is < -radius for any plane.
+// Near plane is the one of [-1, 1] depth range, which is slightly looser than [0, 1]'s, hence conservative for both conventions.
+std::array<glm::vec4, 6> extractFrustumPlanes(const glm::mat4& projectionFromWorld);
 }  // namespace vku
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "MeshFile.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vku {
+MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error(std::format("Cannot open {}", path.string()));
+  fileHandle = file;
+  LARGE_INTEGER fileSize{};
+  if (!GetFileSizeEx(file, &fileSize)) {
+    close();
+    throw std::runtime_error(std::format("Cannot get size of {}", path.string()));
+  }
+  sizeBytes = static_cast<size_t>(fileSize.QuadPart);
+  // mapping an empty file is an error on Windows
+  if (sizeBytes == 0)
+    return;
+  mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mappingHandle == nullptr) {
+    close();
+    throw std::runtime_error(std::format("Cannot create file mapping of {}", path.string()));
+  }
+  mappedData = static_cast<const std::byte*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+  if (mappedData == nullptr) {
+    close();
+    throw std::runtime_error(std::format("Cannot map view of {}", path.string()));
+  }
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error(std::format("Cannot open {}", path.string()));
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error(std::format("Cannot get size of {}", path.string()));
+  }
+  sizeBytes = static_cast<size_t>(st.st_size);
+  if (sizeBytes > 0) {
+    void* ptr = ::mmap(nullptr, sizeBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr == MAP_FAILED) {
+      ::close(fd);
+      sizeBytes = 0;
+      throw std::runtime_error(std::format("Cannot mmap {}", path.string()));
+    }
+    // whole file is going to be read right away, start reading ahead
+    ::madvise(ptr, sizeBytes, MADV_WILLNEED);
+    mappedData = static_cast<const std::byte*>(ptr);
+  }
+  // mapping stays valid after the descriptor is closed
+  ::close(fd);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : mappedData(std::exchange(other.mappedData, nullptr)),
+      sizeBytes(std::exchange(other.sizeBytes, 0))
+#ifdef _WIN32
+      ,
+      fileHandle(std::exchange(other.fileHandle, nullptr)),
+      mappingHandle(std::exchange(other.mappingHandle, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    close();
+    mappedData = std::exchange(other.mappedData, nullptr);
+    sizeBytes = std::exchange(other.sizeBytes, 0);
+#ifdef _WIN32
+    fileHandle = std::exchange(other.fileHandle, nullptr);
+    mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+  if (mappedData != nullptr)
+    UnmapViewOfFile(mappedData);
+  if (mappingHandle != nullptr)
+    CloseHandle(mappingHandle);
+  if (fileHandle != nullptr)
+    CloseHandle(fileHandle);
+  fileHandle = nullptr;
+  mappingHandle = nullptr;
+#else
+  if (mappedData != nullptr)
+    ::munmap(const_cast<std::byte*>(mappedData), sizeBytes);
+#endif
+  mappedData = nullptr;
+  sizeBytes = 0;
+}
+
+MappedMesh::MappedMesh(MappedFile mappedFile)
+    : file(std::move(mappedFile)) {
+  if (file.size() < sizeof(MeshFileHeader))
+    throw std::runtime_error("Mesh file is smaller than its header");
+  std::memcpy(&header, file.data(), sizeof(MeshFileHeader));
+  if (header.magic != MeshFileHeader::kMagic || header.version != MeshFileHeader::kVersion)
+    throw std::runtime_error("Mesh file has wrong magic number or version");
+  if (header.vertexStride != sizeof(DefaultVertex) || header.indexStride != sizeof(uint32_t))
+    throw std::runtime_error("Mesh file has been written with a different vertex layout");
+  // mapping is page aligned, so the arrays are aligned if their offsets are
+  if (header.verticesOffset % alignof(DefaultVertex) != 0 || header.indicesOffset % alignof(uint32_t) != 0)
+    throw std::runtime_error("Mesh file arrays are misaligned");
+  // divisions instead of multiplications so that a corrupt count cannot overflow
+  const uint64_t fileSize = file.size();
+  if (header.verticesOffset > fileSize || header.numVertices > (fileSize - header.verticesOffset) / sizeof(DefaultVertex) ||
+      header.indicesOffset > fileSize || header.numIndices > (fileSize - header.indicesOffset) / sizeof(uint32_t))
+    throw std::runtime_error("Mesh file is truncated");
+
+  vertices = {reinterpret_cast<const DefaultVertex*>(file.data() + header.verticesOffset), static_cast<size_t>(header.numVertices)};
+  indices = {reinterpret_cast<const uint32_t*>(file.data() + header.indicesOffset), static_cast<size_t>(header.numIndices)};
+}
+
+DefaultMeshData MappedMesh::toMeshData() const {
+  return {{vertices.begin(), vertices.end()}, {indices.begin(), indices.end()}};
+}
+
+bool writeMeshFile(const std::filesystem::path& path, const DefaultMeshData& mesh, uint64_t sourceSize, int64_t sourceWriteTime) {
+  MeshFileHeader header;
+  header.numVertices = mesh.vertices.size();
+  header.numIndices = mesh.indices.size();
+  header.verticesOffset = sizeof(MeshFileHeader);
+  header.indicesOffset = header.verticesOffset + header.numVertices * sizeof(DefaultVertex);
+  header.sourceSize = sourceSize;
+  header.sourceWriteTime = sourceWriteTime;
+
+  // Same as shader cache: write into a temporary file and rename, so that a concurrent reader never maps a partial file
+  std::error_code ec;
+  if (path.has_parent_path())
+    std::filesystem::create_directories(path.parent_path(), ec);
+  const std::filesystem::path tmpPath = path.string() + std::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+      return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(DefaultVertex));
+    out.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+    if (!out) {
+      out.close();
+      std::filesystem::remove(tmpPath, ec);
+      return false;
+    }
+  }
+  std::filesystem::rename(tmpPath, path, ec);
+  if (ec) {
+    std::filesystem::remove(tmpPath, ec);
+    return false;
+  }
+  return true;
+}
+
+std::optional<MappedMesh> openMeshFile(const std::filesystem::path& path) {
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(path, ec))
+    return std::nullopt;
+  try {
+    return MappedMesh{MappedFile{path}};
+  } catch (const std::runtime_error& e) {
+    std::cerr << std::format("Ignoring mesh file {}: {}\n", path.string(), e.what());
+    return std::nullopt;
+  }
+}
+
+MappedMesh loadOBJCached(const std::filesystem::path& objPath, const std::filesystem::path& cacheDir) {
+  // FNV-1a of the absolute path, so that OBJs with the same name in different folders do not collide
+  const std::string absPath = std::filesystem::absolute(objPath).generic_string();
+  uint64_t pathHash = 0xcbf29ce484222325ull;
+  for (const char c : absPath) {
+    pathHash ^= static_cast<uint8_t>(c);
+    pathHash *= 0x100000001b3ull;
+  }
+  const std::filesystem::path meshPath = cacheDir / std::format("{}-{:016x}.vkmesh", objPath.stem().string(), pathHash);
+
+  std::error_code ec;
+  const uint64_t sourceSize = std::filesystem::file_size(objPath, ec);
+  const bool hasSource = !ec;
+  const int64_t sourceWriteTime = hasSource ? static_cast<int64_t>(std::filesystem::last_write_time(objPath, ec).time_since_epoch().count()) : 0;
+
+  // When the OBJ is gone the cached mesh is still good enough
+  if (std::optional<MappedMesh> cached = openMeshFile(meshPath);
+      cached.has_value() && (!hasSource || (cached->header.sourceSize == sourceSize && cached->header.sourceWriteTime == sourceWriteTime)))
+    return std::move(*cached);
+
+  const auto start = std::chrono::steady_clock::now();
+  DefaultMeshData meshData = loadOBJ(objPath);
+  // done once at conversion, so cached meshes are vertex cache, overdraw and vertex fetch optimized for free
+  const MeshOptimizationReport report = optimizeMesh(meshData);
+  const float convertMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << std::format("Converted {} into {} ({} vertices, {} indices) in {:.1f} ms. ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}\n", objPath.filename().string(), meshPath.string(),
+                           meshData.vertices.size(), meshData.indices.size(), convertMs, report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+
+  if (writeMeshFile(meshPath, meshData, sourceSize, sourceWriteTime))
+    if (std::optional<MappedMesh> written = openMeshFile(meshPath); written.has_value())
+      return std::move(*written);
+
+  // cache directory is not writable, use the temp directory instead
+  const std::filesystem::path tmpPath = std::filesystem::temp_directory_path(ec) / meshPath.filename();
+  if (!ec && writeMeshFile(tmpPath, meshData, sourceSize, sourceWriteTime))
+    if (std::optional<MappedMesh> written = openMeshFile(tmpPath); written.has_value())
+      return std::move(*written);
+  throw std::runtime_error(std::format("Cannot write mesh file for {}", objPath.string()));
+}
+}  // namespace vku
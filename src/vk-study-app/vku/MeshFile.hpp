@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace vku {
+// Read-only memory mapping of a whole file.
+// Pages are faulted in on first access, so opening is cheap and reading goes at disk / page cache bandwidth.
+class MappedFile {
+ private:
+  const std::byte* mappedData = nullptr;
+  size_t sizeBytes = 0;
+#ifdef _WIN32
+  void* fileHandle = nullptr;
+  void* mappingHandle = nullptr;
+#endif
+
+ public:
+  MappedFile() = default;
+  // throws std::runtime_error if file cannot be opened or mapped
+  explicit MappedFile(const std::filesystem::path& path);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  inline const std::byte* data() const { return mappedData; }
+  inline size_t size() const { return sizeBytes; }
+
+ private:
+  void close();
+};
+
+// Binary mesh file layout: header, DefaultVertex array, uint32_t index array. Native endianness, no padding between sections.
+// It is a cache format produced from OBJ files, not an interchange format. Bump version whenever DefaultVertex or the layout changes.
+struct MeshFileHeader {
+  static constexpr uint32_t kMagic = 0x4D554B56;  // "VKUM" in little endian
+  static constexpr uint32_t kVersion = 2;  // 2: meshes are optimized with optimizeMesh()
+
+  uint32_t magic = kMagic;
+  uint32_t version = kVersion;
+  uint32_t vertexStride = sizeof(DefaultVertex);
+  uint32_t indexStride = sizeof(uint32_t);
+  uint64_t numVertices = 0;
+  uint64_t numIndices = 0;
+  // byte offsets of the arrays from the beginning of the file
+  uint64_t verticesOffset = 0;
+  uint64_t indicesOffset = 0;
+  // size and last write time of the file this mesh was converted from. Used to detect stale cache entries.
+  uint64_t sourceSize = 0;
+  int64_t sourceWriteTime = 0;
+};
+static_assert(sizeof(MeshFileHeader) == 64);
+
+// A mesh whose vertices and indices point directly into a memory mapped mesh file.
+// Spans can be given to vku::Buffer as is, which copies them straight into the staging ring without any parsing.
+// Has vertices and indices members like DefaultMeshData, hence generic code (e.g. a study's `const auto&` mesh insertion lambda) takes either.
+class MappedMesh {
+ private:
+  MappedFile file;
+
+ public:
+  MeshFileHeader header;
+  std::span<const DefaultVertex> vertices;
+  std::span<const uint32_t> indices;
+
+  // throws std::runtime_error if the file is not a valid mesh file of the current version
+  explicit MappedMesh(MappedFile mappedFile);
+
+  DefaultMeshData toMeshData() const;
+};
+
+// Writes mesh into path atomically (via a temporary file + rename). Returns false on failure.
+bool writeMeshFile(const std::filesystem::path& path, const DefaultMeshData& mesh, uint64_t sourceSize = 0, int64_t sourceWriteTime = 0);
+// Returns nullopt if the file does not exist, or is not a valid mesh file of the current version
+std::optional<MappedMesh> openMeshFile(const std::filesystem::path& path);
+
+// Loads an OBJ via its binary mesh file in cacheDir. Parses the OBJ (via loadOBJ) and runs optimizeMesh() on it only when there is no cached file, or the OBJ has changed since.
+MappedMesh loadOBJCached(const std::filesystem::path& objPath, const std::filesystem::path& cacheDir = "mesh-cache");
+}  // namespace vku
@@ -1,16 +1,28 @@
 #include "Model.hpp"
 
+#include "ThreadPool.hpp"
 #include "utils.hpp"
 
 #include <tiny_obj_loader.h>
+#include <glm/common.hpp>
 #include <glm/geometric.hpp>
+#include <glm/packing.hpp>
 #include <vulkan/vulkan.hpp>
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <numbers>
 #include <numeric>
+#include <span>
 #include <unordered_map>
+#include <utility>
 
 namespace vku {
 DefaultMeshData makeQuad(const glm::vec2& dimensions) {
@@ -103,6 +115,7 @@ DefaultMeshData makeBox(const glm::vec3& dimensions) {
   const Face fDown = {{p100, p101, p001, p000}, nDown};
 
   DefaultMeshData meshData;
+  meshData.vertices.reserve(36);
   const int faceIndices[] = {
       0,
       1,
@@ -126,49 +139,99 @@ DefaultMeshData makeBox(const glm::vec3& dimensions) {
   return meshData;
 }
 
-DefaultMeshData makeTorus(float outerRadius, uint32_t outerSegments, float innerRadius, uint32_t innerSegments) {
+// Fills a numRows x numCols vertex lattice via makeVertex(row, col) and connects neighbors with two triangles per quad.
+// Wrapping connects the last row (col) to the first one, as in a torus. Output is sized up-front and every row (and its quads) is written in place,
+// so rows can be generated in parallel chunks on ThreadPool workers. makeVertex has to be thread-safe then.
+template <typename TMakeVertex>
+static DefaultMeshData makeLattice(uint32_t numRows, uint32_t numCols, bool wrapRows, bool wrapCols, bool allowParallel, const TMakeVertex& makeVertex) {
+  const uint32_t numQuadRows = wrapRows ? numRows : numRows - 1;
+  const uint32_t numQuadCols = wrapCols ? numCols : numCols - 1;
   DefaultMeshData meshData;
-  for (uint32_t i = 0; i < outerSegments; i++) {
+  meshData.vertices.resize(static_cast<size_t>(numRows) * numCols);
+  meshData.indices.resize(static_cast<size_t>(numQuadRows) * numQuadCols * 6);
+
+  auto generateRows = [&](uint32_t beginRow, uint32_t endRow) {
+    for (uint32_t i = beginRow; i < endRow; ++i)
+      for (uint32_t j = 0; j < numCols; ++j)
+        meshData.vertices[static_cast<size_t>(i) * numCols + j] = makeVertex(i, j);
+    for (uint32_t i = beginRow; i < std::min(endRow, numQuadRows); ++i) {
+      uint32_t* out = &meshData.indices[static_cast<size_t>(i) * numQuadCols * 6];
+      for (uint32_t j = 0; j < numQuadCols; ++j) {
+        const uint32_t i1 = (i + 1) % numRows;
+        const uint32_t j1 = (j + 1) % numCols;
+        const uint32_t ix1 = i * numCols + j;
+        const uint32_t ix2 = i * numCols + j1;
+        const uint32_t ix3 = i1 * numCols + j;
+        const uint32_t ix4 = i1 * numCols + j1;
+        const uint32_t quad[] = {ix3, ix2, ix1,   // triangle-1
+                                 ix2, ix3, ix4};  // triangle-2
+        out = std::copy(std::begin(quad), std::end(quad), out);
+      }
+    }
+  };
+
+  // below this, thread handoff costs more than it saves
+  constexpr size_t kMinVerticesPerChunk = 16 * 1024;
+  ThreadPool& pool = ThreadPool::getGlobal();
+  const uint32_t rowsPerChunk = std::max(1u, static_cast<uint32_t>(kMinVerticesPerChunk / std::max(1u, numCols)));
+  const uint32_t numChunks = (numRows + rowsPerChunk - 1) / rowsPerChunk;
+  if (!allowParallel || numChunks < 2 || pool.getNumThreads() < 2) {
+    generateRows(0, numRows);
+    return meshData;
+  }
+  std::vector<std::future<void>> futures;
+  futures.reserve(numChunks);
+  for (uint32_t chunk = 0; chunk < numChunks; ++chunk) {
+    const uint32_t beginRow = chunk * rowsPerChunk;
+    const uint32_t endRow = std::min(numRows, beginRow + rowsPerChunk);
+    futures.push_back(pool.submit([&generateRows, beginRow, endRow]() { generateRows(beginRow, endRow); }));
+  }
+  for (auto& future : futures)
+    future.get();
+  return meshData;
+}
+
+DefaultMeshData makeTorus(float outerRadius, uint32_t outerSegments, float innerRadius, uint32_t innerSegments, bool allowParallel) {
+  return makeLattice(outerSegments, innerSegments, true, true, allowParallel, [=](uint32_t i, uint32_t j) {
     const float u = (float)i / (outerSegments - 1);
     const float outerAngle = 2.f * std::numbers::pi_v<float> * u;
     const glm::vec3 innerCenter = glm::vec3{cosf(outerAngle), sinf(outerAngle), 0.0f} * outerRadius;
-    for (uint32_t j = 0; j < innerSegments; j++) {
-      const float v = (float)j / (innerSegments - 1);
-      const float innerAngle = 2.f * std::numbers::pi_v<float> * v;
-      const glm::vec3 innerPos = glm::vec3{cosf(innerAngle) * cosf(outerAngle), cosf(innerAngle) * sinf(outerAngle), sinf(innerAngle)} * innerRadius;
-
-      const glm::vec3 pos = innerCenter + innerPos;
-      const glm::vec3 norm = glm::normalize(innerPos);
-      const glm::vec2 uv = {u, v};
-      const float pattern = static_cast<float>((i % 2) ^ (j % 2));
-      const glm::vec4 col = glm::vec4{1.0, 1.0, 0.0, 1.0} * pattern + glm::vec4{0.0, 1.0, 1.0, 1.0} * (1.0f - pattern);
-
-      meshData.vertices.emplace_back(DefaultVertex{pos, uv, norm, col});
-    }
-  }
+    const float v = (float)j / (innerSegments - 1);
+    const float innerAngle = 2.f * std::numbers::pi_v<float> * v;
+    const glm::vec3 innerPos = glm::vec3{cosf(innerAngle) * cosf(outerAngle), cosf(innerAngle) * sinf(outerAngle), sinf(innerAngle)} * innerRadius;
+
+    const glm::vec3 pos = innerCenter + innerPos;
+    const glm::vec3 norm = glm::normalize(innerPos);
+    const glm::vec2 uv = {u, v};
+    const float pattern = static_cast<float>((i % 2) ^ (j % 2));
+    const glm::vec4 col = glm::vec4{1.0, 1.0, 0.0, 1.0} * pattern + glm::vec4{0.0, 1.0, 1.0, 1.0} * (1.0f - pattern);
+    return DefaultVertex{pos, uv, norm, col};
+  });
+}
 
-  for (uint32_t i = 0; i < outerSegments; i++) {
-    for (uint32_t j = 0; j < innerSegments; j++) {
-      const uint32_t i1 = (i + 1) % outerSegments;
-      const uint32_t j1 = (j + 1) % innerSegments;
-      const uint32_t ix1 = i * innerSegments + j;
-      const uint32_t ix2 = i * innerSegments + j1;
-      const uint32_t ix3 = i1 * innerSegments + j;
-      const uint32_t ix4 = i1 * innerSegments + j1;
-
-      meshData.indices.insert(meshData.indices.begin(), {ix3, ix2, ix1});  // triangle-1
-      meshData.indices.insert(meshData.indices.begin(), {ix2, ix3, ix4});  // triangle-2
-    }
-  }
+DefaultMeshData makeGrid(const glm::vec2& dimensions, uint32_t numCellsX, uint32_t numCellsY, bool allowParallel) {
+  return makeLattice(numCellsX + 1, numCellsY + 1, false, false, allowParallel, [=](uint32_t i, uint32_t j) {
+    const glm::vec2 uv = {(float)i / numCellsX, (float)j / numCellsY};
+    const glm::vec2 xy = (uv - 0.5f) * dimensions;
+    return DefaultVertex{{xy.x, xy.y, 0}, uv, {0, 0, 1}, {uv.x, uv.y, 0, 1}};
+  });
+}
 
-  return meshData;
+DefaultMeshData makeSphere(float radius, uint32_t numSlices, uint32_t numStacks, bool allowParallel) {
+  // rows go from north to south pole, columns around the Y axis. Seam column is duplicated for UVs, poles are degenerate rows.
+  return makeLattice(numStacks + 1, numSlices + 1, false, false, allowParallel, [=](uint32_t i, uint32_t j) {
+    const glm::vec2 uv = {(float)j / numSlices, (float)i / numStacks};
+    const float theta = std::numbers::pi_v<float> * uv.y;
+    const float phi = 2.f * std::numbers::pi_v<float> * uv.x;
+    const glm::vec3 normal = {sinf(theta) * cosf(phi), cosf(theta), -sinf(theta) * sinf(phi)};
+    return DefaultVertex{normal * radius, uv, normal, glm::vec4{normal * 0.5f + 0.5f, 1}};
+  });
 }
 
 DefaultMeshData makeAxes() {
   DefaultMeshData xAxis = makeBox({1, 0.2, 0.2});
   DefaultMeshData yAxis = makeBox({0.2, 1, 0.2});
   DefaultMeshData zAxis = makeBox({0.2, 0.2, 1});
-  DefaultMeshData axes;
   for (auto& v : xAxis.vertices) {
     v.color = {1, 0, 0, 1};
     v.position += glm::vec3{0.5f, 0, 0};
@@ -182,19 +245,33 @@ DefaultMeshData makeAxes() {
     v.position += glm::vec3{0, 0, 0.5f};
   }
 
-  axes.vertices.insert(axes.vertices.end(), xAxis.vertices.begin(), xAxis.vertices.end());
-  axes.indices.insert(axes.indices.end(), xAxis.indices.begin(), xAxis.indices.end());
-
-  axes.vertices.insert(axes.vertices.end(), yAxis.vertices.begin(), yAxis.vertices.end());
-  for (int ix : yAxis.indices)
-    axes.indices.push_back(ix + static_cast<uint32_t>(xAxis.vertices.size()));
-
-  axes.vertices.insert(axes.vertices.end(), zAxis.vertices.begin(), zAxis.vertices.end());
-  for (int ix : zAxis.indices)
-    axes.indices.push_back(ix + static_cast<uint32_t>(xAxis.vertices.size() + yAxis.vertices.size()));
+  DefaultMeshData axes;
+  axes.vertices.reserve(xAxis.vertices.size() + yAxis.vertices.size() + zAxis.vertices.size());
+  axes.indices.reserve(xAxis.indices.size() + yAxis.indices.size() + zAxis.indices.size());
+  for (const DefaultMeshData* part : {&xAxis, &yAxis, &zAxis}) {
+    const uint32_t offset = static_cast<uint32_t>(axes.vertices.size());
+    axes.vertices.insert(axes.vertices.end(), part->vertices.begin(), part->vertices.end());
+    std::ranges::transform(part->indices, std::back_inserter(axes.indices), [offset](uint32_t ix) { return ix + offset; });
+  }
   return axes;
 }
 
+glm::vec4 getBoundingSphere(std::span<const DefaultVertex> vertices) {
+  if (vertices.empty())
+    return glm::vec4{0};
+  glm::vec3 minPos{std::numeric_limits<float>::max()};
+  glm::vec3 maxPos{std::numeric_limits<float>::lowest()};
+  for (const DefaultVertex& v : vertices) {
+    minPos = glm::min(minPos, v.position);
+    maxPos = glm::max(maxPos, v.position);
+  }
+  const glm::vec3 center = (minPos + maxPos) * 0.5f;
+  float maxDist2 = 0;
+  for (const DefaultVertex& v : vertices)
+    maxDist2 = std::max(maxDist2, glm::dot(v.position - center, v.position - center));
+  return {center, std::sqrt(maxDist2)};
+}
+
 struct VertexId {
   int posIx;
   int texIx;
@@ -215,10 +292,139 @@ struct VertexId {
   };
 };
 
+// Open-addressing (linear probing) table from (posIx, texIx, nrmIx) triples to vertex indices.
+// Slots are stored inline in one flat array, sized up-front from the number of OBJ indices (an upper bound for the number of unique vertices), so it never rehashes or allocates per insert.
+class VertexDedupTable {
+ private:
+  static constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+  struct Slot {
+    int posIx;
+    int texIx;
+    int nrmIx;
+    uint32_t vertexIndex = kEmpty;
+  };
+  std::vector<Slot> slots;
+  size_t mask;
+
+  // splitmix64 finalizer over the packed triple. Cheap and mixes well enough for sequential indices.
+  static uint64_t hash(const tinyobj::index_t& ix) {
+    uint64_t h = (static_cast<uint64_t>(static_cast<uint32_t>(ix.vertex_index)) << 32) | static_cast<uint32_t>(ix.normal_index);
+    h ^= static_cast<uint64_t>(static_cast<uint32_t>(ix.texcoord_index)) * 0x9e3779b97f4a7c15ull;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+  }
+
+ public:
+  explicit VertexDedupTable(size_t maxNumKeys)
+      : slots(std::bit_ceil(std::max<size_t>(16, maxNumKeys + maxNumKeys / 2))),  // load factor stays below 2/3
+        mask(slots.size() - 1) {}
+
+  // Single lookup-or-insert. Returns {vertexIndex of the triple, whether it was inserted}. newVertexIndex is stored if the triple was not there.
+  std::pair<uint32_t, bool> findOrInsert(const tinyobj::index_t& ix, uint32_t newVertexIndex) {
+    for (size_t i = hash(ix) & mask;; i = (i + 1) & mask) {
+      Slot& slot = slots[i];
+      if (slot.vertexIndex == kEmpty) {
+        slot = {ix.vertex_index, ix.texcoord_index, ix.normal_index, newVertexIndex};
+        return {newVertexIndex, true};
+      }
+      if (slot.posIx == ix.vertex_index && slot.texIx == ix.texcoord_index && slot.nrmIx == ix.normal_index)
+        return {slot.vertexIndex, false};
+    }
+  }
+};
+
+static DefaultVertex makeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& objIndex) {
+  const int posIx = objIndex.vertex_index, texIx = objIndex.texcoord_index, nrmIx = objIndex.normal_index;
+  return {
+      glm::vec3{attrib.vertices[3 * posIx], attrib.vertices[3 * posIx + 1], attrib.vertices[3 * posIx + 2]},
+      texIx >= 0 ? glm::vec2{attrib.texcoords[2 * texIx], attrib.texcoords[2 * texIx + 1]} : glm::vec2{},
+      glm::vec3{attrib.normals[3 * nrmIx], attrib.normals[3 * nrmIx + 1], attrib.normals[3 * nrmIx + 2]},
+      // when there is no color info in OBJ file tinyobjloader uses white
+      glm::vec4{attrib.colors[3 * posIx], attrib.colors[3 * posIx + 1], attrib.colors[3 * posIx + 2], 1},
+  };
+}
+
+// Previous implementation, kept for comparison. Two lookups per index into a node based map.
+static DefaultMeshData buildMeshWithUnorderedMap(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes) {
+  DefaultMeshData meshData;
+  uint32_t vertexIndex = 0;
+  std::unordered_map<VertexId, uint32_t, VertexId::HashFunc> vertexToIndex;  // map from unique vertex attribute combinations to IndexBuffer index
+  for (const auto& shape : shapes) {
+    for (const auto& objIndex : shape.mesh.indices) {
+      VertexId vId{objIndex.vertex_index, objIndex.texcoord_index, objIndex.normal_index};
+      if (vertexToIndex.contains(vId))
+        meshData.indices.push_back(vertexToIndex[vId]);
+      else {
+        meshData.vertices.push_back(makeVertex(attrib, objIndex));
+        meshData.indices.push_back(vertexIndex);
+        vertexToIndex.insert({vId, vertexIndex++});
+      }
+    }
+  }
+  return meshData;
+}
+
+// Single lookup per index into a flat table. Output is identical to buildMeshWithUnorderedMap's.
+static DefaultMeshData buildMeshWithFlatTable(const tinyobj::attrib_t& attrib, std::span<const tinyobj::shape_t> shapes) {
+  size_t numObjIndices = 0;
+  for (const auto& shape : shapes)
+    numObjIndices += shape.mesh.indices.size();
+
+  DefaultMeshData meshData;
+  // Every OBJ index becomes a mesh index. There are usually at least as many unique vertices as positions.
+  meshData.indices.reserve(numObjIndices);
+  meshData.vertices.reserve(std::min(numObjIndices, attrib.vertices.size() / 3));
+  VertexDedupTable vertexToIndex(numObjIndices);
+  for (const auto& shape : shapes) {
+    for (const auto& objIndex : shape.mesh.indices) {
+      const auto [vertexIndex, isNew] = vertexToIndex.findOrInsert(objIndex, static_cast<uint32_t>(meshData.vertices.size()));
+      if (isNew)
+        meshData.vertices.push_back(makeVertex(attrib, objIndex));
+      meshData.indices.push_back(vertexIndex);
+    }
+  }
+  return meshData;
+}
+
+// Each shape is deduplicated on a ThreadPool worker with its own table, and the results are concatenated.
+// Vertices shared between shapes are not merged, hence the vertex count can be higher than the serial version's.
+static DefaultMeshData buildMeshWithFlatTableParallel(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes) {
+  if (shapes.size() < 2)
+    return buildMeshWithFlatTable(attrib, shapes);
+
+  std::vector<std::future<DefaultMeshData>> futures;
+  futures.reserve(shapes.size());
+  for (size_t i = 0; i < shapes.size(); ++i)
+    futures.push_back(ThreadPool::getGlobal().submit([&attrib, &shapes, i]() { return buildMeshWithFlatTable(attrib, std::span(shapes).subspan(i, 1)); }));
+  std::vector<DefaultMeshData> shapeMeshes;
+  shapeMeshes.reserve(shapes.size());
+  size_t numVertices = 0, numIndices = 0;
+  for (auto& future : futures) {
+    shapeMeshes.push_back(future.get());
+    numVertices += shapeMeshes.back().vertices.size();
+    numIndices += shapeMeshes.back().indices.size();
+  }
+
+  DefaultMeshData meshData;
+  meshData.vertices.reserve(numVertices);
+  meshData.indices.reserve(numIndices);
+  for (const auto& shapeMesh : shapeMeshes) {
+    const uint32_t offset = static_cast<uint32_t>(meshData.vertices.size());
+    meshData.vertices.insert(meshData.vertices.end(), shapeMesh.vertices.begin(), shapeMesh.vertices.end());
+    std::ranges::transform(shapeMesh.indices, std::back_inserter(meshData.indices), [offset](uint32_t ix) { return ix + offset; });
+  }
+  return meshData;
+}
+
 // OBJ file is a compressed format. Each attribute (position, texCoord, normal) stores unqiue values, e.g. only one normal value is stored if all vertices have the same normal etc.
 // However, vertices sent to the GPU have combinations of the attributes. Here we stores only vertices with unique attributes in vertex data
 // and triangles are stored as successive triplets of indices to the vertex data.
-DefaultMeshData loadOBJ(const std::filesystem::path& filepath) {  // taken from https://github.com/tinyobjloader/tinyobjloader and modified
+DefaultMeshData loadOBJ(const std::filesystem::path& filepath, const LoadOBJOptions& options, LoadOBJStats* stats) {  // taken from https://github.com/tinyobjloader/tinyobjloader and modified
+  const auto start = std::chrono::steady_clock::now();
   tinyobj::ObjReaderConfig reader_config;
   tinyobj::ObjReader reader;
   // TODO: When errors happen return with a failure result. Can be done via optionals.
@@ -233,28 +439,258 @@ DefaultMeshData loadOBJ(const std::filesystem::path& filepath) {  // taken from
   // const std::vector<tinyobj::material_t>& materials = reader.GetMaterials(); TODO: use material info if mat file with the same name exists
   assert(attrib.vertices.size() % 3 == 0);  // Assert triangular mesh TODO: check should be on all faces
 
+  const auto parsed = std::chrono::steady_clock::now();
   DefaultMeshData meshData;
-  uint32_t vertexIndex = 0;
-  std::unordered_map<VertexId, uint32_t, VertexId::HashFunc> vertexToIndex;  // map from unique vertex attribute combinations to IndexBuffer index
-  for (const auto& shape : shapes) {
-    for (const auto& objIndex : shape.mesh.indices) {
-      VertexId vId{objIndex.vertex_index, objIndex.texcoord_index, objIndex.normal_index};
-      if (vertexToIndex.contains(vId))
-        meshData.indices.push_back(vertexToIndex[vId]);
-      else {
-        meshData.vertices.emplace_back(
-            glm::vec3{attrib.vertices[3 * vId.posIx], attrib.vertices[3 * vId.posIx + 1], attrib.vertices[3 * vId.posIx + 2]},
-            objIndex.texcoord_index >= 0 ? glm::vec2{attrib.texcoords[2 * vId.texIx], attrib.texcoords[2 * vId.texIx + 1]} : glm::vec2{},
-            glm::vec3{attrib.normals[3 * vId.nrmIx], attrib.normals[3 * vId.nrmIx + 1], attrib.normals[3 * vId.nrmIx + 2]},
-            // when there is no color info in OBJ file tinyobjloader uses white
-            glm::vec4{attrib.colors[3 * vId.posIx], attrib.colors[3 * vId.posIx + 1], attrib.colors[3 * vId.posIx + 2], 1});
-        meshData.indices.push_back(vertexIndex);
-        vertexToIndex.insert({vId, vertexIndex++});
+  switch (options.dedup) {
+    case OBJDedup::UnorderedMap:
+      meshData = buildMeshWithUnorderedMap(attrib, shapes);
+      break;
+    case OBJDedup::FlatTable:
+      meshData = buildMeshWithFlatTable(attrib, shapes);
+      break;
+    case OBJDedup::FlatTablePerShapeParallel:
+      meshData = buildMeshWithFlatTableParallel(attrib, shapes);
+      break;
+  }
+
+  if (stats != nullptr) {
+    const auto built = std::chrono::steady_clock::now();
+    stats->parseMs = std::chrono::duration<float, std::milli>(parsed - start).count();
+    stats->buildMs = std::chrono::duration<float, std::milli>(built - parsed).count();
+  }
+  return meshData;
+}
+
+// FIFO cache simulation. A vertex is a hit if it was transformed within the last cacheSize misses.
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t numVertices, uint32_t cacheSize) {
+  assert(indices.size() % 3 == 0);
+  // timestamp of each vertex' last miss. Starts far enough in the past so that first use of every vertex is a miss
+  std::vector<uint32_t> missTimes(numVertices, 0);
+  uint32_t time = cacheSize + 1;
+  size_t numMisses = 0;
+  size_t numUniqueVertices = 0;
+  for (uint32_t ix : indices) {
+    if (missTimes[ix] == 0)
+      ++numUniqueVertices;
+    if (time - missTimes[ix] > cacheSize) {
+      missTimes[ix] = time++;
+      ++numMisses;
+    }
+  }
+  const size_t numTriangles = indices.size() / 3;
+  return {
+      .acmr = numTriangles > 0 ? static_cast<float>(numMisses) / numTriangles : 0.f,
+      .atvr = numUniqueVertices > 0 ? static_cast<float>(numMisses) / numUniqueVertices : 0.f,
+  };
+}
+
+// Tom Forsyth's "Linear-Speed Vertex Cache Optimisation" https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+// Greedily emits the triangle with the highest score, where vertices score high if they are recently used (in an LRU cache model) or have few triangles left.
+namespace forsyth {
+constexpr uint32_t kCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+constexpr uint32_t kMaxValence = 64;  // valence scores above this are the same as this
+
+struct ScoreTables {
+  std::array<float, kCacheSize> cacheScores{};
+  std::array<float, kMaxValence + 1> valenceScores{};
+
+  ScoreTables() {
+    for (uint32_t pos = 0; pos < kCacheSize; ++pos)
+      // the 3 vertices of the last triangle get a fixed score, so that the algorithm does not prefer to emit triangles that share an edge with it over others in the cache
+      cacheScores[pos] = pos < 3 ? kLastTriangleScore : std::pow(1.0f - static_cast<float>(pos - 3) / (kCacheSize - 3), kCacheDecayPower);
+    for (uint32_t valence = 1; valence <= kMaxValence; ++valence)
+      valenceScores[valence] = kValenceBoostScale * std::pow(static_cast<float>(valence), -kValenceBoostPower);
+  }
+
+  float score(int cachePosition, uint32_t numRemainingTriangles) const {
+    if (numRemainingTriangles == 0)
+      return -1.0f;
+    const float cacheScore = cachePosition >= 0 ? cacheScores[cachePosition] : 0.0f;
+    return cacheScore + valenceScores[std::min(numRemainingTriangles, kMaxValence)];
+  }
+};
+}  // namespace forsyth
+
+void optimizeVertexCache(std::span<uint32_t> indices, size_t numVertices) {
+  assert(indices.size() % 3 == 0);
+  const size_t numTriangles = indices.size() / 3;
+  if (numTriangles == 0)
+    return;
+  static const forsyth::ScoreTables tables;
+
+  // vertex -> triangles adjacency in one array. Triangles of vertex v are at [triangleOffsets[v], triangleOffsets[v] + numRemaining[v]), emitted ones are swapped out to the end.
+  std::vector<uint32_t> triangleOffsets(numVertices + 1, 0);
+  for (uint32_t ix : indices)
+    ++triangleOffsets[ix + 1];
+  for (size_t v = 0; v < numVertices; ++v)
+    triangleOffsets[v + 1] += triangleOffsets[v];
+  std::vector<uint32_t> numRemaining(numVertices);
+  for (size_t v = 0; v < numVertices; ++v)
+    numRemaining[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+  std::vector<uint32_t> adjacency(indices.size());
+  {
+    std::vector<uint32_t> cursors(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+      adjacency[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  std::vector<int> cachePositions(numVertices, -1);
+  std::vector<float> vertexScores(numVertices);
+  for (size_t v = 0; v < numVertices; ++v)
+    vertexScores[v] = tables.score(-1, numRemaining[v]);
+  std::vector<float> triangleScores(numTriangles);
+  for (size_t t = 0; t < numTriangles; ++t)
+    triangleScores[t] = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+  std::vector<bool> isEmitted(numTriangles, false);
+
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> newCache;
+  cache.reserve(forsyth::kCacheSize + 3);
+  newCache.reserve(forsyth::kCacheSize + 3);
+  std::vector<uint32_t> optimized;
+  optimized.reserve(indices.size());
+
+  int64_t bestTriangle = std::distance(triangleScores.begin(), std::ranges::max_element(triangleScores));
+  size_t scanCursor = 0;
+  for (size_t numEmitted = 0; numEmitted < numTriangles; ++numEmitted) {
+    // None of the cached vertices have any triangles left. Continue from the next not emitted triangle in input order.
+    if (bestTriangle < 0) {
+      while (isEmitted[scanCursor])
+        ++scanCursor;
+      bestTriangle = static_cast<int64_t>(scanCursor);
+    }
+    const size_t t = static_cast<size_t>(bestTriangle);
+    isEmitted[t] = true;
+    const uint32_t* tri = &indices[3 * t];
+    optimized.insert(optimized.end(), tri, tri + 3);
+
+    // emitted triangle's vertices go to the front of the LRU cache
+    newCache.clear();
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t v = tri[k];
+      const auto first = adjacency.begin() + triangleOffsets[v];
+      const auto last = first + numRemaining[v];
+      std::iter_swap(std::find(first, last, static_cast<uint32_t>(t)), last - 1);
+      --numRemaining[v];
+      if (std::ranges::find(newCache, v) == newCache.end())
+        newCache.push_back(v);
+    }
+    for (uint32_t v : cache)
+      if (std::ranges::find(newCache, v) == newCache.end())
+        newCache.push_back(v);
+
+    // rescore vertices, including the ones that just got evicted
+    for (size_t pos = 0; pos < newCache.size(); ++pos) {
+      const uint32_t v = newCache[pos];
+      cachePositions[v] = pos < forsyth::kCacheSize ? static_cast<int>(pos) : -1;
+      vertexScores[v] = tables.score(cachePositions[v], numRemaining[v]);
+    }
+    // rescore their remaining triangles and pick the best one
+    bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (uint32_t v : newCache) {
+      for (uint32_t i = triangleOffsets[v]; i < triangleOffsets[v] + numRemaining[v]; ++i) {
+        const uint32_t adjTri = adjacency[i];
+        const float score = vertexScores[indices[3 * adjTri]] + vertexScores[indices[3 * adjTri + 1]] + vertexScores[indices[3 * adjTri + 2]];
+        triangleScores[adjTri] = score;
+        if (score > bestScore) {
+          bestScore = score;
+          bestTriangle = adjTri;
+        }
       }
     }
+    if (newCache.size() > forsyth::kCacheSize)
+      newCache.resize(forsyth::kCacheSize);
+    std::swap(cache, newCache);
   }
 
-  return meshData;
+  std::ranges::copy(optimized, indices.begin());
+}
+
+// Based on "Triangle Order Optimization for Graphics Hardware Computation Culling" (Nehab, Barczak, Sander), as simplified by meshoptimizer.
+// Splits the cache optimized triangle sequence into clusters at points where the cache starts cold anyway (a triangle whose 3 vertices are all misses),
+// then sorts clusters so that the ones facing away from the mesh center (outside surfaces that occlude the rest) come first. Order within a cluster is kept, hence ACMR barely changes.
+void optimizeOverdraw(std::span<uint32_t> indices, std::span<const glm::vec3> positions, uint32_t cacheSize) {
+  assert(indices.size() % 3 == 0);
+  const size_t numTriangles = indices.size() / 3;
+  if (numTriangles < 2)
+    return;
+
+  std::vector<uint32_t> clusterStarts;
+  {
+    std::vector<uint32_t> missTimes(positions.size(), 0);
+    uint32_t time = cacheSize + 1;
+    for (size_t t = 0; t < numTriangles; ++t) {
+      int numMisses = 0;
+      for (int k = 0; k < 3; ++k) {
+        const uint32_t ix = indices[3 * t + k];
+        if (time - missTimes[ix] > cacheSize) {
+          missTimes[ix] = time++;
+          ++numMisses;
+        }
+      }
+      if (t == 0 || numMisses == 3)
+        clusterStarts.push_back(static_cast<uint32_t>(t));
+    }
+  }
+  clusterStarts.push_back(static_cast<uint32_t>(numTriangles));
+  const size_t numClusters = clusterStarts.size() - 1;
+  if (numClusters < 2)
+    return;
+
+  // area weighted centroids and (unnormalized) average normals
+  glm::vec3 meshCentroid{0, 0, 0};
+  float meshArea = 0;
+  std::vector<glm::vec3> clusterCentroids(numClusters, glm::vec3{0, 0, 0});
+  std::vector<glm::vec3> clusterNormals(numClusters, glm::vec3{0, 0, 0});
+  for (size_t c = 0; c < numClusters; ++c) {
+    float clusterArea = 0;
+    for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+      const glm::vec3& p0 = positions[indices[3 * t]];
+      const glm::vec3& p1 = positions[indices[3 * t + 1]];
+      const glm::vec3& p2 = positions[indices[3 * t + 2]];
+      const glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);  // length is twice the area
+      const float area = glm::length(areaNormal);
+      const glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+      clusterCentroids[c] += centroid * area;
+      clusterNormals[c] += areaNormal;
+      clusterArea += area;
+    }
+    meshCentroid += clusterCentroids[c];
+    meshArea += clusterArea;
+    clusterCentroids[c] = clusterArea > 0 ? clusterCentroids[c] / clusterArea : positions[indices[3 * clusterStarts[c]]];
+  }
+  meshCentroid = meshArea > 0 ? meshCentroid / meshArea : meshCentroid;
+
+  std::vector<float> sortKeys(numClusters);
+  for (size_t c = 0; c < numClusters; ++c) {
+    const float normalLength = glm::length(clusterNormals[c]);
+    sortKeys[c] = normalLength > 0 ? glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength) : 0.0f;
+  }
+  std::vector<uint32_t> clusterOrder(numClusters);
+  std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+  std::ranges::stable_sort(clusterOrder, [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(indices.size());
+  for (uint32_t c : clusterOrder)
+    sorted.insert(sorted.end(), indices.begin() + 3 * clusterStarts[c], indices.begin() + 3 * clusterStarts[c + 1]);
+  std::ranges::copy(sorted, indices.begin());
+}
+
+size_t makeVertexFetchRemap(std::span<uint32_t> indices, size_t numVertices, std::vector<uint32_t>& remap) {
+  remap.assign(numVertices, kUnusedVertex);
+  uint32_t numUsed = 0;
+  for (uint32_t& ix : indices) {
+    if (remap[ix] == kUnusedVertex)
+      remap[ix] = numUsed++;
+    ix = remap[ix];
+  }
+  return numUsed;
 }
 
 VertexInputStateCreateInfo::VertexInputStateCreateInfo(const std::vector<vk::VertexInputBindingDescription>& bindingDescs, const std::vector<vk::VertexInputAttributeDescription>& attributeDescs)
@@ -273,4 +709,104 @@ VertexInputStateCreateInfo::VertexInputStateCreateInfo()
               {2, 0, vk::Format::eR32G32B32Sfloat, offsetof(DefaultVertex, normal)},
               {3, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(DefaultVertex, color)},
           }) {}
+
+VertexInputStateCreateInfo::VertexInputStateCreateInfo(const VertexInputStateCreateInfo& other)
+    : vk::PipelineVertexInputStateCreateInfo(other),
+      bindingDescriptions(other.bindingDescriptions),
+      attributeDescriptions(other.attributeDescriptions) {
+  setVertexAttributeDescriptions(attributeDescriptions);
+  setVertexBindingDescriptions(bindingDescriptions);
+}
+
+VertexInputStateCreateInfo::VertexInputStateCreateInfo(VertexInputStateCreateInfo&& other) noexcept
+    : vk::PipelineVertexInputStateCreateInfo(other),
+      bindingDescriptions(std::move(other.bindingDescriptions)),
+      attributeDescriptions(std::move(other.attributeDescriptions)) {
+  setVertexAttributeDescriptions(attributeDescriptions);
+  setVertexBindingDescriptions(bindingDescriptions);
+}
+
+VertexInputStateCreateInfo& VertexInputStateCreateInfo::operator=(const VertexInputStateCreateInfo& other) {
+  vk::PipelineVertexInputStateCreateInfo::operator=(other);
+  bindingDescriptions = other.bindingDescriptions;
+  attributeDescriptions = other.attributeDescriptions;
+  setVertexAttributeDescriptions(attributeDescriptions);
+  setVertexBindingDescriptions(bindingDescriptions);
+  return *this;
+}
+
+VertexInputStateCreateInfo& VertexInputStateCreateInfo::operator=(VertexInputStateCreateInfo&& other) noexcept {
+  vk::PipelineVertexInputStateCreateInfo::operator=(other);
+  bindingDescriptions = std::move(other.bindingDescriptions);
+  attributeDescriptions = std::move(other.attributeDescriptions);
+  setVertexAttributeDescriptions(attributeDescriptions);
+  setVertexBindingDescriptions(bindingDescriptions);
+  return *this;
+}
+
+std::array<vk::VertexInputAttributeDescription, 4> CompactVertex::getAttributeDescriptions(uint32_t binding, uint32_t firstLocation) {
+  return {{
+      {firstLocation + 0, binding, vk::Format::eR16G16B16A16Unorm, offsetof(CompactVertex, position)},
+      {firstLocation + 1, binding, vk::Format::eR16G16Sfloat, offsetof(CompactVertex, texCoord)},
+      {firstLocation + 2, binding, vk::Format::eR8G8Snorm, offsetof(CompactVertex, normal)},
+      {firstLocation + 3, binding, vk::Format::eR8G8B8A8Unorm, offsetof(CompactVertex, color)},
+  }};
+}
+
+glm::mat4 QuantizationBounds::getDequantizeMatrix() const {
+  glm::mat4 m{1};
+  m[0][0] = scale.x;
+  m[1][1] = scale.y;
+  m[2][2] = scale.z;
+  m[3] = glm::vec4{offset, 1};
+  return m;
+}
+
+glm::vec2 encodeOctahedral(const glm::vec3& normal) {
+  // project onto the octahedron |x| + |y| + |z| = 1, then fold the lower hemisphere over the diagonals
+  const glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+  if (n.z >= 0)
+    return {n.x, n.y};
+  const glm::vec2 signs{n.x >= 0 ? 1.f : -1.f, n.y >= 0 ? 1.f : -1.f};
+  return (1.0f - glm::abs(glm::vec2{n.y, n.x})) * signs;
+}
+
+glm::vec3 decodeOctahedral(const glm::vec2& encoded) {
+  glm::vec3 n{encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y)};
+  const float t = std::max(-n.z, 0.0f);
+  n.x += n.x >= 0 ? -t : t;
+  n.y += n.y >= 0 ? -t : t;
+  return glm::normalize(n);
+}
+
+CompactMeshData makeCompactMeshData(std::span<const DefaultVertex> vertices, std::span<const uint32_t> indices) {
+  CompactMeshData compact;
+  compact.indices.assign(indices.begin(), indices.end());
+  if (vertices.empty())
+    return compact;
+
+  glm::vec3 boundsMin = vertices[0].position;
+  glm::vec3 boundsMax = vertices[0].position;
+  for (const DefaultVertex& v : vertices) {
+    boundsMin = glm::min(boundsMin, v.position);
+    boundsMax = glm::max(boundsMax, v.position);
+  }
+  compact.bounds.offset = boundsMin;
+  // flat meshes (e.g. a quad) have zero extent along an axis
+  compact.bounds.scale = glm::max(boundsMax - boundsMin, glm::vec3{1e-6f});
+
+  compact.vertices.reserve(vertices.size());
+  for (const DefaultVertex& v : vertices) {
+    const glm::vec3 unorm = glm::clamp((v.position - compact.bounds.offset) / compact.bounds.scale, 0.0f, 1.0f);
+    const glm::vec3 normal = glm::length(v.normal) > 0 ? v.normal : glm::vec3{0, 0, 1};
+    const glm::vec2 oct = glm::clamp(encodeOctahedral(normal), -1.0f, 1.0f);
+    compact.vertices.push_back({
+        .position = {static_cast<uint16_t>(std::lround(unorm.x * 65535.0f)), static_cast<uint16_t>(std::lround(unorm.y * 65535.0f)), static_cast<uint16_t>(std::lround(unorm.z * 65535.0f))},
+        .normal = {static_cast<int8_t>(std::lround(oct.x * 127.0f)), static_cast<int8_t>(std::lround(oct.y * 127.0f))},
+        .texCoord = glm::packHalf2x16(v.texCoord),
+        .color = glm::packUnorm4x8(v.color),
+    });
+  }
+  return compact;
+}
 }  // namespace vku
@@ -3,10 +3,16 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
 
 #include <vulkan/vulkan.hpp>
 
+#include <array>
+#include <cstdint>
 #include <filesystem>
+#include <limits>
+#include <span>
+#include <vector>
 
 namespace vku {
 struct DefaultVertex {
@@ -26,6 +32,29 @@ struct MeshData {
 
 using DefaultMeshData = MeshData<DefaultVertex>;
 
+// 16 byte vertex, a third of DefaultVertex, for vertex fetch bound draws such as instancing
+struct CompactVertex {
+  std::array<uint16_t, 3> position;  // unorm16, relative to mesh bounds. See QuantizationBounds
+  std::array<int8_t, 2> normal;      // octahedral encoded, snorm8
+  uint32_t texCoord;                 // 2x half float (glm::packHalf2x16)
+  uint32_t color;                    // RGBA8 unorm (glm::packUnorm4x8)
+
+  // Position is read as R16G16B16A16Unorm (3-component 16-bit formats are not guaranteed vertex formats), hence its w overlaps with normal. Shaders ignore it.
+  static std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescriptions(uint32_t binding = 0, uint32_t firstLocation = 0);
+};
+static_assert(sizeof(CompactVertex) == 16);
+
+// Quantized positions are dequantized via position = offset + unorm * scale, which can be done in the vertex shader or folded into the world matrix
+struct QuantizationBounds {
+  glm::vec3 offset{0, 0, 0};  // bounding box min
+  glm::vec3 scale{1, 1, 1};   // bounding box extent
+  glm::mat4 getDequantizeMatrix() const;
+};
+
+struct CompactMeshData : MeshData<CompactVertex> {
+  QuantizationBounds bounds;
+};
+
 class VertexInputStateCreateInfo : public vk::PipelineVertexInputStateCreateInfo {
  private:
   std::vector<vk::VertexInputBindingDescription> bindingDescriptions;
@@ -34,11 +63,98 @@ class VertexInputStateCreateInfo : public vk::PipelineVertexInputStateCreateInfo
  public:
   VertexInputStateCreateInfo(const std::vector<vk::VertexInputBindingDescription>& bindingDescs, const std::vector<vk::VertexInputAttributeDescription>& attributeDescs);
   VertexInputStateCreateInfo();  // Meaningful default constructor
+  // Base class' description pointers point into own vectors, hence copies and moves re-point them
+  VertexInputStateCreateInfo(const VertexInputStateCreateInfo& other);
+  VertexInputStateCreateInfo(VertexInputStateCreateInfo&& other) noexcept;
+  VertexInputStateCreateInfo& operator=(const VertexInputStateCreateInfo& other);
+  VertexInputStateCreateInfo& operator=(VertexInputStateCreateInfo&& other) noexcept;
 };
 
+// Octahedral normal encoding, https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+glm::vec2 encodeOctahedral(const glm::vec3& normal);
+glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+CompactMeshData makeCompactMeshData(std::span<const DefaultVertex> vertices, std::span<const uint32_t> indices);
+inline CompactMeshData makeCompactMeshData(const DefaultMeshData& meshData) {
+  return makeCompactMeshData(meshData.vertices, meshData.indices);
+}
+
 DefaultMeshData makeQuad(const glm::vec2& dimensions);
 DefaultMeshData makeBox(const glm::vec3& dimensions = {1, 1, 1});
-DefaultMeshData makeTorus(float outerRadius, uint32_t outerSegments, float innerRadius, uint32_t innerSegments);
+// Generators below write into pre-sized vectors in linear time. Large ones are generated in parallel row chunks unless allowParallel is false.
+DefaultMeshData makeTorus(float outerRadius, uint32_t outerSegments, float innerRadius, uint32_t innerSegments, bool allowParallel = true);
+DefaultMeshData makeGrid(const glm::vec2& dimensions, uint32_t numCellsX, uint32_t numCellsY, bool allowParallel = true);
+DefaultMeshData makeSphere(float radius, uint32_t numSlices, uint32_t numStacks, bool allowParallel = true);
 DefaultMeshData makeAxes();
-DefaultMeshData loadOBJ(const std::filesystem::path& filepath);
+
+// Sphere around the bounding box center that encloses all positions. xyz: center, w: radius. Not minimal, but cheap and good enough for culling.
+glm::vec4 getBoundingSphere(std::span<const DefaultVertex> vertices);
+
+// How loadOBJ finds unique (position, texCoord, normal) combinations
+enum class OBJDedup {
+  // std::unordered_map with two lookups per index. Kept as baseline for Benchmarks' --obj
+  UnorderedMap,
+  // flat open-addressing table, reserved up-front, one lookup-or-insert per index
+  FlatTable,
+  // FlatTable per shape, shapes on ThreadPool workers. Vertices shared between shapes are not merged.
+  FlatTablePerShapeParallel,
+};
+
+struct LoadOBJOptions {
+  OBJDedup dedup = OBJDedup::FlatTable;
+};
+
+struct LoadOBJStats {
+  float parseMs{};  // tinyobjloader
+  float buildMs{};  // deduplication into vertex and index arrays
+};
+
+DefaultMeshData loadOBJ(const std::filesystem::path& filepath, const LoadOBJOptions& options = {}, LoadOBJStats* stats = nullptr);
+
+//---- Mesh optimization for triangle lists
+
+struct VertexCacheStats {
+  float acmr{};  // average cache miss ratio: transformed vertices per triangle. 0.5 is the ideal for large regular meshes, 3 is the worst
+  float atvr{};  // average transformed vertex ratio: transformed vertices per unique vertex. 1 is ideal
+};
+
+struct MeshOptimizationReport {
+  VertexCacheStats before;
+  VertexCacheStats after;
+};
+
+constexpr uint32_t kUnusedVertex = std::numeric_limits<uint32_t>::max();
+
+// Simulates a FIFO post-transform cache of given size
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t numVertices, uint32_t cacheSize = 16);
+// Reorders triangles for post-transform cache locality (Forsyth)
+void optimizeVertexCache(std::span<uint32_t> indices, size_t numVertices);
+// Reorders clusters of (cache optimized) triangles so that outward facing ones are drawn first, to reduce overdraw without hurting cache locality
+void optimizeOverdraw(std::span<uint32_t> indices, std::span<const glm::vec3> positions, uint32_t cacheSize = 16);
+// Renumbers vertices in order of first use in indices, which are rewritten. remap[oldIndex] is newIndex, or kUnusedVertex for vertices that are not referenced. Returns number of used vertices.
+size_t makeVertexFetchRemap(std::span<uint32_t> indices, size_t numVertices, std::vector<uint32_t>& remap);
+
+// Runs all three above in order and reorders (and drops unused) vertices accordingly
+template <typename TVertex>
+MeshOptimizationReport optimizeMesh(MeshData<TVertex>& mesh) {
+  MeshOptimizationReport report;
+  report.before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+  optimizeVertexCache(mesh.indices, mesh.vertices.size());
+
+  std::vector<glm::vec3> positions;
+  positions.reserve(mesh.vertices.size());
+  for (const TVertex& v : mesh.vertices)
+    positions.push_back(v.position);
+  optimizeOverdraw(mesh.indices, positions);
+
+  std::vector<uint32_t> remap;
+  std::vector<TVertex> vertices(makeVertexFetchRemap(mesh.indices, mesh.vertices.size(), remap));
+  for (size_t oldIx = 0; oldIx < remap.size(); ++oldIx)
+    if (remap[oldIx] != kUnusedVertex)
+      vertices[remap[oldIx]] = mesh.vertices[oldIx];
+  mesh.vertices = std::move(vertices);
+
+  report.after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+  return report;
+}
 }  // namespace vku
\ No newline at end of file
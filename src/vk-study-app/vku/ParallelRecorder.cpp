@@ -0,0 +1,65 @@
+#include "ParallelRecorder.hpp"
+
+#include "ThreadPool.hpp"
+
+#include <cassert>
+#include <future>
+
+namespace vku {
+ParallelRecorder::ParallelRecorder(const vk::raii::Device& device, uint32_t queueFamilyIndex, uint32_t numFrameSlots, uint32_t numWorkers)
+    : device(device) {
+  assert(numFrameSlots > 0 && numWorkers > 0);
+  pools.resize(numFrameSlots);
+  for (std::vector<WorkerPool>& slotPools : pools)
+    for (uint32_t ix = 0; ix < numWorkers; ++ix)
+      // Transient: buffers are short-lived, recorded once per frame
+      slotPools.push_back({vk::raii::CommandPool{device, vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eTransient, queueFamilyIndex)}});
+}
+
+void ParallelRecorder::beginFrame(uint32_t frameSlot) {
+  assert(frameSlot < pools.size());
+  currentSlot = frameSlot;
+  // keeps CommandBuffers allocated, they go back to initial state
+  for (WorkerPool& pool : pools[currentSlot]) {
+    if (pool.numUsed == 0)
+      continue;
+    pool.commandPool.reset();
+    pool.numUsed = 0;
+  }
+}
+
+std::vector<vk::CommandBuffer> ParallelRecorder::record(const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t numChunks,
+                                                         const std::function<void(const vk::raii::CommandBuffer& cmdBuf, uint32_t chunkIx)>& recordChunk) {
+  assert(numChunks <= getNumWorkers());
+  std::vector<WorkerPool>& slotPools = pools[currentSlot];
+  // Each chunk has a pool of its own, hence no locking. CommandBuffers are allocated on the calling thread, workers only record.
+  std::vector<const vk::raii::CommandBuffer*> cmdBufs;
+  for (uint32_t chunkIx = 0; chunkIx < numChunks; ++chunkIx) {
+    WorkerPool& pool = slotPools[chunkIx];
+    if (pool.numUsed == pool.commandBuffers.size()) {
+      vk::raii::CommandBuffers allocated(device, vk::CommandBufferAllocateInfo(*pool.commandPool, vk::CommandBufferLevel::eSecondary, 1));
+      pool.commandBuffers.push_back(std::move(allocated[0]));
+    }
+    cmdBufs.push_back(&pool.commandBuffers[pool.numUsed++]);
+  }
+
+  std::vector<std::future<void>> futures;
+  futures.reserve(numChunks);
+  for (uint32_t chunkIx = 0; chunkIx < numChunks; ++chunkIx)
+    futures.push_back(ThreadPool::getGlobal().submit([&inheritanceInfo, &recordChunk, cmdBuf = cmdBufs[chunkIx], chunkIx]() {
+      cmdBuf->begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritanceInfo));
+      recordChunk(*cmdBuf, chunkIx);
+      cmdBuf->end();
+    }));
+  // all chunks refer to locals of this function, hence wait for every one of them before rethrowing
+  for (auto& future : futures)
+    future.wait();
+  for (auto& future : futures)
+    future.get();
+
+  std::vector<vk::CommandBuffer> handles;
+  for (const vk::raii::CommandBuffer* cmdBuf : cmdBufs)
+    handles.push_back(**cmdBuf);
+  return handles;
+}
+}  // namespace vku
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vku {
+// Records secondary CommandBuffers on ThreadPool::getGlobal() workers, to spread the CPU cost of recording many draw calls across cores.
+// CommandPools are externally synchronized, hence every worker gets its own pool. And every frame-in-flight slot gets its own set of them,
+// so that all CommandBuffers of a slot are recycled with one pool reset once the frame that used them has finished.
+class ParallelRecorder {
+ private:
+  struct WorkerPool {
+    vk::raii::CommandPool commandPool;
+    std::vector<vk::raii::CommandBuffer> commandBuffers;
+    // number of commandBuffers handed out since the last reset
+    uint32_t numUsed = 0;
+  };
+
+  const vk::raii::Device& device;
+  // [frameSlot][worker]
+  std::vector<std::vector<WorkerPool>> pools;
+  uint32_t currentSlot = 0;
+
+ public:
+  ParallelRecorder(const vk::raii::Device& device, uint32_t queueFamilyIndex, uint32_t numFrameSlots, uint32_t numWorkers);
+  ParallelRecorder(const ParallelRecorder&) = delete;
+  ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+
+  // Maximum number of chunks a record() call can have
+  uint32_t getNumWorkers() const { return static_cast<uint32_t>(pools.front().size()); }
+  // Resets the pools of the slot. Call when the frame that used the slot last has finished on the GPU. (VulkanContext::drawFrameBegin does)
+  void beginFrame(uint32_t frameSlot);
+  // Records numChunks (<= getNumWorkers()) secondary CommandBuffers concurrently, that continue inheritanceInfo's render pass and subpass.
+  // recordChunk(cmdBuf, chunkIx) is called on worker threads with a begun CommandBuffer. It has to only read shared state. Viewport and scissor are not inherited, set them in each chunk.
+  // Blocks until all chunks are recorded, rethrows their exceptions. Not to be called concurrently.
+  // Returns CommandBuffers in chunk order, for executeCommands() in a render pass that was begun with vk::SubpassContents::eSecondaryCommandBuffers.
+  std::vector<vk::CommandBuffer> record(const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t numChunks, const std::function<void(const vk::raii::CommandBuffer& cmdBuf, uint32_t chunkIx)>& recordChunk);
+};
+}  // namespace vku
@@ -0,0 +1,77 @@
+#include "RenderQueue.hpp"
+
+#include "VulkanContext.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <tuple>
+
+namespace vku {
+RenderQueue::RenderQueue(uint32_t instanceStride)
+    : instanceStride(instanceStride) {}
+
+void RenderQueue::begin(uint32_t slot) {
+  frameSlot = slot;
+  submissions.clear();
+  instanceData.clear();
+  batches.clear();
+}
+
+void RenderQueue::submit(uint32_t pipelineId, const MeshRange& mesh, std::span<const std::byte> instance) {
+  assert(instance.size() == instanceStride);
+  submissions.emplace_back(pipelineId, mesh, static_cast<uint32_t>(submissions.size()));
+  instanceData.insert(instanceData.end(), instance.begin(), instance.end());
+}
+
+void RenderQueue::prepare(const VulkanContext& vc) {
+  batches.clear();
+  if (submissions.empty())
+    return;
+
+  // stable, so that instances of a group keep their submission order
+  std::ranges::stable_sort(submissions, [](const Submission& a, const Submission& b) {
+    return std::tie(a.pipelineId, a.mesh.firstIndex, a.mesh.indexCount) < std::tie(b.pipelineId, b.mesh.firstIndex, b.mesh.indexCount);
+  });
+
+  if (instanceBuffers.size() != vc.MAX_FRAMES_IN_FLIGHT) {
+    instanceBuffers.resize(vc.MAX_FRAMES_IN_FLIGHT);
+    instanceBufferCapacities.resize(vc.MAX_FRAMES_IN_FLIGHT, 0);
+  }
+  const uint32_t sizeBytes = static_cast<uint32_t>(submissions.size()) * instanceStride;
+  if (instanceBufferCapacities[frameSlot] < sizeBytes) {
+    // frame that used this slot last has finished, hence the old buffer can go right away
+    const uint32_t capacity = std::bit_ceil(sizeBytes);
+    instanceBuffers[frameSlot] = Buffer(vc, capacity, vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    instanceBufferCapacities[frameSlot] = capacity;
+  }
+
+  std::byte* dst = static_cast<std::byte*>(instanceBuffers[frameSlot].allocation.mappedData);
+  for (uint32_t ix = 0; ix < submissions.size(); ++ix) {
+    const Submission& s = submissions[ix];
+    std::memcpy(dst + ix * instanceStride, &instanceData[s.submissionIx * instanceStride], instanceStride);
+    if (!batches.empty() && batches.back().pipelineId == s.pipelineId && batches.back().mesh.firstIndex == s.mesh.firstIndex && batches.back().mesh.indexCount == s.mesh.indexCount)
+      ++batches.back().instanceCount;
+    else
+      batches.emplace_back(s.pipelineId, s.mesh, ix, 1);
+  }
+}
+
+void RenderQueue::record(const vk::raii::CommandBuffer& cmdBuf, uint32_t instanceBinding, const std::function<void(uint32_t pipelineId)>& bindPipeline) const {
+  if (batches.empty())
+    return;
+  const vk::DeviceSize offset = 0;
+  cmdBuf.bindVertexBuffers(instanceBinding, *instanceBuffers[frameSlot].buffer, offset);
+  bool isFirst = true;
+  uint32_t boundPipelineId = 0;
+  for (const Batch& batch : batches) {
+    if (isFirst || batch.pipelineId != boundPipelineId) {
+      bindPipeline(batch.pipelineId);
+      boundPipelineId = batch.pipelineId;
+      isFirst = false;
+    }
+    cmdBuf.drawIndexed(batch.mesh.indexCount, batch.instanceCount, batch.mesh.firstIndex, 0, batch.firstInstance);
+  }
+}
+}  // namespace vku
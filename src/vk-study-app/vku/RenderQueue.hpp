@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Buffer.hpp"
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace vku {
+class VulkanContext;
+
+// Index buffer range of a mesh, i.e. firstIndex and indexCount of its drawIndexed
+struct MeshRange {
+  uint32_t firstIndex;
+  uint32_t indexCount;
+};
+
+// Automatic instancing. Studies submit one draw per entity (pipeline id, mesh, per-instance data), as if they'd draw them one by one.
+// prepare() groups submissions by pipeline and mesh, and writes their instance data grouped into a per-frame-slot instance buffer.
+// record() emits one instanced drawIndexed per group, with firstInstance pointing at the group's instance data.
+// Draw calls go from O(entities) to O(unique pipeline and mesh pairs).
+//
+// Instance buffer is bound as a vertex buffer with eInstance input rate, hence shaders read instance data via vertex attributes.
+// Order of instances within a group is submission order. Groups are ordered by pipeline id, then by mesh.
+class RenderQueue {
+ public:
+  struct Batch {
+    uint32_t pipelineId;
+    MeshRange mesh;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+  };
+
+ private:
+  struct Submission {
+    uint32_t pipelineId;
+    MeshRange mesh;
+    uint32_t submissionIx;
+  };
+
+  uint32_t instanceStride;
+  std::vector<Submission> submissions;
+  // instance data in submission order
+  std::vector<std::byte> instanceData;
+  std::vector<Batch> batches;
+  // host-visible, one per frame-in-flight slot, grown when needed
+  std::vector<Buffer> instanceBuffers;
+  std::vector<uint32_t> instanceBufferCapacities;
+  uint32_t frameSlot = 0;
+
+ public:
+  // instanceStride: size of a submission's instance data in bytes
+  explicit RenderQueue(uint32_t instanceStride);
+
+  // Clears submissions of previous frame. frameSlot's buffer will be written by prepare(), hence the frame that used it last has to be finished.
+  void begin(uint32_t frameSlot);
+  void submit(uint32_t pipelineId, const MeshRange& mesh, std::span<const std::byte> instance);
+  template <typename TInstance>
+  void submit(uint32_t pipelineId, const MeshRange& mesh, const TInstance& instance) {
+    submit(pipelineId, mesh, std::as_bytes(std::span{&instance, 1}));
+  }
+  // Groups submissions into batches and uploads instance data
+  void prepare(const VulkanContext& vc);
+  // Binds instance buffer at vertex input binding instanceBinding, then for each batch calls bindPipeline(pipelineId) when the pipeline changes and records an instanced drawIndexed.
+  // Everything else (vertex/index buffers, descriptor sets) has to be bound by the caller.
+  void record(const vk::raii::CommandBuffer& cmdBuf, uint32_t instanceBinding, const std::function<void(uint32_t pipelineId)>& bindPipeline) const;
+
+  size_t getNumSubmissions() const { return submissions.size(); }
+  std::span<const Batch> getBatches() const { return batches; }
+};
+}  // namespace vku
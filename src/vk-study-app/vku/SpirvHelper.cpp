@@ -1,15 +1,133 @@
 #include "SpirvHelper.hpp"
 
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
 namespace vku {
 namespace spirv {
+// Parameters of GLSLtoSPV that affect its output. Part of the cache key.
+constexpr int kDefaultVersion = 100;
+constexpr EShMessages kMessages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+// Bump when initResources() or anything else in GLSLtoSPV changes the generated code, to invalidate old cache entries
+constexpr uint32_t kCompileOptionsRevision = 1;
+constexpr uint32_t kSpirvMagicNumber = 0x07230203;
+
+static std::mutex cacheDirMutex;
+static std::filesystem::path cacheDir = "shader-cache";
+static std::atomic<uint32_t> numCacheHits = 0;
+static std::atomic<uint32_t> numCacheMisses = 0;
+static std::atomic<int64_t> compileMicroseconds = 0;
+static std::atomic<int64_t> loadMicroseconds = 0;
+
+// FNV-1a, 64-bit
+static void hashBytes(uint64_t& hash, const void* data, size_t size) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+}
+
+static uint64_t makeCacheKey(vk::ShaderStageFlagBits shaderStage, std::string const& glsl) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  // glslang's version string and SPIR-V generator version change with glslang releases
+  const std::string glslangVersion = std::format("{}|{}", glslang::GetGlslVersionString(), glslang::GetSpirvGeneratorVersion());
+  hashBytes(hash, glslangVersion.data(), glslangVersion.size());
+  const uint32_t options[] = {static_cast<uint32_t>(shaderStage), static_cast<uint32_t>(kDefaultVersion), static_cast<uint32_t>(kMessages), kCompileOptionsRevision};
+  hashBytes(hash, options, sizeof(options));
+  hashBytes(hash, glsl.data(), glsl.size());
+  return hash;
+}
+
+static bool readBlob(const std::filesystem::path& path, std::vector<unsigned int>& spv) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in)
+    return false;
+  const std::streamsize size = in.tellg();
+  if (size <= 0 || size % sizeof(unsigned int) != 0)
+    return false;
+  spv.resize(size / sizeof(unsigned int));
+  in.seekg(0);
+  if (!in.read(reinterpret_cast<char*>(spv.data()), size) || spv[0] != kSpirvMagicNumber) {
+    spv.clear();
+    return false;
+  }
+  return true;
+}
+
+// Writes into a temporary file first and then renames it, so that a concurrent reader (or a crash) never sees a partial blob.
+// Failures are ignored, cache is best-effort.
+static void writeBlob(const std::filesystem::path& path, const std::vector<unsigned int>& spv) {
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  const std::filesystem::path tmpPath = path.string() + std::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+      return;
+    out.write(reinterpret_cast<const char*>(spv.data()), spv.size() * sizeof(unsigned int));
+    if (!out)
+      return;
+  }
+  std::filesystem::rename(tmpPath, path, ec);
+  if (ec)
+    std::filesystem::remove(tmpPath, ec);
+}
+
 vk::raii::ShaderModule makeShaderModule(vk::raii::Device const& device, vk::ShaderStageFlagBits shaderStage, std::string const& glsl) {
   std::vector<unsigned int> spv;
-  bool hasTranslated = GLSLtoSPV(shaderStage, glsl, spv);
+  bool hasTranslated = GLSLtoSPVCached(shaderStage, glsl, spv);
   assert(hasTranslated);
 
   return vk::raii::ShaderModule(device, vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), spv));
 }
 
+vk::raii::ShaderModule makeShaderModule(vk::raii::Device const& device, std::vector<uint32_t> const& spv) {
+  return vk::raii::ShaderModule(device, vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), spv));
+}
+
+// glslang can compile concurrently after InitializeProcess(), as long as each thread uses its own TShader/TProgram
+std::future<std::vector<uint32_t>> compileAsync(vk::ShaderStageFlagBits shaderStage, std::string glsl) {
+  return ThreadPool::getGlobal().submit([shaderStage, glsl = std::move(glsl)]() {
+    std::vector<uint32_t> spv;
+    if (!GLSLtoSPVCached(shaderStage, glsl, spv))
+      throw std::runtime_error(std::format("failed to compile {} shader", vk::to_string(shaderStage)));
+    return spv;
+  });
+}
+
+std::vector<std::vector<uint32_t>> compileBatch(std::vector<ShaderSource> sources) {
+  std::vector<std::future<std::vector<uint32_t>>> futures;
+  futures.reserve(sources.size());
+  for (auto& src : sources)
+    futures.push_back(compileAsync(src.stage, std::move(src.glsl)));
+
+  std::vector<std::vector<uint32_t>> spvs;
+  spvs.reserve(futures.size());
+  for (auto& future : futures)
+    spvs.push_back(future.get());
+  return spvs;
+}
+
+std::vector<vk::raii::ShaderModule> makeShaderModules(vk::raii::Device const& device, std::vector<ShaderSource> sources) {
+  std::vector<vk::raii::ShaderModule> modules;
+  for (const auto& spv : compileBatch(std::move(sources)))
+    modules.push_back(makeShaderModule(device, spv));
+  return modules;
+}
+
+std::vector<vk::raii::ShaderModule> makeShaderModules(vk::raii::Device const& device, std::string vertexGlsl, std::string fragmentGlsl) {
+  return makeShaderModules(device, {{vk::ShaderStageFlagBits::eVertex, std::move(vertexGlsl)}, {vk::ShaderStageFlagBits::eFragment, std::move(fragmentGlsl)}});
+}
+
 bool GLSLtoSPV(const vk::ShaderStageFlagBits shaderType, std::string const& glsl, std::vector<unsigned int>& spv) {
   const char* shaderStrings[1];
   shaderStrings[0] = glsl.data();
@@ -19,10 +137,10 @@ bool GLSLtoSPV(const vk::ShaderStageFlagBits shaderType, std::string const& glsl
   shader.setStrings(shaderStrings, 1);
 
   // Enable SPIR-V and Vulkan rules when parsing GLSL
-  EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+  EShMessages messages = kMessages;
   TBuiltInResource Resources = {};
   initResources(Resources);
-  if (!shader.parse(&Resources, 100, false, messages)) {
+  if (!shader.parse(&Resources, kDefaultVersion, false, messages)) {
     puts(shader.getInfoLog());
     puts(shader.getInfoDebugLog());
     return false;  // something didn't work
@@ -46,6 +164,47 @@ bool GLSLtoSPV(const vk::ShaderStageFlagBits shaderType, std::string const& glsl
   return true;
 }
 
+bool GLSLtoSPVCached(const vk::ShaderStageFlagBits shaderType, std::string const& glsl, std::vector<unsigned int>& spv) {
+  std::filesystem::path dir;
+  {
+    std::scoped_lock lock(cacheDirMutex);
+    dir = cacheDir;
+  }
+  const std::filesystem::path blobPath = dir.empty() ? std::filesystem::path{} : dir / std::format("{:016x}.spv", makeCacheKey(shaderType, glsl));
+
+  auto begin = std::chrono::steady_clock::now();
+  auto elapsedMicroseconds = [&begin]() { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count(); };
+
+  if (!blobPath.empty() && readBlob(blobPath, spv)) {
+    ++numCacheHits;
+    loadMicroseconds += elapsedMicroseconds();
+    return true;
+  }
+
+  ++numCacheMisses;
+  begin = std::chrono::steady_clock::now();
+  const bool hasTranslated = GLSLtoSPV(shaderType, glsl, spv);
+  compileMicroseconds += elapsedMicroseconds();
+  // failed compilations are not cached, so that their errors are printed every time
+  if (hasTranslated && !blobPath.empty())
+    writeBlob(blobPath, spv);
+  return hasTranslated;
+}
+
+void setCacheDirectory(const std::filesystem::path& dir) {
+  std::scoped_lock lock(cacheDirMutex);
+  cacheDir = dir;
+}
+
+CacheStats getCacheStats() {
+  return {
+      .numHits = numCacheHits,
+      .numMisses = numCacheMisses,
+      .compileMs = compileMicroseconds / 1000.f,
+      .loadMs = loadMicroseconds / 1000.f,
+  };
+}
+
 void init() {
   glslang::InitializeProcess();
 }
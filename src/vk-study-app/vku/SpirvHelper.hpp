@@ -3,11 +3,31 @@
 #include <glslang/SPIRV/GlslangToSpv.h>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <filesystem>
+#include <future>
+#include <string>
+#include <vector>
+
 namespace vku {
 namespace spirv {
 //---- API
 // Construct a shader module from given GLSL code
 vk::raii::ShaderModule makeShaderModule(vk::raii::Device const& device, vk::ShaderStageFlagBits shaderStage, std::string const& glsl);
+// Construct a shader module from already compiled SPIR-V
+vk::raii::ShaderModule makeShaderModule(vk::raii::Device const& device, std::vector<uint32_t> const& spv);
+
+struct ShaderSource {
+  vk::ShaderStageFlagBits stage;
+  std::string glsl;
+};
+// Compile on ThreadPool::getGlobal() workers (through the cache). Throws from future.get() if compilation fails.
+std::future<std::vector<uint32_t>> compileAsync(vk::ShaderStageFlagBits shaderStage, std::string glsl);
+// Compile all shaders concurrently and wait for them. Results are in the same order as sources.
+std::vector<std::vector<uint32_t>> compileBatch(std::vector<ShaderSource> sources);
+// Compile all shaders concurrently, then construct their modules, e.g. vertex and fragment shaders of a pipeline
+std::vector<vk::raii::ShaderModule> makeShaderModules(vk::raii::Device const& device, std::vector<ShaderSource> sources);
+// Same for the common case of a vertex and a fragment shader. Returns them in that order
+std::vector<vk::raii::ShaderModule> makeShaderModules(vk::raii::Device const& device, std::string vertexGlsl, std::string fragmentGlsl);
 
 // has to be called before shader operations
 void init();
@@ -15,6 +35,18 @@ void init();
 // has to be called while shutting down
 void finalize();
 
+// Compiled SPIR-V blobs are stored in this directory, named after a hash of GLSL source, stage, glslang version and compile options.
+// A cache hit skips glslang completely. Default is "shader-cache" under current working directory. Empty path disables caching.
+void setCacheDirectory(const std::filesystem::path& dir);
+
+struct CacheStats {
+  uint32_t numHits = 0;
+  uint32_t numMisses = 0;
+  float compileMs = 0;  // total time spent in glslang for misses
+  float loadMs = 0;     // total time spent reading blobs for hits
+};
+CacheStats getCacheStats();
+
 //---- Internal
 // Default Resources
 void initResources(TBuiltInResource& Resources);
@@ -22,5 +54,7 @@ void initResources(TBuiltInResource& Resources);
 EShLanguage translateShaderStage(vk::ShaderStageFlagBits stage);
 // Compile GLSL into SPV
 bool GLSLtoSPV(const vk::ShaderStageFlagBits shaderType, std::string const& glsl, std::vector<unsigned int>& spv);
+// Same as GLSLtoSPV but looks up/stores the result in the cache directory
+bool GLSLtoSPVCached(const vk::ShaderStageFlagBits shaderType, std::string const& glsl, std::vector<unsigned int>& spv);
 }  // namespace spirv
 }  // namespace vku
\ No newline at end of file
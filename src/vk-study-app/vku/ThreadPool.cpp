@@ -0,0 +1,38 @@
+#include "ThreadPool.hpp"
+
+namespace vku {
+ThreadPool::ThreadPool(uint32_t numThreads) {
+  workers.reserve(numThreads);
+  for (uint32_t i = 0; i < numThreads; ++i)
+    workers.emplace_back([this]() { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::scoped_lock lock(mutex);
+    isStopping = true;
+  }
+  hasTasksOrIsStopping.notify_all();
+  workers.clear();  // jthreads join on destruction
+}
+
+ThreadPool& ThreadPool::getGlobal() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    std::move_only_function<void()> task;
+    {
+      std::unique_lock lock(mutex);
+      hasTasksOrIsStopping.wait(lock, [this]() { return isStopping || !tasks.empty(); });
+      if (tasks.empty())
+        return;  // stopping and nothing left to do
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+}  // namespace vku
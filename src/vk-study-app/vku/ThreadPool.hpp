@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vku {
+// Fixed number of worker threads consuming a FIFO queue of tasks. Results are delivered via std::future.
+class ThreadPool {
+ private:
+  std::vector<std::jthread> workers;
+  std::deque<std::move_only_function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable hasTasksOrIsStopping;
+  bool isStopping = false;
+
+ public:
+  explicit ThreadPool(uint32_t numThreads = std::max(1u, std::thread::hardware_concurrency()));
+  // Finishes already queued tasks, then joins workers
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Process-wide pool, created on first use
+  static ThreadPool& getGlobal();
+
+  uint32_t getNumThreads() const { return static_cast<uint32_t>(workers.size()); }
+
+  // Exceptions thrown by the task are rethrown from future.get()
+  template <typename TFunc>
+  std::future<std::invoke_result_t<std::decay_t<TFunc>>> submit(TFunc&& func) {
+    std::packaged_task<std::invoke_result_t<std::decay_t<TFunc>>()> task(std::forward<TFunc>(func));
+    auto future = task.get_future();
+    {
+      std::scoped_lock lock(mutex);
+      tasks.emplace_back(std::move(task));
+    }
+    hasTasksOrIsStopping.notify_one();
+    return future;
+  }
+
+ private:
+  void workerLoop();
+};
+}  // namespace vku
@@ -11,48 +11,37 @@ class UniformBuffer {
  private:
   void* dstData = nullptr;
   uint32_t sizeBytes = 0;
-  vk::Device dev = nullptr;
 
  public:
   T src{};
+  // declared before buffer so that buffer is destroyed before its memory range is given back
+  Allocation allocation;
   vk::raii::Buffer buffer = nullptr;
-  vk::raii::DeviceMemory memory = nullptr;
   vk::DescriptorBufferInfo descriptor;
 
   UniformBuffer() = default;
   UniformBuffer(const VulkanContext& vc)
       : UniformBuffer<T>(vc, T()) {}
 
-  UniformBuffer(const VulkanContext& vc, const T& data)
-      : src(data), sizeBytes(sizeof(T)) {
-    vk::MemoryAllocateInfo memAlloc;
-    vk::MemoryRequirements memReqs;
-
+  // usage: eStorageBuffer to put it into VulkanContext::bindlessHeap
+  UniformBuffer(const VulkanContext& vc, const T& data, vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eUniformBuffer)
+      : sizeBytes(sizeof(T)), src(data) {
     // Create a host-visible (CPU) buffer & memory for uniform data
-    buffer = vk::raii::Buffer(vc.device, vk::BufferCreateInfo({}, sizeBytes, vk::BufferUsageFlagBits::eUniformBuffer));
-    memReqs = buffer.getMemoryRequirements();
-    memAlloc.allocationSize = memReqs.size;
-    memAlloc.memoryTypeIndex = vc.getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eHostCoherent);  // HostVisible is enough if we unmap here
-    memory = vk::raii::DeviceMemory{vc.device, vk::MemoryAllocateInfo(memReqs.size, memAlloc.memoryTypeIndex)};
-    dev = *vc.device;
-    dev.bindBufferMemory(*buffer, *memory, 0);
+    // Many small UBOs share one block of the allocator. The block is persistently mapped, so no need to map/unmap here.
+    buffer = vk::raii::Buffer(vc.device, vk::BufferCreateInfo({}, sizeBytes, usage));
+    allocation = vc.allocator.allocateForBuffer(buffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
 
     descriptor.buffer = *buffer;
     descriptor.offset = 0;
     descriptor.range = sizeBytes;
 
-    dstData = dev.mapMemory(*memory, 0, memAlloc.allocationSize, vk::MemoryMapFlags());
+    dstData = allocation.mappedData;
     memcpy(dstData, &src, sizeBytes);
   }
 
   void update() const {
     memcpy(dstData, &src, sizeBytes);
   }
-
-  void unmap() {
-    // I don't think that unmap needs to be called at destruction
-    dev.unmapMemory(*memory);
-  }
 };
 
 template <typename TUniformStruct>
@@ -0,0 +1,152 @@
+#include "UploadQueue.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <optional>
+
+namespace vku {
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+UploadQueue::UploadQueue(const vk::raii::Device& device, Allocator& allocator, const vk::raii::Queue& queue, uint32_t queueFamilyIndex, std::vector<uint32_t> consumerQueueFamilies, vk::DeviceSize stagingCapacity)
+    : device(device),
+      allocator(allocator),
+      queue(queue),
+      queueFamilies([&]() {
+        consumerQueueFamilies.push_back(queueFamilyIndex);
+        std::ranges::sort(consumerQueueFamilies);
+        const auto [first, last] = std::ranges::unique(consumerQueueFamilies);
+        consumerQueueFamilies.erase(first, last);
+        return consumerQueueFamilies;
+      }()),
+      commandPool(device, vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient, queueFamilyIndex)),
+      timelineSemaphore([&]() {
+        vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo(vk::SemaphoreType::eTimeline, 0);
+        return vk::raii::Semaphore{device, vk::SemaphoreCreateInfo({}, &semaphoreTypeCreateInfo)};
+      }()),
+      stagingCapacity(stagingCapacity),
+      stagingBuffer(device, vk::BufferCreateInfo({}, stagingCapacity, vk::BufferUsageFlagBits::eTransferSrc)) {
+  stagingAllocation = allocator.allocateForBuffer(stagingBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+UploadQueue::~UploadQueue() {
+  wait(flush());
+}
+
+void UploadQueue::setSharingMode(vk::BufferCreateInfo& bufferCreateInfo) const {
+  // Concurrent sharing saves us from queue family ownership transfer barriers. Only uploaded (mostly static) buffers get it.
+  if (queueFamilies.size() > 1)
+    bufferCreateInfo.setSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(queueFamilies);
+}
+
+void UploadQueue::enqueue(const vk::raii::Buffer& dst, const void* srcData, vk::DeviceSize sizeBytes, vk::DeviceSize dstOffset) {
+  std::scoped_lock lock(mutex);
+
+  if (sizeBytes > stagingCapacity) {
+    OversizedStaging staging{Allocation{}, vk::raii::Buffer{device, vk::BufferCreateInfo({}, sizeBytes, vk::BufferUsageFlagBits::eTransferSrc)}};
+    staging.allocation = allocator.allocateForBuffer(staging.buffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    memcpy(staging.allocation.mappedData, srcData, sizeBytes);
+    getPendingCommandBuffer().copyBuffer(*staging.buffer, *dst, vk::BufferCopy{0, dstOffset, sizeBytes});
+    pendingBatch.oversizedStagings.push_back(std::move(staging));
+    return;
+  }
+
+  // might flush the pending batch to make room, hence called before getting the pending CommandBuffer
+  const vk::DeviceSize stagingOffset = allocateStaging(sizeBytes);
+  memcpy(static_cast<uint8_t*>(stagingAllocation.mappedData) + stagingOffset, srcData, sizeBytes);
+  getPendingCommandBuffer().copyBuffer(*stagingBuffer, *dst, vk::BufferCopy{stagingOffset, dstOffset, sizeBytes});
+}
+
+uint64_t UploadQueue::flush() {
+  std::scoped_lock lock(mutex);
+  return flushLocked();
+}
+
+uint64_t UploadQueue::flushLocked() {
+  // flush() runs every frame, so finished batches (and their oversized staging buffers) are freed even without further ring allocations
+  reclaimCompleted();
+  if (!*pendingBatch.cmdBuf)
+    return lastSubmittedValue;
+
+  pendingBatch.cmdBuf.end();
+  pendingBatch.timelineValue = ++lastSubmittedValue;
+  const vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo({}, pendingBatch.timelineValue);
+  const vk::SubmitInfo submitInfo({}, {}, *pendingBatch.cmdBuf, *timelineSemaphore, &timelineSubmitInfo);
+  queue.submit(submitInfo);
+
+  inFlightBatches.push_back(std::move(pendingBatch));
+  pendingBatch = Batch{};
+  return lastSubmittedValue;
+}
+
+bool UploadQueue::isComplete(uint64_t timelineValue) const {
+  return timelineSemaphore.getCounterValue() >= timelineValue;
+}
+
+void UploadQueue::wait(uint64_t timelineValue) const {
+  const vk::SemaphoreWaitInfo waitInfo({}, *timelineSemaphore, timelineValue);
+  [[maybe_unused]] const vk::Result result = device.waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max());
+  assert(result == vk::Result::eSuccess);
+}
+
+void UploadQueue::reclaimCompleted() {
+  const uint64_t completedValue = timelineSemaphore.getCounterValue();
+  while (!inFlightBatches.empty() && inFlightBatches.front().timelineValue <= completedValue) {
+    freeCommandBuffers.push_back(std::move(inFlightBatches.front().cmdBuf));
+    inFlightBatches.pop_front();
+  }
+  while (!stagingRanges.empty() && stagingRanges.front().timelineValue <= completedValue)
+    stagingRanges.pop_front();
+}
+
+vk::DeviceSize UploadQueue::allocateStaging(vk::DeviceSize sizeBytes) {
+  const vk::DeviceSize size = alignUp(sizeBytes, 16);
+  while (true) {
+    reclaimCompleted();
+    if (stagingRanges.empty())
+      stagingHead = 0;
+
+    std::optional<vk::DeviceSize> offset;
+    // Used part of the ring is [oldest, head) when it does not wrap around. Then free space is [head, capacity) and [0, oldest).
+    // When it wraps around (or the ring is empty) free space is [head, oldest).
+    const vk::DeviceSize oldest = stagingRanges.empty() ? stagingCapacity : stagingRanges.front().offset;
+    if (!stagingRanges.empty() && stagingHead > oldest) {
+      if (stagingHead + size <= stagingCapacity)
+        offset = stagingHead;
+      else if (size <= oldest)
+        offset = 0;
+    } else if (stagingHead + size <= oldest) {
+      offset = stagingHead;
+    }
+
+    if (offset.has_value()) {
+      stagingHead = offset.value() + size;
+      stagingRanges.push_back(StagingRange{offset.value(), size, lastSubmittedValue + 1});
+      return offset.value();
+    }
+
+    // Ring is full. Submit what's recorded so far and wait for the oldest range to be released.
+    flushLocked();
+    wait(stagingRanges.front().timelineValue);
+  }
+}
+
+const vk::raii::CommandBuffer& UploadQueue::getPendingCommandBuffer() {
+  if (*pendingBatch.cmdBuf)
+    return pendingBatch.cmdBuf;
+
+  if (freeCommandBuffers.empty()) {
+    vk::raii::CommandBuffers cmdBufs(device, vk::CommandBufferAllocateInfo(*commandPool, vk::CommandBufferLevel::ePrimary, 1));
+    pendingBatch.cmdBuf = std::move(cmdBufs[0]);
+  } else {
+    pendingBatch.cmdBuf = std::move(freeCommandBuffers.back());
+    freeCommandBuffers.pop_back();
+  }
+  pendingBatch.cmdBuf.reset();
+  pendingBatch.cmdBuf.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+  return pendingBatch.cmdBuf;
+}
+}  // namespace vku
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Allocator.hpp"
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace vku {
+// Batches host -> device buffer uploads without stalling.
+// Source data is copied into a persistently mapped staging ring buffer right away, and copy commands are recorded into the current batch's CommandBuffer.
+// flush() submits the batch to the transfer queue (a dedicated one if the device has it) and signals a timeline semaphore with the batch's value.
+// Consumers wait for that value on the GPU (VulkanContext::drawFrameEnd does it for frame submissions) or on the host via wait().
+class UploadQueue {
+ private:
+  struct StagingRange {
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+    uint64_t timelineValue;
+  };
+  // uploads larger than the whole ring get their own staging buffer, kept alive until the batch completes
+  struct OversizedStaging {
+    Allocation allocation;
+    vk::raii::Buffer buffer;
+  };
+  struct Batch {
+    vk::raii::CommandBuffer cmdBuf = nullptr;
+    uint64_t timelineValue = 0;
+    std::vector<OversizedStaging> oversizedStagings;
+  };
+
+  const vk::raii::Device& device;
+  Allocator& allocator;
+  const vk::raii::Queue& queue;
+  // families that access uploaded buffers. More than one means buffers need concurrent sharing mode
+  std::vector<uint32_t> queueFamilies;
+  vk::raii::CommandPool commandPool;
+  vk::raii::Semaphore timelineSemaphore;
+
+  const vk::DeviceSize stagingCapacity;
+  Allocation stagingAllocation;
+  vk::raii::Buffer stagingBuffer;
+  vk::DeviceSize stagingHead = 0;
+  // staging ranges in allocation order, released when their batch completes
+  std::deque<StagingRange> stagingRanges;
+
+  // batch that's being recorded. Its cmdBuf is null if nothing was enqueued since the last flush
+  Batch pendingBatch;
+  std::deque<Batch> inFlightBatches;
+  std::vector<vk::raii::CommandBuffer> freeCommandBuffers;
+  uint64_t lastSubmittedValue = 0;
+  std::mutex mutex;
+
+ public:
+  UploadQueue(const vk::raii::Device& device, Allocator& allocator, const vk::raii::Queue& queue, uint32_t queueFamilyIndex, std::vector<uint32_t> consumerQueueFamilies, vk::DeviceSize stagingCapacity = 32 * 1024 * 1024);
+  ~UploadQueue();
+  UploadQueue(const UploadQueue&) = delete;
+  UploadQueue& operator=(const UploadQueue&) = delete;
+
+  // Sets concurrent sharing mode if upload queue family differs from consumer ones. Call on create infos of buffers that'll be uploaded to.
+  void setSharingMode(vk::BufferCreateInfo& bufferCreateInfo) const;
+
+  // Copies srcData into staging memory immediately (srcData can be freed after return) and records the copy into the pending batch.
+  void enqueue(const vk::raii::Buffer& dst, const void* srcData, vk::DeviceSize sizeBytes, vk::DeviceSize dstOffset = 0);
+  // Submits the pending batch if there is one, and frees finished ones. Returns the timeline value that'll be signaled when all uploads enqueued so far are done.
+  uint64_t flush();
+  bool isComplete(uint64_t timelineValue) const;
+  // Blocks the host until given value is reached
+  void wait(uint64_t timelineValue) const;
+
+  const vk::raii::Semaphore& getTimelineSemaphore() const { return timelineSemaphore; }
+
+ private:
+  uint64_t flushLocked();
+  void reclaimCompleted();
+  vk::DeviceSize allocateStaging(vk::DeviceSize sizeBytes);
+  const vk::raii::CommandBuffer& getPendingCommandBuffer();
+};
+}  // namespace vku
@@ -1,10 +1,18 @@
 #include "VulkanContext.hpp"
 
 #include "Image.hpp"
+#include "ThreadPool.hpp"
 #include "utils.hpp"
 
 #include <VkBootstrap.h>
 
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
 namespace vku {
 VulkanContext::VulkanContext(vku::Window& window, const AppSettings& appSettings)
     : appSettings(appSettings),
@@ -14,6 +22,8 @@ VulkanContext::VulkanContext(vku::Window& window, const AppSettings& appSettings
       physicalDevice(constructPhysicalDevice()),
       physicalDeviceMemoryProperties(physicalDevice.getMemoryProperties()),
       device(constructDevice()),
+      allocator(device, physicalDevice),
+      pipelineCache(constructPipelineCache()),
       // TODO: find a better format picking scheme // can get available formats via: auto surfaceFormats = physicalDevice.getSurfaceFormatsKHR(*surface);
       swapchainColorFormat(vk::Format::eB8G8R8A8Unorm),  // or vk::Format::eB8G8R8A8Srgb;
       swapchainColorSpace(vk::ColorSpaceKHR::eSrgbNonlinear),
@@ -22,11 +32,20 @@ VulkanContext::VulkanContext(vku::Window& window, const AppSettings& appSettings
       swapchain(constructSwapchain()),
       swapchainImageViews(constructSwapchainImageViews()),
       graphicsQueue{device, vkbDevice.get_queue(vkb::QueueType::graphics).value()},
-      presentQueue{device, vkbDevice.get_queue(vkb::QueueType::present).value()},
+      // There is nothing to present to in headless mode. Graphics queue stands in for the present queue.
+      presentQueue{device, vkbDevice.get_queue(appSettings.isHeadless ? vkb::QueueType::graphics : vkb::QueueType::present).value()},
       computeQueue{device, vkbDevice.get_queue(vkb::QueueType::compute).value()},
+      transferQueue([&]() {
+        auto dedicatedQueue = vkbDevice.get_dedicated_queue(vkb::QueueType::transfer);
+        return vk::raii::Queue{device, dedicatedQueue.has_value() ? dedicatedQueue.value() : vkbDevice.get_queue(vkb::QueueType::graphics).value()};
+      }()),
       graphicsQueueFamilyIndex(vkbDevice.get_queue_index(vkb::QueueType::graphics).value()),
-      presentQueueFamilyIndex(vkbDevice.get_queue_index(vkb::QueueType::present).value()),
+      presentQueueFamilyIndex(vkbDevice.get_queue_index(appSettings.isHeadless ? vkb::QueueType::graphics : vkb::QueueType::present).value()),
       computeQueueFamilyIndex(vkbDevice.get_queue_index(vkb::QueueType::compute).value()),
+      transferQueueFamilyIndex([&]() {
+        auto dedicatedIndex = vkbDevice.get_dedicated_queue_index(vkb::QueueType::transfer);
+        return dedicatedIndex.has_value() ? dedicatedIndex.value() : graphicsQueueFamilyIndex;
+      }()),
       renderPass(constructRenderPass()),
       framebuffers(constructFramebuffers()),
       commandPool(device, vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, graphicsQueueFamilyIndex)),
@@ -35,18 +54,29 @@ VulkanContext::VulkanContext(vku::Window& window, const AppSettings& appSettings
         vk::raii::CommandBuffers copyCmdBuffers = vk::raii::CommandBuffers(device, vk::CommandBufferAllocateInfo(*commandPool, vk::CommandBufferLevel::ePrimary, 1));
         return std::move(copyCmdBuffers[0]);
       }()),
-      descriptorPool(constructDescriptorPool()) {
+      descriptorPool(constructDescriptorPool()),
+      uploadQueue(device, allocator, transferQueue, transferQueueFamilyIndex, {graphicsQueueFamilyIndex, computeQueueFamilyIndex}),
+      gpuProfiler(device, physicalDevice, graphicsQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT),
+      parallelRecorder(device, graphicsQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT, ThreadPool::getGlobal().getNumThreads()),
+      bindlessHeap(device, physicalDevice),
+      // Starts at 0, i.e. "frame 0" is complete, so that first frames do not wait for frames that were never submitted
+      frameTimeline([&]() {
+        vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo(vk::SemaphoreType::eTimeline, 0);
+        return vk::raii::Semaphore{device, vk::SemaphoreCreateInfo({}, &semaphoreTypeCreateInfo)};
+      }()) {
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
     // (Semaphores begin their lifetime at "unsignaled" state)
     // Image Available -> Semaphore -> Submit Draw Calls for rendering
     imageAvailableForRenderingSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
     renderFinishedSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
-    // Start the fence in signaled state, so that we won't wait indefinitely for frame=-1 CommandBuffer to be done
-    commandBufferAvailableFences.emplace_back(device, vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
   }
+  setNumFramesInFlight(this->appSettings.numFramesInFlight);
 }
 
 VulkanContext::~VulkanContext() {
+  device.waitIdle();
+  deferredDestructions.clear();
+  savePipelineCache();
   vkb::destroy_debug_utils_messenger(vkbInstance->instance, vkbInstance->debug_messenger, vkbInstance->allocation_callbacks);
 }
 
@@ -61,7 +91,8 @@ vk::raii::Instance VulkanContext::constructInstance() {
   vkbInstanceBuilder = new vkb::InstanceBuilder();
   vkbInstanceBuilder
       ->set_app_name("Example Vulkan Application")
-      .require_api_version(1, 3, 0);
+      .require_api_version(1, 3, 0)
+      .set_headless(appSettings.isHeadless);  // no surface extensions needed
   if (vku::isDebugBuild) {
     vkbInstanceBuilder
         ->enable_validation_layers(vku::isDebugBuild)  // == .enable_layer("VK_LAYER_KHRONOS_validation")
@@ -84,8 +115,28 @@ vk::raii::Instance VulkanContext::constructInstance() {
 
 vk::raii::PhysicalDevice VulkanContext::constructPhysicalDevice() {
   vkb::PhysicalDeviceSelector phys_device_selector(*vkbInstance);
+  // A headless vkb::Instance does not require presentation support, hence no surface is needed for device selection
+  if (!appSettings.isHeadless)
+    phys_device_selector.set_surface(*surface);
+  // Timeline semaphores are core in 1.2 but still need to be enabled. UploadQueue signals one.
+  VkPhysicalDeviceVulkan12Features features12{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+  features12.timelineSemaphore = VK_TRUE;
+  // Descriptor indexing for BindlessHeap: runtime sized, partially bound descriptor arrays that can be updated while bound
+  features12.runtimeDescriptorArray = VK_TRUE;
+  features12.descriptorBindingPartiallyBound = VK_TRUE;
+  features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+  features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  // Indirect draws with drawCount > 1 and firstInstance != 0, i.e. many entities in one drawIndexedIndirect indexing a storage buffer via gl_InstanceIndex
+  VkPhysicalDeviceFeatures features{};
+  features.multiDrawIndirect = VK_TRUE;
+  features.drawIndirectFirstInstance = VK_TRUE;
+  // indexing BindlessHeap's arrays with push constant values
+  features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+  features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
   vkbPhysicalDevice = phys_device_selector
-                          .set_surface(*surface)
+                          .set_required_features(features)
+                          .set_required_features_12(features12)
                           .select()
                           .value();
   return vk::raii::PhysicalDevice{instance, vkbPhysicalDevice.physical_device};
@@ -96,13 +147,37 @@ vk::raii::Device VulkanContext::constructDevice() {
   return vk::raii::Device{physicalDevice, vkbDevice.device};
 }
 
-vk::raii::SwapchainKHR VulkanContext::constructSwapchain() {
+vk::raii::SwapchainKHR VulkanContext::constructSwapchain(vk::SwapchainKHR oldSwapchain) {
+  if (appSettings.isHeadless) {
+    swapchainExtent = vk::Extent2D{static_cast<uint32_t>(appSettings.width), static_cast<uint32_t>(appSettings.height)};
+    // nothing is presented, any mode goes
+    supportedPresentModes = {vk::PresentModeKHR::eFifo, vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate};
+    swapchainPresentMode = appSettings.presentMode;
+    return nullptr;
+  }
+
+  const vk::SurfaceCapabilitiesKHR surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(*surface);
+  swapchainMinImageCount = surfaceCapabilities.minImageCount;
+  // maxImageCount of 0 means there is no limit
+  swapchainMaxImageCount = surfaceCapabilities.maxImageCount > 0 ? surfaceCapabilities.maxImageCount : std::max(swapchainMinImageCount, 8u);
+  const uint32_t numImages = std::clamp(appSettings.numSwapchainImages, swapchainMinImageCount, swapchainMaxImageCount);
+
+  // FIFO: vsync, presents wait in a queue. FIFO_RELAXED: same, but a late image is presented right away (tears).
+  // MAILBOX: vsync, a newer image replaces the waiting one (no queueing latency, but GPU renders frames that are never shown). IMMEDIATE: no vsync (tears).
+  supportedPresentModes = physicalDevice.getSurfacePresentModesKHR(*surface);
+  swapchainPresentMode = appSettings.presentMode;
+  if (std::ranges::find(supportedPresentModes, swapchainPresentMode) == supportedPresentModes.end()) {
+    std::cerr << std::format("Present mode {} is not supported by the surface, using {} instead\n", vk::to_string(swapchainPresentMode), vk::to_string(vk::PresentModeKHR::eFifo));
+    swapchainPresentMode = vk::PresentModeKHR::eFifo;
+  }
+
   vkb::Swapchain vkbSwapchain = vkb::SwapchainBuilder{vkbDevice}
                                     .set_desired_format({static_cast<VkFormat>(swapchainColorFormat), static_cast<VkColorSpaceKHR>(swapchainColorSpace)})  // default
-                                    .set_desired_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)                                                                 // default. other: VK_PRESENT_MODE_FIFO_KHR
+                                    .set_desired_present_mode(static_cast<VkPresentModeKHR>(swapchainPresentMode))
                                     // Transfer Bit needed to enable clearing via vkCmdClearColorImage
                                     .set_image_usage_flags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-                                    .set_required_min_image_count(NUM_IMAGES)
+                                    .set_required_min_image_count(numImages)
+                                    .set_old_swapchain(static_cast<VkSwapchainKHR>(oldSwapchain))
                                     .build()
                                     .value();
   assert(vkbSwapchain.image_format == static_cast<VkFormat>(swapchainColorFormat));
@@ -112,7 +187,21 @@ vk::raii::SwapchainKHR VulkanContext::constructSwapchain() {
 }
 
 std::vector<vk::raii::ImageView> VulkanContext::constructSwapchainImageViews() {
-  const std::vector<VkImage>& swapchainImages = swapchain.getImages();
+  // Headless: offscreen images come with their own views. Transfer Src is for reading back rendered frames.
+  // Offscreen images are reused round-robin without acquire semaphores, so there have to be at least as many of them as frames that can be in flight
+  if (appSettings.isHeadless) {
+    const uint32_t numImages = std::max(std::clamp(appSettings.numSwapchainImages, swapchainMinImageCount, swapchainMaxImageCount), static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+    for (uint32_t ix = 0; ix < numImages; ++ix) {
+      offscreenImages.emplace_back(*this, swapchainColorFormat, swapchainExtent, swapchainSamples, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc, vk::ImageAspectFlagBits::eColor);
+      swapchainImages.push_back(*offscreenImages.back().image);
+      if (appSettings.hasPresentDepth)
+        depthImages.emplace_back(*this, swapchainDepthFormat, swapchainExtent, swapchainSamples, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::ImageAspectFlagBits::eDepth);
+    }
+    return {};
+  }
+
+  for (const VkImage& img : swapchain.getImages())
+    swapchainImages.push_back(img);
 
   std::vector<vk::raii::ImageView> imgViews;
   // vkbSwapchain.get_image_views() is actually not a getter but creator. Instead let's create imageViews ourselves
@@ -187,8 +276,8 @@ vk::raii::RenderPass VulkanContext::constructRenderPass() {
 
 std::vector<vk::raii::Framebuffer> VulkanContext::constructFramebuffers() {
   std::vector<vk::raii::Framebuffer> fbs;
-  for (size_t i = 0; i < swapchainImageViews.size(); i++) {
-    std::vector<vk::ImageView> attachments = {*swapchainImageViews[i]};
+  for (size_t i = 0; i < swapchainImages.size(); i++) {
+    std::vector<vk::ImageView> attachments = {appSettings.isHeadless ? *offscreenImages[i].imageView : *swapchainImageViews[i]};
     if (appSettings.hasPresentDepth)
       attachments.push_back(*depthImages[i].imageView);
     vk::FramebufferCreateInfo framebufferCreateInfo({}, *renderPass, attachments, swapchainExtent.width, swapchainExtent.height, 1);
@@ -197,33 +286,84 @@ std::vector<vk::raii::Framebuffer> VulkanContext::constructFramebuffers() {
   return fbs;  // probably unneccessary copy
 }
 
+vk::raii::PipelineCache VulkanContext::constructPipelineCache() {
+  std::vector<char> data;
+  if (std::ifstream in{pipelineCachePath, std::ios::binary | std::ios::ate}; in) {
+    data.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(data.data(), data.size());
+  }
+
+  // Driver would reject incompatible data anyway, but some drivers crash instead. Check the header (VkPipelineCacheHeaderVersionOne) first.
+  // A cache from another GPU or driver version is simply discarded.
+  const vk::PhysicalDeviceProperties props = physicalDevice.getProperties();
+  bool isValid = data.size() >= sizeof(VkPipelineCacheHeaderVersionOne);
+  if (isValid) {
+    VkPipelineCacheHeaderVersionOne header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    isValid = header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+              header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+              header.vendorID == props.vendorID &&
+              header.deviceID == props.deviceID &&
+              std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+  }
+  if (!isValid && !data.empty())
+    std::cout << std::format("Discarding incompatible pipeline cache {}\n", pipelineCachePath.string());
+  if (!isValid)
+    data.clear();
+
+  return vk::raii::PipelineCache{device, vk::PipelineCacheCreateInfo{{}, data.size(), data.data()}};
+}
+
+void VulkanContext::savePipelineCache() const {
+  const std::vector<uint8_t> data = pipelineCache.getData();
+  // Write to a temporary file then rename, so that a crash in the middle never leaves a truncated cache behind
+  std::filesystem::path tmpPath = pipelineCachePath;
+  tmpPath += ".tmp";
+  {
+    std::ofstream out{tmpPath, std::ios::binary | std::ios::trunc};
+    if (!out)
+      return;
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!out)
+      return;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, pipelineCachePath, ec);
+  if (ec)
+    std::filesystem::remove(tmpPath, ec);
+}
+
 vk::raii::DescriptorPool VulkanContext::constructDescriptorPool() {
   // Add additional descriptor types to this list or increase their amount when needed
   std::array<vk::DescriptorPoolSize, 2> typeCounts = {
-      vk::DescriptorPoolSize{vk::DescriptorType::eUniformBuffer, 10},
-      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 10},
+      vk::DescriptorPoolSize{vk::DescriptorType::eUniformBuffer, 24},
+      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 24},
   };
 
-  const uint32_t maxNumofRequestableDescriptorSets = 10; // 4*2 for graphics + 2 for compute
+  // For Studies' own descriptor sets. Bindless ones go into bindlessHeap, which has its own pool
+  const uint32_t maxNumofRequestableDescriptorSets = 24;
   vk::DescriptorPoolCreateInfo descriptorPoolInfo = {vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, maxNumofRequestableDescriptorSets, typeCounts};
   return device.createDescriptorPool(descriptorPoolInfo);
 }
 
 void VulkanContext::recreateSwapchain() {
-  // This makes rendering stop before creating the swapchain. Actually, it's possible to create new swapchain while drawing commands on the image from the old one are still in-flight
-  // TODO: if recreating use "set old swapchain" option when creating new swapchain and delete old one once presentation is done. (Maybe give a flag to `constructSwapchain`)
-  device.waitIdle();
-
-  framebuffers.clear();
-  swapchainImageViews.clear();
-  depthImages.clear();
-  swapchain.clear();
-
-  swapchain = constructSwapchain();
+  // No device.waitIdle(). Frames in flight keep rendering into and presenting the old images, while next frame acquires from the new swapchain.
+  // Old swapchain, its views, depth images and framebuffers are destroyed once the frames that could have used them have retired.
+  // (Strictly, the old swapchain should outlive its pending presents, which only VK_EXT_swapchain_maintenance1's present fences can tell. Presents are queued right after their frames, so retirement of all of them is used instead, as is common practice.)
+  vk::raii::SwapchainKHR newSwapchain = constructSwapchain(*swapchain);
+  deferDestroy(std::exchange(framebuffers, {}));
+  deferDestroy(std::exchange(swapchainImageViews, {}));
+  deferDestroy(std::exchange(depthImages, {}));
+  deferDestroy(std::exchange(offscreenImages, {}));
+  deferDestroy(std::move(swapchain));
+  swapchainImages.clear();
+  offscreenImageIndex = 0;
+
+  swapchain = std::move(newSwapchain);
   swapchainImageViews = constructSwapchainImageViews();
-  // Recreation of the RenderpPass is usually not necessary.
-  // Only needed when image format changes during application lifetime e.g. Moving app window from standard range to HDR monitor.
-  renderPass = constructRenderPass();
+  // RenderPass only depends on formats, which stay the same. Recreating it would only be needed when the image format changes during application lifetime,
+  // e.g. Moving app window from standard range to HDR monitor. (Then pipelines created with the old one would have to be deferDestroy'ed too.)
   framebuffers = constructFramebuffers();
 }
 
@@ -231,36 +371,61 @@ FrameDrawer VulkanContext::drawFrameBegin() {
   vk::Result result = vk::Result::eErrorUnknown;
   vk::raii::CommandBuffer& cmdBuf = commandBuffers[currentFrame];
 
-  // Wait for previous frame's CommandBuffer processing to finish, so that we don't write next image's commands into the same CommandBuffer
-  // Maximum int value "disables" timeout.
-  result = device.waitForFences(*commandBufferAvailableFences[currentFrame], true, std::numeric_limits<uint64_t>::max());
-  assert(result == vk::Result::eSuccess);
+  // Let at most numFramesInFlight frames be in flight, i.e. wait for the frame numFramesInFlight frames ago to finish.
+  // numFramesInFlight <= MAX_FRAMES_IN_FLIGHT, so this covers the frame that used this CommandBuffer, and we don't write next image's commands into the same CommandBuffer
+  const uint64_t numFramesInFlight = appSettings.numFramesInFlight;
+  if (currentFrameValue > numFramesInFlight)
+    waitForFrame(currentFrameValue - numFramesInFlight);
+  retiredFrameGpuDurationMs.reset();
+  // Resources whose last user has finished can go now
+  const uint64_t completedFrameValue = getCompletedFrameValue();
+  while (!deferredDestructions.empty() && deferredDestructions.front().frameValue <= completedFrameValue)
+    deferredDestructions.pop_front();
+  // same for bindless heap slots
+  bindlessHeap.beginFrame(currentFrameValue, completedFrameValue);
+  // When the wait above blocked, "now" is when the GPU finished the frame. Otherwise the frame finished a bit earlier, i.e. this is an upper bound.
+  retiredFrameInputLatencyMs.reset();
+  const auto now = std::chrono::steady_clock::now();
+  while (!pendingInputLatencySamples.empty() && pendingInputLatencySamples.front().frameValue <= completedFrameValue) {
+    retiredFrameInputLatencyMs = std::chrono::duration<float, std::milli>(now - pendingInputLatencySamples.front().inputSampleTime).count();
+    pendingInputLatencySamples.pop_front();
+  }
 
   // Acquire an image available for rendering from the Swapchain, then signal availability (i.e. readiness for executing draw calls)
   uint32_t imageIndex = 0;  // index/position of the image in Swapchain
-  try {
-    std::tie(result, imageIndex) = swapchain.acquireNextImage(std::numeric_limits<uint64_t>::max(), *imageAvailableForRenderingSemaphores[currentFrame]);
-  } catch ([[maybe_unused]] vk::OutOfDateKHRError& e) {
-    assert(result == vk::Result::eErrorOutOfDateKHR);  // to see whether result gets a wrong value as it happens with presentKHR
-    recreateSwapchain();
-    return FrameDrawer{cmdBuf, imageIndex, swapchain.getImages()[imageIndex], currentFrame, framebuffers[imageIndex]};
+  if (appSettings.isHeadless) {
+    // Round-robin over offscreen images. There are at least MAX_FRAMES_IN_FLIGHT of them, so the wait above guarantees that the frame which used this image last is done (submission order)
+    imageIndex = offscreenImageIndex;
+    offscreenImageIndex = (offscreenImageIndex + 1) % static_cast<uint32_t>(swapchainImages.size());
+    result = vk::Result::eSuccess;
+  } else {
+    // An out of date swapchain (e.g. after a resize) is recreated, which is cheap now, and acquired from again. A failed acquire does not signal the semaphore.
+    while (true) {
+      try {
+        std::tie(result, imageIndex) = swapchain.acquireNextImage(std::numeric_limits<uint64_t>::max(), *imageAvailableForRenderingSemaphores[currentFrame]);
+        break;
+      } catch ([[maybe_unused]] vk::OutOfDateKHRError& e) {
+        recreateSwapchain();
+      }
+    }
   }
   assert(result == vk::Result::eSuccess);  // or vk::Result::eSuboptimalKHR
-  assert(imageIndex < swapchain.getImages().size());
+  assert(imageIndex < swapchainImages.size());
 
   // Record a command buffer which draws the scene into acquired/available image
   cmdBuf.reset();  // clean up, don't reuse existing commands
 
   cmdBuf.begin(vk::CommandBufferBeginInfo{});
-  // By default +y is down in Vulkan. To make it consistent with OpenGL flip y-direction by giving a negative height value to the viewport
-  // Also need to shift the origin upwards accordingly. See https://www.saschawillems.de/blog/2019/03/29/flipping-the-vulkan-viewport/
-  const auto viewport = vk::Viewport{0.f, static_cast<float>(swapchainExtent.height), static_cast<float>(swapchainExtent.width), -static_cast<float>(swapchainExtent.height), 0.f, 1.f};
-  cmdBuf.setViewport(0, viewport);
-  const auto renderArea = vk::Rect2D{{0, 0}, swapchainExtent};
-  cmdBuf.setScissor(0, renderArea);
+  // Thanks to the fence, timestamps of the frame that used this CommandBuffer before are available. Collecting them does not stall.
+  gpuProfiler.beginFrame(cmdBuf, currentFrame);
+  if (gpuProfiler.hasNewResults())
+    retiredFrameGpuDurationMs = gpuProfiler.getLatestResults().front().durationMs;
+  // Same for secondary CommandBuffers recorded in this slot
+  parallelRecorder.beginFrame(currentFrame);
+  setViewportAndScissor(cmdBuf);
 
   // Transition swapchain image layout from eUndefined -> eTransferDstOptimal (required for vkCmdClearColorImage)
-  const vk::Image& image = swapchain.getImages()[imageIndex];
+  const vk::Image& image = swapchainImages[imageIndex];
   const auto subresourceRanges = vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
   vku::setImageLayout(cmdBuf, image, swapchainColorFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
 
@@ -276,43 +441,127 @@ FrameDrawer VulkanContext::drawFrameBegin() {
   if (appSettings.hasPresentDepth)
     vku::setImageLayout(cmdBuf, *depthImages[imageIndex].image, swapchainDepthFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal);
 
-  return FrameDrawer{cmdBuf, imageIndex, image, currentFrame, framebuffers[imageIndex]};
+  return FrameDrawer{cmdBuf, imageIndex, image, currentFrame, framebuffers[imageIndex], gpuProfiler};
 }
 
 void VulkanContext::drawFrameEnd(const FrameDrawer& frameDrawer) {
   vk::Result result = vk::Result::eErrorUnknown;
 
-  // Transition to ePresentSrcKHR for presentKHR
-  vku::setImageLayout(frameDrawer.commandBuffer, frameDrawer.image, swapchainColorFormat, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::ePresentSrcKHR);
+  // Transition to ePresentSrcKHR for presentKHR. Offscreen images are left ready to be copied from instead.
+  const vk::ImageLayout finalLayout = appSettings.isHeadless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+  vku::setImageLayout(frameDrawer.commandBuffer, frameDrawer.image, swapchainColorFormat, vk::ImageLayout::eColorAttachmentOptimal, finalLayout);
 
+  gpuProfiler.endFrame(frameDrawer.commandBuffer);
   frameDrawer.commandBuffer.end();
 
+  // Buffer uploads enqueued so far (at Study init, or during this frame) have to land before this frame's commands can read them
+  const uint64_t uploadTimelineValue = uploadQueue.flush();
+
   // Submit recorded command buffer to graphics queue
   // Once previous fence is passed and image is available, submit commands and do graphics calculations, signal finishedSemaphore after execution
-  const vk::PipelineStageFlags waitStages(vk::PipelineStageFlagBits::eColorAttachmentOutput);
-  vk::SubmitInfo submitInfo(*imageAvailableForRenderingSemaphores[currentFrame], waitStages, *frameDrawer.commandBuffer, *renderFinishedSemaphores[currentFrame]);
+  // Nothing is acquired or presented in headless mode. Only the fence is needed to know when the CommandBuffer is available again.
+  std::vector<vk::Semaphore> waitSemaphores;
+  std::vector<vk::PipelineStageFlags> waitStages;
+  std::vector<uint64_t> waitValues;  // ignored for binary semaphores
+  std::vector<vk::Semaphore> signalSemaphores;
+  std::vector<uint64_t> signalValues;  // ignored for binary semaphores
+  if (!appSettings.isHeadless) {
+    waitSemaphores.push_back(*imageAvailableForRenderingSemaphores[currentFrame]);
+    waitStages.push_back(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+    waitValues.push_back(0);
+    signalSemaphores.push_back(*renderFinishedSemaphores[currentFrame]);
+    signalValues.push_back(0);
+  }
+  for (const TimelineSemaphoreOp& op : extraFrameWaits) {
+    waitSemaphores.push_back(op.semaphore);
+    waitStages.push_back(op.waitStage);
+    waitValues.push_back(op.value);
+  }
+  for (const TimelineSemaphoreOp& op : extraFrameSignals) {
+    signalSemaphores.push_back(op.semaphore);
+    signalValues.push_back(op.value);
+  }
+  extraFrameWaits.clear();
+  extraFrameSignals.clear();
+  // Uploaded buffers can be read by any stage (vertex input, shaders, transfers)
+  if (!uploadQueue.isComplete(uploadTimelineValue)) {
+    waitSemaphores.push_back(*uploadQueue.getTimelineSemaphore());
+    waitStages.push_back(vk::PipelineStageFlagBits::eAllCommands);
+    waitValues.push_back(uploadTimelineValue);
+  }
+  // Signal frame value indicating we are done with this CommandBuffer (and with everything this frame used)
+  signalSemaphores.push_back(*frameTimeline);
+  signalValues.push_back(currentFrameValue);
+  const vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo(waitValues, signalValues);
+  vk::SubmitInfo submitInfo(waitSemaphores, waitStages, *frameDrawer.commandBuffer, signalSemaphores, &timelineSubmitInfo);
+
+  // Submit recorded CommanBuffer.
+  graphicsQueue.submit(submitInfo);
+  pendingInputLatencySamples.push_back({currentFrameValue, window.getInputSampleTime()});
+  // Frame slot and frame value advance together (even if present fails below), so that the slot's previous user is always currentFrameValue - MAX_FRAMES_IN_FLIGHT
+  const uint32_t submittedFrame = currentFrame;
+  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  ++currentFrameValue;
 
-  // Fences must be reset manually to go back into unsignaled state.
-  // Reset fence only just before when we are submitting the queue (not immediately after we waited for it at the beginning of the frame drawing)
-  // otherwise an early return from "Out of Date" acquired image might keep the fence in unsignaled state eternally
-  device.resetFences(*commandBufferAvailableFences[currentFrame]);
-  // Submit recorded CommanBuffer. Signal fence indicating we are done with this CommandBuffer.
-  graphicsQueue.submit(submitInfo, *commandBufferAvailableFences[currentFrame]);
+  if (appSettings.isHeadless)
+    return;
 
   // Waits for finishedSemaphore before execution, then Present the Swapchain image, no signal thereafter
-  vk::PresentInfoKHR presentInfo(*renderFinishedSemaphores[currentFrame], *swapchain, frameDrawer.imageIndex);
+  vk::PresentInfoKHR presentInfo(*renderFinishedSemaphores[submittedFrame], *swapchain, frameDrawer.imageIndex);
   try {
     result = presentQueue.presentKHR(presentInfo);
   } catch ([[maybe_unused]] vk::OutOfDateKHRError& e) {
     // for some reason, even though "out of date" exception was thrown result is still vk::eSuccess.
     // Setting it to correct value manually just in case result will be used below later.
     result = vk::Result::eErrorOutOfDateKHR;
+    // Whether a failed present consumed the wait on renderFinishedSemaphore is not defined. Replace it, so that it is not signaled twice when the slot comes around again.
+    deferDestroy(std::move(renderFinishedSemaphores[submittedFrame]));
+    renderFinishedSemaphores[submittedFrame] = vk::raii::Semaphore{device, vk::SemaphoreCreateInfo()};
     recreateSwapchain();
     return;
   }
-  assert(result == vk::Result::eSuccess);  // or vk::Result::eSuboptimalKHR
+  assert(result == vk::Result::eSuccess || result == vk::Result::eSuboptimalKHR);
+  // Still presentable, but does not match the surface anymore (e.g. during a resize). Recreation does not stall, so do it right away.
+  if (result == vk::Result::eSuboptimalKHR)
+    recreateSwapchain();
+}
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+void VulkanContext::setSwapchainSettings(uint32_t numSwapchainImages, vk::PresentModeKHR presentMode) {
+  appSettings.numSwapchainImages = numSwapchainImages;
+  appSettings.presentMode = presentMode;
+  recreateSwapchain();
+}
+
+void VulkanContext::setNumFramesInFlight(uint32_t numFramesInFlight) {
+  appSettings.numFramesInFlight = std::clamp(numFramesInFlight, 1u, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+}
+
+void VulkanContext::setViewportAndScissor(const vk::raii::CommandBuffer& cmdBuf) const {
+  // By default +y is down in Vulkan. To make it consistent with OpenGL flip y-direction by giving a negative height value to the viewport
+  // Also need to shift the origin upwards accordingly. See https://www.saschawillems.de/blog/2019/03/29/flipping-the-vulkan-viewport/
+  const auto viewport = vk::Viewport{0.f, static_cast<float>(swapchainExtent.height), static_cast<float>(swapchainExtent.width), -static_cast<float>(swapchainExtent.height), 0.f, 1.f};
+  cmdBuf.setViewport(0, viewport);
+  const auto renderArea = vk::Rect2D{{0, 0}, swapchainExtent};
+  cmdBuf.setScissor(0, renderArea);
+}
+
+uint64_t VulkanContext::getCompletedFrameValue() const {
+  return frameTimeline.getCounterValue();
+}
+
+void VulkanContext::waitForFrame(uint64_t frameValue) const {
+  // Maximum int value "disables" timeout.
+  const vk::SemaphoreWaitInfo waitInfo({}, *frameTimeline, frameValue);
+  [[maybe_unused]] const vk::Result result = device.waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max());
+  assert(result == vk::Result::eSuccess);
+}
+
+void VulkanContext::addFrameWaitSemaphore(vk::Semaphore timelineSemaphore, uint64_t value, vk::PipelineStageFlags waitStage) const {
+  extraFrameWaits.push_back({timelineSemaphore, value, waitStage});
+}
+
+void VulkanContext::addFrameSignalSemaphore(vk::Semaphore timelineSemaphore, uint64_t value) const {
+  extraFrameSignals.push_back({timelineSemaphore, value, {}});
 }
 
 uint32_t VulkanContext::getMemoryType(uint32_t requirementTypeBits, const vk::MemoryPropertyFlags& propertyFlags) const {
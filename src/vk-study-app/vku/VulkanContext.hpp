@@ -1,11 +1,22 @@
 #pragma once
 #include "../StudyApp/AppSettings.hpp"
+#include "../vku/Allocator.hpp"
+#include "../vku/BindlessHeap.hpp"
+#include "../vku/GpuProfiler.hpp"
+#include "../vku/ParallelRecorder.hpp"
+#include "../vku/UploadQueue.hpp"
 #include "../vku/Window.hpp"
 
 #include <VkBootstrap.h>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <chrono>
+#include <deque>
+#include <filesystem>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
 #include <vector>
 
 namespace vku {
@@ -17,14 +28,15 @@ struct FrameDrawer {
   const vk::Image image;      // same as above
   const uint32_t frameNo;
   const vk::raii::Framebuffer& framebuffer;
+  // for timing parts of the frame, e.g. `auto s = frameDrawer.profiler.scope(frameDrawer.commandBuffer, "draw")`
+  GpuProfiler& profiler;
 };
 
 class VulkanContext {
  public:
-  // TODO: make it tunable with its default being "surface capabilities -> minimum image count + 1
-  const uint32_t NUM_IMAGES = 3;
-  // Values larger than 2 might cause latency. More frames will be recorded than being presented by GPU.
-  const int MAX_FRAMES_IN_FLIGHT = 2;
+  // Number of frame slots, i.e. CommandBuffers, sync objects and per-frame resources of Studies.
+  // How many of them are actually in flight is appSettings.numFramesInFlight, which can be changed at runtime. Values larger than 2 might cause latency.
+  const int MAX_FRAMES_IN_FLIGHT = 3;
   AppSettings appSettings;
 
  private:
@@ -54,20 +66,38 @@ class VulkanContext {
 
  public:
   vk::raii::Device device;
+  // Sub-allocates device memory for Buffers, UniformBuffers and Images. mutable because resources are created via `const VulkanContext&`. (it is thread-safe)
+  mutable Allocator allocator;
+  const std::filesystem::path pipelineCachePath = "pipeline-cache.bin";
+  // Pass to every pipeline creation. Loaded from pipelineCachePath at startup (if it was written by the same driver and device), saved back at destruction.
+  vk::raii::PipelineCache pipelineCache;
   vk::Format swapchainColorFormat;
   vk::ColorSpaceKHR swapchainColorSpace;
   vk::Format swapchainDepthFormat;
   vk::SampleCountFlagBits swapchainSamples;
   vk::Extent2D swapchainExtent;
+  // Present mode the swapchain was created with. appSettings.presentMode, or FIFO if the surface does not support that.
+  vk::PresentModeKHR swapchainPresentMode = vk::PresentModeKHR::eFifo;
+  // Queried from the surface at swapchain creation. (All modes and [1, 8] images in headless mode)
+  std::vector<vk::PresentModeKHR> supportedPresentModes;
+  uint32_t swapchainMinImageCount = 1;
+  uint32_t swapchainMaxImageCount = 8;
   vk::raii::SwapchainKHR swapchain;
+  // In headless mode there is no swapchain. Color attachments are rendered into these instead.
+  std::vector<vku::Image> offscreenImages;
+  // Images of the swapchain (or of offscreenImages in headless mode). Cached to not query the swapchain every frame.
+  std::vector<vk::Image> swapchainImages;
   std::vector<vku::Image> depthImages;
   std::vector<vk::raii::ImageView> swapchainImageViews;
   vk::raii::Queue graphicsQueue;
   vk::raii::Queue presentQueue;
   vk::raii::Queue computeQueue;
+  // a transfer-only queue if the device has one (usually backed by a DMA engine), otherwise the graphics queue
+  vk::raii::Queue transferQueue;
   uint32_t graphicsQueueFamilyIndex;
   uint32_t presentQueueFamilyIndex;
   uint32_t computeQueueFamilyIndex;
+  uint32_t transferQueueFamilyIndex;
   vk::raii::RenderPass renderPass;
   std::vector<vk::raii::Framebuffer> framebuffers;
   vk::raii::CommandPool commandPool;
@@ -75,6 +105,14 @@ class VulkanContext {
   // for copying buffers from host to device etc
   vk::raii::CommandBuffer copyCommandBuffer;
   vk::raii::DescriptorPool descriptorPool;
+  // Buffer uploads are batched and submitted on transferQueue. Each frame submission waits on its timeline semaphore. mutable for the same reason as allocator.
+  mutable UploadQueue uploadQueue;
+  // timestamp queries per frame-in-flight, with a root "frame" scope around the whole CommandBuffer
+  GpuProfiler gpuProfiler;
+  // Per worker thread, per frame-in-flight CommandPools for recording secondary CommandBuffers concurrently. mutable for the same reason as allocator.
+  mutable ParallelRecorder parallelRecorder;
+  // Global descriptor set with arrays of storage buffers and sampled images, indexed via push constants. Bind once per frame. mutable for the same reason as allocator.
+  mutable BindlessHeap bindlessHeap;
 
  private:
   //---- Synchronization
@@ -84,24 +122,59 @@ class VulkanContext {
   // Once B starts S returns to "unsignaled" state to be reused again
   std::vector<vk::raii::Semaphore> imageAvailableForRenderingSemaphores;
   std::vector<vk::raii::Semaphore> renderFinishedSemaphores;
-  // A fense is used to introduce order on CPU execution. It's usually used for CPU to wait a GPU operation to complete.
-  // A GPU work is submitted with a fence. When GPU work is done fence is signaled.
-  // Fences block the host. Any CPU execution waiting for that fence will stop until the signal arrives.
-  std::vector<vk::raii::Fence> commandBufferAvailableFences;  // aka commandBufferAvailableFences
+  // A timeline semaphore has a monotonically increasing 64-bit counter instead of a signaled/unsignaled state. It is both a semaphore and a fence:
+  // queue submissions wait for / signal values, and the host can query the counter or block until it reaches a value.
+  // Every frame submission signals frameTimeline with its frame value (1, 2, 3, ...). Replaces per frame-in-flight fences.
+  // (Acquire and present still need the binary semaphores above, swapchains do not accept timeline semaphores.)
+  vk::raii::Semaphore frameTimeline;
+  uint64_t currentFrameValue = 1;
+  // Timeline semaphore operations Studies added for the next frame submission. mutable because they are added via `const VulkanContext&`
+  struct TimelineSemaphoreOp {
+    vk::Semaphore semaphore;
+    uint64_t value;
+    vk::PipelineStageFlags waitStage;  // unused for signals
+  };
+  mutable std::vector<TimelineSemaphoreOp> extraFrameWaits;
+  mutable std::vector<TimelineSemaphoreOp> extraFrameSignals;
+  struct DeferredDestruction {
+    uint64_t frameValue;
+    std::shared_ptr<void> resource;
+  };
+  // destroyed in drawFrameBegin() once frameTimeline reaches their frameValue. Declared after the device and the allocator, so that it is destroyed before them
+  mutable std::deque<DeferredDestruction> deferredDestructions;
+  // Input sample time (Window::pollEvents) of submitted frames, until drawFrameBegin() sees them finished
+  struct InputLatencySample {
+    uint64_t frameValue;
+    std::chrono::steady_clock::time_point inputSampleTime;
+  };
+  std::deque<InputLatencySample> pendingInputLatencySamples;
   // Note that, having an array of each sync object is to allow recording of one frame while next one is being recorded
+
  public:
   uint32_t currentFrame = 0;
+  // GPU duration of the frame retired by the latest drawFrameBegin(), i.e. of the frame that used the same CommandBuffer MAX_FRAMES_IN_FLIGHT frames ago.
+  // Empty before the first retirement or if graphics queue does not support timestamps.
+  std::optional<float> retiredFrameGpuDurationMs;
+  // Time from input sampling of the latest frame retired by drawFrameBegin() until the CPU saw its GPU work finished, i.e. until the image could be presented.
+  // Time spent in the presentation engine's queue (FIFO with many images) is not included. Empty if no frame has been retired.
+  std::optional<float> retiredFrameInputLatencyMs;
 
  private:
+  // next offscreen image to render into in headless mode. Equivalent of acquireNextImage's output
+  uint32_t offscreenImageIndex = 0;
+
   vk::raii::Instance constructInstance();
   vk::raii::PhysicalDevice constructPhysicalDevice();
   vk::raii::Device constructDevice();
-  vk::raii::SwapchainKHR constructSwapchain();
+  // oldSwapchain is retired by the new one. The driver can reuse its resources, its already acquired images can still be presented.
+  vk::raii::SwapchainKHR constructSwapchain(vk::SwapchainKHR oldSwapchain = nullptr);
   std::vector<vk::raii::ImageView> constructSwapchainImageViews();
   vk::raii::RenderPass constructRenderPass();
   std::vector<vk::raii::Framebuffer> constructFramebuffers();
   vk::raii::DescriptorPool constructDescriptorPool();
-  // To be called when app window is resized
+  vk::raii::PipelineCache constructPipelineCache();
+  void savePipelineCache() const;
+  // To be called when app window is resized, or swapchain settings change. Does not wait for the GPU, old swapchain objects are destroyed via deferDestroy()
   void recreateSwapchain();
 
  public:
@@ -110,6 +183,33 @@ class VulkanContext {
 
   FrameDrawer drawFrameBegin();
   void drawFrameEnd(const FrameDrawer& frameDrawer);
+  // Recreates the swapchain with given settings. Not between drawFrameBegin() and drawFrameEnd(), since it invalidates the FrameDrawer's framebuffer and image.
+  void setSwapchainSettings(uint32_t numSwapchainImages, vk::PresentModeKHR presentMode);
+  // Clamped to [1, MAX_FRAMES_IN_FLIGHT]. Takes effect at the next drawFrameBegin(), can be called anytime.
+  void setNumFramesInFlight(uint32_t numFramesInFlight);
+  // For Studies that submit work to other queues (e.g. async compute): makes the current frame's submission wait for / signal a timeline semaphore value.
+  // Call between drawFrameBegin() and drawFrameEnd(). Only apply to that one submission.
+  void addFrameWaitSemaphore(vk::Semaphore timelineSemaphore, uint64_t value, vk::PipelineStageFlags waitStage) const;
+  void addFrameSignalSemaphore(vk::Semaphore timelineSemaphore, uint64_t value) const;
+
+  // Value the frame being recorded (between drawFrameBegin() and drawFrameEnd()) signals on getFrameTimelineSemaphore() when its GPU work is done.
+  // Any submission can wait for a frame value, and CPU code can check whether GPU has finished a frame without blocking.
+  uint64_t getCurrentFrameValue() const { return currentFrameValue; }
+  const vk::raii::Semaphore& getFrameTimelineSemaphore() const { return frameTimeline; }
+  // Largest frame value GPU has finished. Does not block.
+  uint64_t getCompletedFrameValue() const;
+  bool isFrameComplete(uint64_t frameValue) const { return getCompletedFrameValue() >= frameValue; }
+  // Blocks the host until GPU has finished given frame
+  void waitForFrame(uint64_t frameValue) const;
+  // Keeps resource (e.g. a vku::Buffer, vk::raii::Pipeline) alive until GPU has finished the current frame, i.e. the last frame that could have used it.
+  // For replacing resources while older frames are still in flight without waiting for the device to be idle.
+  template <typename T>
+  void deferDestroy(T&& resource) const {
+    deferredDestructions.push_back({currentFrameValue, std::make_shared<std::remove_cvref_t<T>>(std::forward<T>(resource))});
+  }
+
+  // Viewport (flipped to +y up) and scissor covering the swapchain image. drawFrameBegin() sets them on the frame's CommandBuffer, secondary CommandBuffers need them too.
+  void setViewportAndScissor(const vk::raii::CommandBuffer& cmdBuf) const;
 
   // utilities
   uint32_t getMemoryType(uint32_t requirementTypeBits, const vk::MemoryPropertyFlags& flags) const;
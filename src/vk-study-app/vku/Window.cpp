@@ -3,7 +3,10 @@
 #include <iostream>
 
 namespace vku {
-Window::Window(const AppSettings& appSettings) {
+Window::Window(const AppSettings& appSettings)
+    : headless(appSettings.isHeadless), headlessSize(appSettings.width, appSettings.height) {
+  if (headless)
+    return;
   glfwInit();
   glfwSetErrorCallback([](int error, const char* msg) { std::cerr << "GLFW ERROR: "
                                                                   << "(" << error << ") " << msg << std::endl; });
@@ -12,17 +15,23 @@ Window::Window(const AppSettings& appSettings) {
 }
 
 Window::~Window() {
+  if (headless)
+    return;
   window.release();  // need to explicitly delete, otherwise the unique_ptr delete will be called after glfwTerminate
   glfwTerminate();
 }
 
 vk::raii::SurfaceKHR Window::createSurface(const vk::raii::Instance& instance) const {
+  if (headless)
+    return vk::raii::SurfaceKHR{nullptr};
   VkSurfaceKHR vkSurface = VK_NULL_HANDLE;
   glfwCreateWindowSurface(*instance, window.get(), nullptr, &vkSurface);
   return vk::raii::SurfaceKHR{instance, vkSurface};
 }
 
 std::vector<std::string> Window::getRequiredInstanceExtensions() const {
+  if (headless)
+    return {};
   uint32_t count;
   const char** extensions = glfwGetRequiredInstanceExtensions(&count);
   std::vector<std::string> instanceExtensions;
@@ -32,30 +41,43 @@ std::vector<std::string> Window::getRequiredInstanceExtensions() const {
 }
 
 bool Window::shouldClose() const {
+  if (headless)
+    return false;
   return glfwWindowShouldClose(window.get());
 }
 
 void Window::pollEvents() const {
-  glfwPollEvents();
+  // headless frames have no inputs, but are still timed the same way for comparable latency numbers
+  if (!headless)
+    glfwPollEvents();
+  inputSampleTime = std::chrono::steady_clock::now();
 }
 
 glm::vec2 Window::getSize() const {
+  if (headless)
+    return headlessSize;
   int width, height;
   glfwGetWindowSize(window.get(), &width, &height);
   return {width, height};
 }
 
 bool Window::isKeyHeld(int glfwKey) const {
+  if (headless)
+    return false;
   const int state = glfwGetKey(window.get(), glfwKey);
   return state == GLFW_PRESS || state == GLFW_REPEAT;
 }
 
 bool Window::isMouseButtonPressed(int glfwButton) const {
+  if (headless)
+    return false;
   const int state = glfwGetMouseButton(window.get(), glfwButton);
   return state == GLFW_PRESS;
 }
 
 glm::vec2 Window::getMouseCursorPosition() const {
+  if (headless)
+    return {};
   double xpos, ypos;
   glfwGetCursorPos(window.get(), &xpos, &ypos);
   return glm::vec2{static_cast<float>(xpos), static_cast<float>(ypos)};
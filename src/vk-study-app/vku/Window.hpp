@@ -7,6 +7,7 @@
 #include <glm/vec2.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <string>
@@ -16,6 +17,11 @@ namespace vku {
 class Window {
  private:
   std::unique_ptr<GLFWwindow, decltype([](GLFWwindow* win) { glfwDestroyWindow(win); })> window;
+  // When headless GLFW is not initialized at all. Input queries return "nothing pressed" and size is the requested one.
+  const bool headless;
+  const glm::vec2 headlessSize;
+  // When inputs of the current frame were sampled, i.e. the end of the latest pollEvents(). Start of the input latency measurement.
+  mutable std::chrono::steady_clock::time_point inputSampleTime;
 
  public:
   Window(const AppSettings& appSettings = {});
@@ -23,8 +29,10 @@ class Window {
   vk::raii::SurfaceKHR createSurface(const vk::raii::Instance& instance) const;
   std::vector<std::string> getRequiredInstanceExtensions() const;
   bool shouldClose() const;
+  bool isHeadless() const { return headless; }
   // Call once a frame
   void pollEvents() const;
+  std::chrono::steady_clock::time_point getInputSampleTime() const { return inputSampleTime; }
   glm::vec2 getSize() const;
   // TODO: Make friends with ImGuiHelper
   GLFWwindow* getGLFWWindow() const { return window.get(); }